@@ -33,6 +33,13 @@ namespace EntityNetwork
 			if (desc == nullptr)
 				return nullptr;
 
+			EntityInstance::Ptr ent = TakePooledEntity(desc);
+			if (ent != nullptr)
+			{
+				ent->SetID(id);
+				return ent;
+			}
+
 			auto facItr = EntityFactories.find(desc->ID);
 			if (facItr != EntityFactories.end())
 				return facItr->second(desc, id);
@@ -82,6 +89,11 @@ namespace EntityNetwork
 			auto id = reader.ReadID();
 			auto type = reader.ReadInt();
 			auto owner = reader.ReadID();
+			tick_t tick = static_cast<tick_t>(reader.ReadID());
+
+			// every add is counted, the server holds the entity's state updates until the count is acked
+			AddsReceived++;
+			AckPending = true;
 
 			auto desc = GetEntityDef(type);
 			if (desc == nullptr || desc->AllowClientCreate() || !desc->SyncCreate())	// we are not supposed to get this from the remote
@@ -90,13 +102,27 @@ namespace EntityNetwork
 			EntityInstance::Ptr inst = NewEntityInstance(desc, id);
 			inst->OwnerID = owner;
 
+			ReceivedStates& states = EntityStates[id];
+			states = ReceivedStates();
+			states.AddedTick = tick;
+
 			while (!reader.Done())
 			{
-				auto index = reader.ReadByte();
-				if (index >= 0 && index < inst->Properties.Size())
-					inst->Properties[index]->UnpackValue(reader, true);
-				else
+				bool isDelta = false;
+				int index = Wire.DeltaValues ? PropertyData::ReadDeltaHeader(reader, isDelta) : reader.ReadByte();
+				if (index < 0 || static_cast<size_t>(index) >= inst->Properties.Size())
 					reader.ReadBuffer(nullptr);
+				else if (Wire.DeltaValues)
+				{
+					PropertyData::Ptr& data = inst->Properties[index];
+					data->UnpackDelta(reader, true, isDelta, data->DeltaBaseline);
+
+					// the first baseline for the entity's state deltas
+					if (data->Descriptor->IsState() && !data->Descriptor->Quantized())
+						states.Values[index].emplace_back(tick, data->DeltaBaseline);
+				}
+				else
+					inst->Properties[index]->UnpackValue(reader, true);
 			}
 
 			EntityInstances.Insert(id, inst);
@@ -113,7 +139,12 @@ namespace EntityNetwork
 				return;
 
 			EntityInstances.Remove(id);
+			EntityStates.erase(id);
 			EntityEvents.Call(EntityEventTypes::EntityRemoved, [&inst](auto func) {func(*inst); });
+
+			EntityInstance::Ptr removed = std::move(*inst);
+			inst.reset();
+			RecycleEntity(removed);
 		}
 
 		void ClientWorld::ProcessAcceptClientAddEntity(MessageBufferReader& reader)
@@ -129,7 +160,7 @@ namespace EntityNetwork
 				DeadLocalEntities.erase(itr);
 				if (remoteID >= 0)// the server accepted it so tell them to remove it
 				{
-					MessageBufferBuilder deleteMesage;
+					MessageBufferBuilder deleteMesage(MessagePool, Wire);
 					deleteMesage.Command = MessageCodes::RemoveEntity;
 					deleteMesage.AddID(remoteID);
 					Send(deleteMesage.Pack());
@@ -166,15 +197,45 @@ namespace EntityNetwork
 		{
 			auto entityID = reader.ReadID();
 			auto inst = EntityInstances.Find(entityID);
+
 			if (entityID < 0 || inst == std::nullopt || !(*inst)->Descriptor->SyncCreate())
 				return;
 
+			if (Wire.BitPackedEntities)
+			{
+				BitStreamReader bits(reader.RemainingData(), reader.RemainingSize());
+				reader.End();
+
+				int count = static_cast<int>((*inst)->Properties.Size());
+				for (int prop = 0; prop < count && !bits.Done(); prop++)
+				{
+					if (!bits.ReadBool())
+						continue;
+
+					PropertyData::Ptr& data = (*inst)->Properties[prop];
+					if (Wire.DeltaValues)
+						data->UnpackBitsDelta(bits, SavePropertyUpdate(*inst, prop), data->DeltaBaseline);
+					else
+						data->UnpackBits(bits, SavePropertyUpdate(*inst, prop));
+					(*inst)->PropertyChanged((*inst)->Properties[prop]);
+				}
+			}
+
 			while (!reader.Done())
 			{
-				int prop = reader.ReadByte();
-				if (prop < 0 || prop >= (*inst)->Properties.Size())
+				bool isDelta = false;
+				int prop = Wire.DeltaValues ? PropertyData::ReadDeltaHeader(reader, isDelta) : reader.ReadByte();
+				if (prop < 0 || static_cast<size_t>(prop) >= (*inst)->Properties.Size())
+				{
+					reader.SkipBuffer();
 					continue;
-				(*inst)->Properties[prop]->UnpackValue(reader, SavePropertyUpdate(*inst,prop));
+				}
+
+				PropertyData::Ptr& data = (*inst)->Properties[prop];
+				if (Wire.DeltaValues)
+					data->UnpackDelta(reader, SavePropertyUpdate(*inst, prop), isDelta, data->DeltaBaseline);
+				else
+					data->UnpackValue(reader, SavePropertyUpdate(*inst,prop));
 
 				(*inst)->PropertyChanged((*inst)->Properties[prop]);
 			}
@@ -182,6 +243,86 @@ namespace EntityNetwork
 			(*inst)->CleanAll();
 		}
 
+		void ClientWorld::ProcessEntityStateChange(MessageBufferReader& reader)
+		{
+			auto entityID = reader.ReadID();
+			tick_t tick = static_cast<tick_t>(reader.ReadID());
+			auto inst = EntityInstances.Find(entityID);
+
+			// counted for the sync's acknowledgement
+			SyncUpdates++;
+			if (inst == std::nullopt)
+				SyncBroken = true;
+
+			if (entityID < 0 || inst == std::nullopt || !(*inst)->Descriptor->SyncCreate())
+				return;
+
+			// sent to a copy of the entity that was removed before this one was added
+			ReceivedStates& states = EntityStates[entityID];
+			if (tick < states.AddedTick)
+				return;
+
+			while (!reader.Done())
+			{
+				bool isDelta = false;
+				int prop = PropertyData::ReadDeltaHeader(reader, isDelta);
+				tick_t age = isDelta ? static_cast<tick_t>(reader.ReadVarInt()) : 0;
+				if (prop < 0 || static_cast<size_t>(prop) >= (*inst)->Properties.Size())
+				{
+					reader.SkipBuffer();
+					continue;
+				}
+
+				PropertyData::Ptr& data = (*inst)->Properties[prop];
+				if (!Wire.DeltaValues || data->Descriptor->Quantized())
+				{
+					data->UnpackValue(reader, SavePropertyUpdate(*inst, prop));
+					(*inst)->PropertyChanged(data);
+					continue;
+				}
+
+				// the server only deltas from values this client acked, which are kept here by tick
+				auto& values = states.Values[prop];
+				std::vector<char> value;
+				if (isDelta)
+				{
+					auto baseline = std::find_if(values.begin(), values.end(), [tick, age](auto& v) { return v.first == tick - age; });
+					if (baseline == values.end())
+					{
+						SyncBroken = true;
+						reader.SkipBuffer();
+						continue;
+					}
+					value = baseline->second;
+				}
+
+				// a late update is still a baseline, but doesn't replace a newer value
+				bool newest = values.empty() || values.back().first <= tick;
+				if (!data->UnpackDelta(reader, newest && SavePropertyUpdate(*inst, prop), isDelta, value))
+				{
+					SyncBroken = true;
+					continue;
+				}
+				if (newest)
+					(*inst)->PropertyChanged(data);
+
+				auto at = std::find_if(values.begin(), values.end(), [tick](auto& v) { return v.first >= tick; });
+				if (at != values.end() && at->first == tick)
+					at->second = std::move(value);
+				else
+					values.emplace(at, tick, std::move(value));
+
+				// later deltas refer to a baseline no older than this one, nor older than MaxBaselineAge
+				tick_t oldest = values.back().first > KnownEnityDataset::MaxBaselineAge ? values.back().first - KnownEnityDataset::MaxBaselineAge : 0;
+				if (isDelta)
+					oldest = std::max(oldest, tick - age);
+				while (!values.empty() && values.front().first < oldest)
+					values.pop_front();
+			}
+			EntityEvents.Call(EntityEventTypes::EntityUpdated, [&inst](auto func) {func(*inst); });
+			(*inst)->CleanAll();
+		}
+
 		int64_t ClientWorld::CreateInstance(int entityTypeID)
 		{
 			int64_t id = GetNewEntityLocalID();
@@ -229,14 +370,19 @@ namespace EntityNetwork
 			}
 			else // tell the server that we removed it and sync all other clients
 			{
-				MessageBufferBuilder removeMessage;
+				MessageBufferBuilder removeMessage(MessagePool, Wire);
 				removeMessage.Command = MessageCodes::RemoveEntity;
 				removeMessage.AddID(entityID);
 				Send(removeMessage.Pack());
 			}
 
 			EntityInstances.Remove(entityID);
+			EntityStates.erase(entityID);
 			EntityEvents.Call(EntityEventTypes::EntityRemoved, [&inst](auto func) {func(*inst); });
+
+			EntityInstance::Ptr removed = std::move(*inst);
+			inst.reset();
+			RecycleEntity(removed);
 			return true;
 		}
 
@@ -264,7 +410,7 @@ namespace EntityNetwork
 		{
 			for (auto ptr : NewLocalEntities)	// walk any new entities and send the data for them
 			{
-				MessageBufferBuilder addMsg;
+				MessageBufferBuilder addMsg(MessagePool, Wire);
 				addMsg.Command = MessageCodes::AddEntity;
 				addMsg.AddID(ptr->Descriptor->ID);
 				addMsg.AddID(ptr->ID);
@@ -52,7 +52,7 @@ namespace EntityNetwork
 			if (procPtr == nullptr || procPtr->RPCDefintion.Scope != RemoteProcedureDef::Scopes::ClientToServer)
 				return false;
 
-			MessageBufferBuilder builder;
+			MessageBufferBuilder builder(MessagePool, Wire);
 			builder.Command = MessageCodes::CallRPC;
 			builder.AddInt(index);
 			for (PropertyData::Ptr arg : args)
@@ -115,11 +115,12 @@ namespace EntityNetwork
 
 		ClientWorld::ClientRPCDef::Ptr ClientWorld::GetRPCDef(const std::string& name)
 		{
-			auto procDef = RemoteProcedures.FindFirstMatch([name](ClientRPCDef::Ptr p) {return p->RPCDefintion.Name == name; });
-			if (procDef == std::nullopt)
-				return nullptr;
+			return RPCIndex.Find(name, nullptr);
+		}
 
-			return *procDef;
+		ClientWorld::ClientRPCDef::Ptr ClientWorld::GetRPCDef(NameKey name)
+		{
+			return RPCIndex.Find(name, nullptr);
 		}
 
 		std::vector<PropertyData::Ptr> ClientWorld::GetRPCArgs(int index)
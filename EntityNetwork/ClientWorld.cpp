@@ -22,6 +22,7 @@
 #include "client/ClientWorld.h"
 #include "MutexedMessageBuffer.h"
 #include "EntityDescriptor.h"
+#include "EntityNetwork.h"
 
 namespace EntityNetwork
 {
@@ -29,29 +30,44 @@ namespace EntityNetwork
 	{
 		void ClientWorld::Update()
 		{
-			if (Self == nullptr || EntityControllerProperties.Size() == 0)
+			if (Self == nullptr)
+				return;
+
+			// acks don't wait on the world setup, the server holds its sync history until they come
+			if (AckPending)
+			{
+				MessageBufferBuilder ackMsg(MessagePool, Wire);
+				ackMsg.Command = MessageCodes::Ack;
+				ackMsg.AddID(static_cast<int64_t>(LastReceivedTick));
+				ackMsg.AddInt(static_cast<int>(ReceivedTickBits));
+				ackMsg.AddInt(static_cast<int>(AddsReceived));
+				Send(ackMsg.Pack(), Reliability::UnreliableSequenced);	// a newer ack covers a lost one
+				AckPending = false;
+			}
+
+			if (EntityControllerProperties.Size() == 0)
 				return;
 
 			ProcessLocalEntities();
 
 			std::vector<MessageBuffer::Ptr> pendingMods;
-			MessageBufferBuilder builder;
+			MessageBufferBuilder builder(MessagePool, Wire);
 			builder.Command = MessageCodes::SetControllerPropertyDataValues;
 			for (auto prop : Self->GetDirtyProperties())
 			{
 				if (prop->Descriptor->UpdateFromClient())
 				{
-					builder.AddInt(prop->Descriptor->ID);
 					prop->PackValue(builder);
 				}
-				pendingMods.push_back(builder.Pack());
 			}
+			if (!builder.Empty())
+				pendingMods.push_back(builder.Pack());
 
 			// find all my entities
-			EntityInstances.DoForEachIf([this](int64_t id, EntityInstance::Ptr ent) { return ent->OwnerID == Self->GetID(); }, [&pendingMods](int64_t id, EntityInstance::Ptr myEnt)
+			EntityInstances.DoForEachIf([this](int64_t id, EntityInstance::Ptr ent) { return ent->OwnerID == Self->GetID(); }, [this, &pendingMods](int64_t id, EntityInstance::Ptr myEnt)
 				{
 					// find any dirty properties that we can send to the server
-					MessageBufferBuilder builder;
+					MessageBufferBuilder builder(MessagePool, Wire);
 					builder.Command = MessageCodes::SetEntityDataValues;
 					builder.AddID(myEnt->ID);
 
@@ -77,14 +93,44 @@ namespace EntityNetwork
 
 			for (auto msg : pendingMods)
 				Send(msg);
+
+			Self->OutboundMessages.Coalesce(MessagePool, MaxBatchSize);
 		}
 
 		void ClientWorld::AddInboundData(MessageBuffer::Ptr message)
 		{
-			MessageBufferReader reader(message);
+			MessageBufferReader reader(message, Wire);
+			ProcessMessage(reader);
+		}
+
+		void ClientWorld::ProcessMessage(MessageBufferReader& reader)
+		{
+			// a build with other messages, anything read from it would be garbage
+			if (CurrentState == StateEventTypes::ProtocolMismatch)
+				return;
 
 			switch (reader.Command)
 			{
+			case MessageCodes::Batch:
+				// a HailCheck is never batched, so every message here uses the format it announced
+				while (!reader.Done())
+				{
+					MessageBufferReader message = reader.ReadBatchedMessage(Wire);
+					if (message.Message != nullptr)
+						ProcessMessage(message);
+				}
+				break;
+
+			case MessageCodes::HailCheck:
+				if (reader.ReadString() != PROTOCOL_HEADER)
+				{
+					CurrentState = StateEventTypes::ProtocolMismatch;
+					StateEvents.Call(StateEventTypes::ProtocolMismatch, [](auto func) {func(StateEventTypes::ProtocolMismatch); });
+					break;
+				}
+				Wire = WireFormat::FromFlags(reader.ReadByte());
+				break;
+
 			case MessageCodes::AddWordDataDef:
 			case MessageCodes::AddControllerPropertyDef:
 			case MessageCodes::AddRPCDef:
@@ -148,12 +194,47 @@ namespace EntityNetwork
 				ProcessEntityDataChange(reader);
 				break;
 
+			case MessageCodes::SetEntityStateValues:
+				ProcessEntityStateChange(reader);
+				break;
+
+			case MessageCodes::SyncTick:
+				ProcessSyncTick(reader);
+				break;
+
 			case MessageCodes::NoOp:
 			default:
 				break;
 			}
 		}
 
+		void ClientWorld::ProcessSyncTick(MessageBufferReader& reader)
+		{
+			tick_t tick = static_cast<tick_t>(reader.ReadID());
+			int updates = reader.ReadInt();
+
+			// anything missing or not applied and the sync isn't acked, the server sends it again
+			bool whole = updates == SyncUpdates && !SyncBroken;
+			SyncUpdates = 0;
+			SyncBroken = false;
+			if (!whole || tick == 0)
+				return;
+
+			if (tick > LastReceivedTick)
+			{
+				tick_t shift = tick - LastReceivedTick;
+				if (LastReceivedTick == 0 || shift > 32)
+					ReceivedTickBits = 0;
+				else
+					ReceivedTickBits = (shift == 32 ? 0 : ReceivedTickBits << shift) | (1u << (shift - 1));
+				LastReceivedTick = tick;
+			}
+			else if (tick < LastReceivedTick && LastReceivedTick - tick <= 32)
+				ReceivedTickBits |= 1u << (LastReceivedTick - tick - 1);
+
+			AckPending = true;
+		}
+
 		MessageBuffer::Ptr ClientWorld::PopOutboundData()
 		{
 			if (Self == nullptr)
@@ -162,12 +243,20 @@ namespace EntityNetwork
 			return Self->OutboundMessages.Pop();
 		}
 
-		void ClientWorld::Send(MessageBuffer::Ptr message)
+		MessageBuffer::Ptr ClientWorld::PopOutboundData(Reliability reliability)
+		{
+			if (Self == nullptr)
+				return nullptr;
+
+			return Self->OutboundMessages.Pop(reliability);
+		}
+
+		void ClientWorld::Send(MessageBuffer::Ptr message, Reliability reliability)
 		{
 			if (Self == nullptr)
 				return;
 
-			Self->OutboundMessages.Push(message);
+			Self->OutboundMessages.Push(message, reliability);
 		}
 
 		ClientEntityController::Ptr ClientWorld::PeerFromID(int64_t id)
@@ -193,12 +282,13 @@ namespace EntityNetwork
 
 			if (reader.Command == MessageCodes::AddControllerPropertyDef)
 			{
+				Schema::ControllerPropertyDef def;
+				if (!reader.ReadFixed(def))
+					return;
+
 				PropertyDesc::Ptr desc = PropertyDesc::Make();
-				desc->ID = reader.ReadInt();
+				def.Apply(*desc);
 				desc->Name = reader.ReadString();
-				desc->DataType = static_cast<PropertyDesc::DataTypes>(reader.ReadByte());
-				desc->Scope = static_cast<PropertyDesc::Scopes>(reader.ReadByte());
-				desc->Private = reader.ReadBool();
 
 				RegisterControllerPropertyDesc(desc);
 				if (Self != nullptr)	// if we are connected, fix all the other peers
@@ -210,25 +300,32 @@ namespace EntityNetwork
 			}
 			else if (reader.Command == MessageCodes::AddWordDataDef)
 			{
+				Schema::WorldDataDef def;
+				if (!reader.ReadFixed(def))
+					return;
+
 				PropertyDesc::Ptr desc = PropertyDesc::Make();
-				desc->ID = reader.ReadInt();
+				def.Apply(*desc);
 				desc->Name = reader.ReadString();
-				desc->DataType = static_cast<PropertyDesc::DataTypes>(reader.ReadByte());
 
 				RegisterWorldPropertyDesc(desc);
 				PropertyEvents.Call(PropertyEventTypes::WorldPropertyDefAdded, [&desc](auto func) {func(nullptr, desc->ID); });
 			}
 			else if (reader.Command == MessageCodes::AddRPCDef)
 			{
+				Schema::RPCDef def;
+				if (!reader.ReadFixed(def))
+					return;
+
 				ClientRPCDef::Ptr desc = std::make_shared<ClientRPCDef>();
-				desc->RPCDefintion.ID = reader.ReadInt();
+				def.Apply(desc->RPCDefintion);
 				desc->RPCDefintion.Name = reader.ReadString();
-				desc->RPCDefintion.Scope = static_cast<RemoteProcedureDef::Scopes>(reader.ReadByte());
 
-				while (!reader.Done())
+				for (int i = 0; i < def.ArgumentCount && !reader.Done(); i++)
 					desc->RPCDefintion.DefineArgument(static_cast<PropertyDesc::DataTypes>(reader.ReadByte()));
 
 				RemoteProcedures.PushBack(desc);
+				RPCIndex.Add(desc->RPCDefintion.Name, desc);
 
 				// check to see if there is a cached function that was mapped to the name before we connected and got the definition.
 				std::map<std::string, ClientRPCFunction>::iterator itr = CacheedRPCFunctions.find(desc->RPCDefintion.Name);
@@ -242,22 +339,27 @@ namespace EntityNetwork
 			}
 			else if (reader.Command == MessageCodes::AddEntityDef)
 			{
+				Schema::EntityDef entityDef;
+				if (!reader.ReadFixed(entityDef))
+					return;
+
 				EntityDesc::Ptr	 def = EntityDesc::Make();
-				def->ID = reader.ReadInt();
+				entityDef.Apply(*def);
 				def->Name = reader.ReadString();
-				def->IsAvatar = reader.ReadBool();
-				def->CreateScope = static_cast<EntityDesc::CreateScopes>(reader.ReadByte());
-				while (!reader.Done())
+				for (int i = 0; i < entityDef.PropertyCount; i++)
 				{
+					Schema::EntityPropertyDef propDef;
+					if (!reader.ReadFixed(propDef))
+						break;
+
 					PropertyDesc::Ptr prop = PropertyDesc::Make();
-					prop->ID = reader.ReadInt();
-					prop->Scope = static_cast<PropertyDesc::Scopes>(reader.ReadByte());
+					propDef.Apply(*prop);
 					prop->Name = reader.ReadString();
-					prop->DataType = static_cast<PropertyDesc::DataTypes>(reader.ReadByte());
 					def->AddPropertyDesc(prop);
 				}
 
 				EntityDefs.Insert(def->ID, def);
+				EntityDefIndex.Add(def->Name, def);
 
 				auto itr = PendingEntityFactories.find(def->Name);
 				if (itr != PendingEntityFactories.end())
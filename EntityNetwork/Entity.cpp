@@ -23,18 +23,95 @@
 
 namespace EntityNetwork
 {
-	EntityInstance::EntityInstance(EntityDesc::Ptr desc) : Descriptor(desc)
+	EntityInstance::EntityInstance(EntityDesc::Ptr desc) : Descriptor(desc), ChangedMask((desc->Properties.size() + 63) / 64)
 	{
 		for (auto& prop : Descriptor->Properties)
 		{
-			Properties.PushBack(PropertyData::MakeShared(prop));
+			auto data = PropertyData::MakeShared(prop);
+			data->ChangeListener = [this](int id) { PropertyDirty(id); };
+			Properties.PushBack(data);
+		}
+
+		AttachStore();
+	}
+
+	EntityInstance::~EntityInstance()
+	{
+		// properties can be held past the entity, detach them and give them their value back before the slot is reused
+		Properties.DoForEach([](PropertyData::Ptr prop) { prop->ChangeListener = nullptr; });
+		DetachStore();
+	}
+
+	void EntityInstance::AttachStore()
+	{
+		Store = Descriptor->Store;
+		if (Store == nullptr)
+			return;
+
+		StoreSlot = Store->Allocate();
+		for (auto& prop : Properties.GetExclusiveAccess())
+			prop->BindStorage(Store->GetValue(prop->Descriptor->ID, StoreSlot));
+		Properties.ReleaseExclusiveAccess();
+	}
+
+	void EntityInstance::DetachStore()
+	{
+		if (Store == nullptr)
+			return;
+
+		for (auto& prop : Properties.GetExclusiveAccess())
+			prop->UnbindStorage();
+		Properties.ReleaseExclusiveAccess();
+
+		Store->Release(StoreSlot);
+		Store = nullptr;
+	}
+
+	void EntityInstance::Recycle()
+	{
+		ID = InvalidID;
+		OwnerID = InvalidID;
+		ChangeQueued = nullptr;
+
+		// pooled instances don't hold a column slot, they take a new one when handed out
+		DetachStore();
+		Properties.DoForEach([](PropertyData::Ptr prop) { prop->Reset(); });
+
+		std::vector<int> discard;
+		TakeChangedProperties(discard);
+	}
+
+	void EntityInstance::PropertyDirty(int propertyID)
+	{
+		if (propertyID < 0 || static_cast<size_t>(propertyID) / 64 >= ChangedMask.size())
+			return;
+
+		ChangedMask[propertyID / 64].fetch_or(uint64_t(1) << (propertyID % 64), std::memory_order_release);
+
+		if (!Queued.exchange(true, std::memory_order_acq_rel) && ChangeQueued)
+			ChangeQueued(this);
+	}
+
+	void EntityInstance::TakeChangedProperties(std::vector<int>& ids)
+	{
+		// clear the queued flag first, a change that lands after it queues the entity again instead of being lost
+		Queued.store(false, std::memory_order_release);
+
+		for (size_t word = 0; word < ChangedMask.size(); word++)
+		{
+			uint64_t bits = ChangedMask[word].exchange(0, std::memory_order_acq_rel);
+			for (int bit = 0; bits != 0; bit++, bits >>= 1)
+			{
+				if (bits & 1)
+					ids.push_back(static_cast<int>(word * 64 + bit));
+			}
 		}
 	}
 
 	bool EntityInstance::Dirty()
 	{
 		bool dirty = false;
-		Properties.DoForEach([&dirty](PropertyData::Ptr ptr) {if (ptr->IsDirty()) dirty = false; });
+		Properties.DoForEach([&dirty](PropertyData::Ptr ptr) {if (ptr->IsDirty()) dirty = true; });
 		return dirty;
 	}
 
@@ -45,14 +122,17 @@ namespace EntityNetwork
 
 	std::vector<PropertyData::Ptr> EntityInstance::GetDirtyProperties(KnownEnityDataset& knownSet)
 	{
-		int index = 0;
+		return GetChangedSince(knownSet.LastSyncedTick);
+	}
+
+	std::vector<PropertyData::Ptr> EntityInstance::GetChangedSince(tick_t tick)
+	{
 		std::vector<PropertyData::Ptr> dirtyList;
 
-		Properties.DoForEach([&index, &dirtyList, &knownSet](PropertyData::Ptr ptr) 
+		Properties.DoForEach([&dirtyList, tick](PropertyData::Ptr ptr) 
 			{
-				if (index >= knownSet.DataRevisions.size() || knownSet.DataRevisions[index] != ptr->GetRevision())
+				if (ptr->GetChangeTick() > tick)
 					dirtyList.push_back(ptr);
-				index++;
 			});
 
 		return dirtyList;
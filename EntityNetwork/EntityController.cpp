@@ -40,11 +40,12 @@ namespace EntityNetwork
 
 	PropertyData::Ptr EntityController::FindPropertyByName(const std::string& name)
 	{
-		auto prop = Properties.FindFirstMatch([&name](PropertyData::Ptr p) {return p->Descriptor->Name == name; });
-		if (prop != std::nullopt)
-			return *prop;
+		return PropertyIndex.Find(name, nullptr);
+	}
 
-		return nullptr;
+	PropertyData::Ptr EntityController::FindPropertyByName(NameKey name)
+	{
+		return PropertyIndex.Find(name, nullptr);
 	}
 
 	void EntityController::SetPropertyInfo(MutexedVector<PropertyDesc::Ptr>& propertyDecriptors)
@@ -67,6 +68,10 @@ namespace EntityNetwork
 			});
 
 		Properties.Replace(newProps);
+
+		PropertyIndex.Clear();
+		for (auto& prop : newProps)
+			PropertyIndex.Add(prop->Descriptor->Name, prop);
 	}
 
 	std::vector<PropertyData::Ptr> EntityController::GetDirtyProperties()
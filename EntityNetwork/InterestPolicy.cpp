@@ -0,0 +1,72 @@
+//  Copyright (c) 2020 Jeffery Myers
+//
+//	EntityNetwork and its associated sub proejcts are free software;
+//
+//	Permission is hereby granted, free of charge, to any person obtaining a copy
+//	of this software and associated documentation files (the "Software"), to deal
+//	in the Software without restriction, including without limitation the rights
+//	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//	copies of the Software, and to permit persons to whom the Software is
+//	furnished to do so, subject to the following conditions:
+//	
+//	The above copyright notice and this permission notice shall be included in all
+//	copies or substantial portions of the Software.
+//	
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//	SOFTWARE.
+#include "server/ServerWorld.h"
+#include "server/InterestPolicy.h"
+
+namespace EntityNetwork
+{
+	namespace Server
+	{
+		bool SpatialInterest::UpdatePeer(ServerEntityController& peer, const WorldSnapshot& snapshot)
+		{
+			auto center = std::dynamic_pointer_cast<Center>(peer.InterestState);
+			if (center == nullptr)
+			{
+				center = std::make_shared<Center>();
+				peer.InterestState = center;
+			}
+
+			float position[3] = { 0, 0, 0 };
+			bool hasAvatar = false;
+			auto avatar = Avatars.find(peer.GetID());
+			if (avatar != Avatars.end())
+			{
+				EntitySnapshot::Ptr entity = snapshot.Find(avatar->second);
+				hasAvatar = entity != nullptr && GetPosition(*entity, position);
+			}
+
+			bool changed = hasAvatar != center->HasAvatar || (hasAvatar && ViewChanged(center->Viewed, position));
+			center->HasAvatar = hasAvatar;
+			for (int i = 0; i < 3; i++)
+			{
+				center->Position[i] = position[i];
+				if (changed)
+					center->Viewed[i] = position[i];
+			}
+			return changed;
+		}
+
+		// UpdatePeer runs before anything else for a peer, so the state is always ours here
+		const SpatialInterest::Center* SpatialInterest::GetCenter(ServerEntityController& peer) const
+		{
+			auto center = static_cast<const Center*>(peer.InterestState.get());
+			if (center == nullptr || !center->HasAvatar)
+				return nullptr;
+			return center;
+		}
+
+		bool SpatialInterest::IsOwner(ServerEntityController& peer, const EntitySnapshot& entity) const
+		{
+			return entity.OwnerID == peer.GetID();
+		}
+	}
+}
@@ -57,9 +57,10 @@ namespace EntityNetwork
 
 			// setup any data and properties
 
-			MessageBufferBuilder hail;
+			MessageBufferBuilder hail(MessagePool); // always in the default format so any client can read it
 			hail.Command = MessageCodes::HailCheck;
 			hail.AddString(PROTOCOL_HEADER);
+			hail.AddByte(Wire.ToFlags());
 			Send(ctl, hail);
 
 			// RPC defs
@@ -67,13 +68,13 @@ namespace EntityNetwork
 
 			// send world data
 			Send(ctl, WorldPropertyDefCache);
-			MessageBufferBuilder worldDataUpdates;
+			MessageBufferBuilder worldDataUpdates(MessagePool, Wire);
 			worldDataUpdates.Command = MessageCodes::SetWorldDataValues;
 			WorldProperties.DoForEach([&worldDataUpdates](PropertyData::Ptr prop) {prop->PackValue(worldDataUpdates); });
 			if (!worldDataUpdates.Empty())
 				Send(ctl, worldDataUpdates);
 
-			Send(ctl, MessageBufferBuilder(MessageCodes::InitalWorldDataComplete).Pack());
+			Send(ctl, MessageBufferBuilder(MessagePool, MessageCodes::InitalWorldDataComplete).Pack());
 
 			// entity data
 			Send(ctl, EntityDefCache);
@@ -83,7 +84,7 @@ namespace EntityNetwork
 			
 
 			// tell the owner they were accepted and what there ID is.
-			MessageBufferBuilder builder;
+			MessageBufferBuilder builder(MessagePool, Wire);
 			builder.Command = MessageCodes::AcceptController;
 			builder.AddID(id);
 			Send(ctl, builder);
@@ -158,7 +159,7 @@ namespace EntityNetwork
 			ControllerEvents.Call(ControllerEventTypes::Destroyed, [entPtr](auto func) {func(entPtr); });
 
 			// tell everyone about the removal
-			MessageBufferBuilder builder;
+			MessageBufferBuilder builder(MessagePool, Wire);
 			builder.Command = MessageCodes::RemoveController;
 			builder.AddID(entPtr->GetID());
 			SendToAll(builder.Pack());
@@ -169,13 +170,10 @@ namespace EntityNetwork
 			if (desc == nullptr || !desc->TransmitDef())
 				return nullptr;
 
-			MessageBufferBuilder builder;
+			MessageBufferBuilder builder(MessagePool, Wire);
 			builder.Command = MessageCodes::AddControllerPropertyDef;
-			builder.AddInt(desc->ID);
+			builder.AddFixed(Schema::ControllerPropertyDef::From(*desc));
 			builder.AddString(desc->Name);
-			builder.AddByte(static_cast<int>(desc->DataType));
-			builder.AddByte(static_cast<int>(desc->Scope));
-			builder.AddBool(desc->Private);
 			auto msg = builder.Pack();
 			ControllerPropertyCache.PushBack(msg);
 
@@ -186,7 +184,7 @@ namespace EntityNetwork
 		{
 			while (!reader.Done())
 			{
-				int propertyID = reader.ReadInt();
+				int propertyID = reader.ReadByte();
 				auto prop = peer->FindPropertyByID(propertyID);
 				if (prop == nullptr)
 					reader.End();
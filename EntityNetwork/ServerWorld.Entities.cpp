@@ -29,10 +29,21 @@ namespace EntityNetwork
 
 		EntityInstance::Ptr ServerWorld::NewEntityInstance(EntityDesc::Ptr desc, int64_t id)
 		{
-			auto facItr = EntityFactories.find(desc->ID);
-			if (facItr != EntityFactories.end())
-				return facItr->second(desc, id);
-			return CreateEntityInstance(desc, id);
+			EntityInstance::Ptr ent = TakePooledEntity(desc);
+			if (ent != nullptr)
+				ent->SetID(id);
+			else
+			{
+				auto facItr = EntityFactories.find(desc->ID);
+				if (facItr != EntityFactories.end())
+					ent = facItr->second(desc, id);
+				else
+					ent = CreateEntityInstance(desc, id);
+			}
+
+			if (ent != nullptr)
+				ent->ChangeQueued = [this](EntityInstance* changed) { ChangedEntities.PushBack(changed->ID); };
+			return ent;
 		}
 
 		void ServerWorld::RegisterEntityFactory(int64_t id, EntityInstance::CreateFunction function)
@@ -52,10 +63,11 @@ namespace EntityNetwork
 
 		int ServerWorld::RegisterEntityDesc(EntityDesc::Ptr desc)
 		{
-			if (desc == nullptr)
+			if (desc == nullptr || desc->Properties.size() > Schema::EntityDef::MaxProperties)
 				return -1;
 			desc->ID = static_cast<int>(EntityDefs.Size());
 			EntityDefs.Insert(desc->ID, desc);
+			EntityDefIndex.Add(desc->Name, desc);
 
 			SendToAll(BuildEntityDefMessage(desc->ID));
 
@@ -94,18 +106,16 @@ namespace EntityNetwork
 			if (def == nullptr)
 				return nullptr;
 
-			MessageBufferBuilder builder;
+			MessageBufferBuilder builder(MessagePool, Wire);
 			builder.Command = MessageCodes::AddEntityDef;
-			builder.AddInt(index);
+			Schema::EntityDef entityDef = Schema::EntityDef::From(*def);
+			entityDef.ID = index;
+			builder.AddFixed(entityDef);
 			builder.AddString(def->Name);
-			builder.AddBool(def->IsAvatar);
-			builder.AddByte(static_cast<int>(def->CreateScope));
 			for (auto& prop : def->Properties)
 			{
-				builder.AddInt(prop->ID);
-				builder.AddByte(static_cast<int>(prop->Scope));
+				builder.AddFixed(Schema::EntityPropertyDef::From(*prop));
 				builder.AddString(prop->Name);
-				builder.AddByte(static_cast<int>(prop->DataType));
 			}
 
 			auto msg = builder.Pack();
@@ -120,9 +130,10 @@ namespace EntityNetwork
 			if (entDef == nullptr || !entDef->AllowServerCreate()) // invalid or client only create
 				return EntityInstance::InvalidID;
 
-			EntityInstance::Ptr ent = NewEntityInstance(entDef, EntityInstances.Size());
+			EntityInstance::Ptr ent = NewEntityInstance(entDef, NextEntityID++);
 			ent->OwnerID = ownerID;
 			EntityInstances.Insert(ent->ID, ent);
+			AddedEntities.PushBack(ent->ID);
 
 			if (setupCallback != nullptr)
 				setupCallback(ent);
@@ -148,18 +159,15 @@ namespace EntityNetwork
 				return false;
 
 			EntityInstances.Remove(entityID);
+			(*ent)->ChangeQueued = nullptr;
 			EntityEvents.Call(EntityEventTypes::EntityRemoved, [&ent](auto func) {func(*ent); });
 
-			MessageBufferBuilder removeMsg;
-			removeMsg.Command = MessageCodes::RemoveEntity;
-			removeMsg.AddID(entityID);
-			SendToAll(removeMsg.Pack());
+			// replication sends the remove in order with the entity's other messages, peers that know it drop it then
+			RemovedEntities.PushBack(entityID);
 
-			// purge the known entity from the list so we don't try to keep sending it data
-			RemoteEnitityControllers.DoForEach([entityID](auto& key, ServerEntityController::Ptr& peer)
-				{
-					peer->KnownEnitities.Remove(entityID);
-				});
+			EntityInstance::Ptr removed = std::move(*ent);
+			ent.reset();
+			RecycleEntity(removed);
 			return true;
 		}
 
@@ -171,7 +179,7 @@ namespace EntityNetwork
 			auto entDef = GetEntityDef(entityTypeID);
 			if (entDef == nullptr || !entDef->AllowClientCreate() || !entDef->SyncCreate()) // invalid or server only create
 			{
-				MessageBufferBuilder denyMessage;
+				MessageBufferBuilder denyMessage(MessagePool, Wire);
 				denyMessage.Command = MessageCodes::AcceptClientEntity;
 				denyMessage.AddID(-1);
 				denyMessage.AddID(localID);
@@ -179,7 +187,7 @@ namespace EntityNetwork
 				return;
 			}
 
-			EntityInstance::Ptr ent = NewEntityInstance(entDef, EntityInstances.Size());
+			EntityInstance::Ptr ent = NewEntityInstance(entDef, NextEntityID++);
 			ent->OwnerID = peer->ID;
 
 			int index = 0;
@@ -193,23 +201,37 @@ namespace EntityNetwork
 				index++;
 			}
 			EntityInstances.Insert(ent->ID, ent);
+			AddedEntities.PushBack(ent->ID);
 			ent->Created();
 			EntityEvents.Call(EntityEventTypes::EntityAdded, [&ent](auto func) {func(ent); });
 			
 			// send back the acceptance
-			MessageBufferBuilder ackMsg;
+			MessageBufferBuilder ackMsg(MessagePool, Wire);
 			ackMsg.Command = MessageCodes::AcceptClientEntity;
 			ackMsg.AddID(ent->ID);
 			ackMsg.AddID(localID);
 			Send(peer, ackMsg);
 			EntityEvents.Call(EntityEventTypes::EntityAccepted, [&ent](auto func) {func(ent); });
 
-			// they aways know about this revision, they added the thing. This prevents us from sending the item back to them as an add. The accept message handles that for this client.
+			// they aways know about this version, they added the thing. This prevents us from sending the item back to them as an add. The accept message handles that for this client.
 			KnownEnityDataset& dataset = peer->KnownEnitities.Insert(ent->ID, KnownEnityDataset());
-			ent->Properties.DoForEach([&dataset](PropertyData::Ptr prop)
-				{
-					dataset.DataRevisions.push_back(prop->GetRevision());
-				});
+			dataset.LastSyncedTick = CurrentTick;
+
+			// the values it was sent with are not changes, everyone else gets them in the add
+			std::vector<int> unpacked;
+			ent->TakeChangedProperties(unpacked);
+		}
+
+		void ServerWorld::ProcessAck(ServerEntityController::Ptr peer, MessageBufferReader& reader)
+		{
+			ServerEntityController::ReceivedAck ack;
+			ack.Tick = static_cast<tick_t>(reader.ReadID());
+			ack.Bits = static_cast<uint32_t>(reader.ReadInt());
+			ack.Adds = static_cast<uint32_t>(reader.ReadInt());
+
+			// applied by the peer's next sync, replication owns the sent sync records
+			if (ack.Tick > 0 || ack.Adds > 0)
+				peer->ReceivedAcks.PushBack(ack);
 		}
 
 		void ServerWorld::ProcessClientEntityRemove(ServerEntityController::Ptr peer, MessageBufferReader& reader)
@@ -242,72 +264,693 @@ namespace EntityNetwork
 			EntityEvents.Call(EntityEventTypes::EntityUpdated, [&ent](auto func) {func(*ent); });
 		}
 
-		/*
-		Future logic, check avatar entities to see what is near and add them as known entities, remove items outside of range.
-		Then just update known entities for each controller
-		*/
+		void ServerWorld::PackEntityUpdate(MessageBufferBuilder& builder, const std::vector<PropertyData::Ptr>& properties, BitStreamWriter& bits, KnownEnityDataset& known)
+		{
+			if (Wire.DeltaValues)
+			{
+				for (auto p : properties)
+				{
+					if (static_cast<size_t>(p->Descriptor->ID) >= known.SentValues.size())
+						known.SentValues.resize(p->Descriptor->ID + 1);
+				}
+			}
+
+			if (!Wire.BitPackedEntities)
+			{
+				for (auto p : properties)
+				{
+					if (Wire.DeltaValues)
+						p->PackDelta(builder, known.SentValues[p->Descriptor->ID]);
+					else
+						p->PackValue(builder);
+				}
+				return;
+			}
+
+			// one changed bit per property up to the last one sent, followed by the value for changed ones
+			bits.Reset();
+			int next = 0;
+			for (auto p : properties)
+			{
+				for (; next < p->Descriptor->ID; next++)
+					bits.WriteBool(false);
+
+				bits.WriteBool(true);
+				if (Wire.DeltaValues)
+					p->PackBitsDelta(bits, known.SentValues[p->Descriptor->ID]);
+				else
+					p->PackBits(bits);
+				next++;
+			}
+			builder.AddBytes(bits.Data.data(), bits.ByteSize());
+		}
+
+		// each value has a varint header of its ID shifted up one, the low bit set when the baseline's age in ticks and a delta from it follow.
+		// with DeltaValues the baseline is the newest value the peer acked, quantized values and everything else go whole
+		void ServerWorld::PackStateUpdate(MessageBufferBuilder& builder, const std::vector<PropertyData::Ptr>& properties, KnownEnityDataset& known, tick_t tick)
+		{
+			static thread_local std::vector<char> delta;
+			for (auto p : properties)
+			{
+				size_t id = static_cast<size_t>(p->Descriptor->ID);
+				if (!Wire.DeltaValues || p->Descriptor->Quantized())
+				{
+					builder.AddVarInt(static_cast<uint64_t>(id) << 1);
+					p->PackData(builder);
+					continue;
+				}
+
+				if (id >= known.SentStates.size())
+					known.SentStates.resize(id + 1);
+				auto& states = known.SentStates[id];
+
+				auto baseline = std::find_if(states.rbegin(), states.rend(), [](const KnownEnityDataset::SentState& state) { return state.Acked; });
+				bool useDelta = baseline != states.rend() && tick - baseline->Tick <= KnownEnityDataset::MaxBaselineAge
+					&& PropertyDelta::Encode(p->Descriptor->DataType, p->DataPtr, p->DataLenght, baseline->Value, delta) && delta.size() < p->DataLenght;
+
+				builder.AddVarInt((static_cast<uint64_t>(id) << 1) | (useDelta ? 1 : 0));
+				if (useDelta)
+				{
+					builder.AddVarInt(tick - baseline->Tick);
+					builder.AddBuffer(delta.data(), delta.size());
+				}
+				else
+					p->PackData(builder);
+
+				// the client only keeps baselines as old as MaxBaselineAge
+				states.erase(std::remove_if(states.begin(), states.end(), [tick](const KnownEnityDataset::SentState& state) { return tick - state.Tick > KnownEnityDataset::MaxBaselineAge; }), states.end());
+				states.emplace_back();
+				states.back().Tick = tick;
+				states.back().Value.assign(static_cast<char*>(p->DataPtr), static_cast<char*>(p->DataPtr) + p->DataLenght);
+			}
+		}
+
+		size_t ServerWorld::SendEntityAdd(ServerEntityController::Ptr peer, const EntitySnapshot& entity, tick_t tick)
+		{
+			MessageBufferBuilder addMsg(MessagePool, Wire);
+			addMsg.Command = MessageCodes::AddEntity;
+			addMsg.AddID(entity.ID);
+			addMsg.AddInt(entity.Descriptor->ID);
+			addMsg.AddID(entity.OwnerID);
+			addMsg.AddID(static_cast<int64_t>(tick));	// state updates from before it were for an earlier copy
+
+			KnownEnityDataset& dataset = peer->KnownEnitities.Insert(entity.ID, KnownEnityDataset());
+			dataset.LastSyncedTick = tick;
+			dataset.AddedTick = tick;
+			dataset.AddSequence = ++peer->AddsSent;
+			dataset.SentTicks.assign(entity.Properties.size(), tick);
+			for (auto& prop : entity.Properties)
+			{
+				// always pack all values when the server sends an entity
+				if (Wire.DeltaValues)
+				{
+					dataset.SentValues.emplace_back();
+					prop->PackDelta(addMsg, dataset.SentValues.back());
+				}
+				else
+					prop->PackValue(addMsg);
+
+				// the add is reliable, its state values are the first baselines
+				if (Wire.DeltaValues && prop->Descriptor->IsState() && !prop->Descriptor->Quantized())
+				{
+					size_t p = static_cast<size_t>(prop->Descriptor->ID);
+					if (p >= dataset.SentStates.size())
+						dataset.SentStates.resize(p + 1);
+					dataset.SentStates[p].emplace_back();
+					dataset.SentStates[p].back().Tick = tick;
+					dataset.SentStates[p].back().Acked = true;
+					dataset.SentStates[p].back().Value = dataset.SentValues.back();
+				}
+			}
+
+			MessageBuffer::Ptr message = addMsg.Pack();
+			Send(peer, message);
+			return message->MessageLenght;
+		}
+
+		size_t ServerWorld::SendEntityUpdate(ServerEntityController::Ptr peer, int64_t entityID, const std::vector<PropertyData::Ptr>& properties, BitStreamWriter& bits, KnownEnityDataset& known, tick_t tick)
+		{
+			// state values go in EntityUpdateReliability once the peer has the add, so they can't get there before it.
+			// everything else goes in order behind the add
+			bool confirmed = EntityUpdateReliability == Reliability::ReliableOrdered || known.AddSequence <= peer->AddsAcked;
+
+			static thread_local std::vector<PropertyData::Ptr> ordered;
+			static thread_local std::vector<PropertyData::Ptr> states;
+			ordered.clear();
+			states.clear();
+			bool held = false;
+			for (auto& prop : properties)
+			{
+				if (!prop->Descriptor->IsState())
+				{
+					ordered.push_back(prop);
+					continue;
+				}
+
+				// remember what went in this sync in case it is lost, a held value is picked up like a lost one
+				size_t p = static_cast<size_t>(prop->Descriptor->ID);
+				if (p >= known.SentTicks.size())
+					known.SentTicks.resize(p + 1, tick);
+				known.SentTicks[p] = confirmed ? tick : KnownEnityDataset::LostTick;
+				if (confirmed)
+					states.push_back(prop);
+				else
+					held = true;
+			}
+
+			if (held)
+				peer->PendingEntities.emplace(entityID, 0.0f);
+
+			size_t bytes = 0;
+			if (!ordered.empty())
+			{
+				MessageBufferBuilder updateMsg(MessagePool, Wire);
+				updateMsg.Command = MessageCodes::SetEntityDataValues;
+				updateMsg.AddID(entityID);
+				PackEntityUpdate(updateMsg, ordered, bits, known);
+
+				MessageBuffer::Ptr message = updateMsg.Pack();
+				Send(peer, message);
+				bytes += message->MessageLenght;
+			}
+
+			if (!states.empty())
+			{
+				MessageBufferBuilder stateMsg(MessagePool, Wire);
+				stateMsg.Command = MessageCodes::SetEntityStateValues;
+				stateMsg.AddID(entityID);
+				stateMsg.AddID(static_cast<int64_t>(tick));
+				PackStateUpdate(stateMsg, states, known, tick);
+
+				peer->SentUpdates.emplace_back();
+				peer->SentUpdates.back().Tick = tick;
+				peer->SentUpdates.back().EntityID = entityID;
+
+				MessageBuffer::Ptr message = stateMsg.Pack();
+				Send(peer, message, EntityUpdateReliability);
+				bytes += message->MessageLenght;
+			}
+			return bytes;
+		}
+
+		void ServerWorld::SendEntityRemove(ServerEntityController::Ptr peer, int64_t entityID)
+		{
+			MessageBufferBuilder removeMsg(MessagePool, Wire);
+			removeMsg.Command = MessageCodes::RemoveEntity;
+			removeMsg.AddID(entityID);
+			Send(peer, removeMsg);
+
+			// purge the known entity from the list so we don't try to keep sending it data
+			peer->KnownEnitities.Remove(entityID);
+			peer->PendingEntities.erase(entityID);
+		}
+
+		// brings the interest policy's index up to the snapshot, true when the policy was replaced since the last one
+		bool ServerWorld::UpdateInterest(const WorldSnapshot& snapshot)
+		{
+			InterestPolicy::Ptr previous = IndexedInterest;
+			tick_t since = InterestTick;
+			IndexedInterest = Interest;
+			InterestTick = snapshot.Tick;
+
+			if (IndexedInterest != previous)
+			{
+				if (previous != nullptr)
+					previous->Clear();
+
+				// a new policy starts with everything
+				if (IndexedInterest != nullptr)
+				{
+					IndexedInterest->Clear();
+					snapshot.DoForEach([this](const EntitySnapshot::Ptr& entity) { IndexedInterest->EntityAdded(*entity); });
+				}
+				return true;
+			}
+
+			if (IndexedInterest != nullptr)
+			{
+				// only entities that were added, removed or moved since the last snapshot
+				std::vector<ChangeJournal::Record> records;
+				Journal.CollectSince(since, snapshot.Tick, records);
+				for (auto& record : records)
+				{
+					EntitySnapshot::Ptr entity = snapshot.Find(record.EntityID);
+					if (entity == nullptr)
+						IndexedInterest->EntityRemoved(record.EntityID);
+					else if (record.PropertyID == ChangeJournal::EntityAdded)
+						IndexedInterest->EntityAdded(*entity);
+					else if (record.PropertyID == entity->Descriptor->PositionProperty)
+						IndexedInterest->EntityMoved(*entity);
+				}
+			}
+			return false;
+		}
+
+		bool ServerWorld::IsInterested(ServerEntityController::Ptr peer, const EntitySnapshot& entity, bool entering)
+		{
+			return IndexedInterest == nullptr || IndexedInterest->IsInterested(*peer, entity, entering);
+		}
+
+		WorldSnapshot::Ptr ServerWorld::CaptureSnapshot()
+		{
+			CurrentTick++;
+
+			// journal what changed, was created and was removed since the last update, peers read it from the tick they were last synced at
+			Journal.BeginTick(CurrentTick);
+
+			// the new snapshot shares everything with the last one, only the entities touched below are copied
+			auto snapshot = LastSnapshot->Next(CurrentTick);
+
+			std::vector<int64_t> removedIDs;
+			RemovedEntities.Swap(removedIDs);
+			for (int64_t id : removedIDs)
+			{
+				Journal.Append(id, ChangeJournal::EntityRemoved);
+				snapshot->Erase(id);
+			}
+
+			std::vector<int64_t> changedIDs;
+			ChangedEntities.Swap(changedIDs);
+
+			std::vector<int> propertyIDs;
+			for (int64_t id : changedIDs)
+			{
+				EntityInstance::Ptr* entity = EntityInstances.TryGet(id);
+				if (entity == nullptr || !EntityInstance::CanSyncFunc(id, *entity))
+					continue;
+
+				propertyIDs.clear();
+				(*entity)->TakeChangedProperties(propertyIDs);
+				for (int propertyID : propertyIDs)
+				{
+					auto prop = (*entity)->Properties.TryGet(propertyID);
+					if (prop == nullptr)
+						continue;
+
+					(*prop)->StampChange(CurrentTick);
+					if ((*prop)->Descriptor->TransmitDef())
+						Journal.Append(id, propertyID);
+				}
+
+				// copied after stamping so the snapshot carries the change ticks
+				auto previous = snapshot->Find(id);
+				if (previous == nullptr)
+					snapshot->Set(EntitySnapshot::Make(**entity));
+				else
+					snapshot->Set(EntitySnapshot::Update(*previous, **entity, propertyIDs));
+			}
+
+			// new entities are copied whole, after their setup changes were stamped above
+			std::vector<int64_t> addedIDs;
+			AddedEntities.Swap(addedIDs);
+			for (int64_t id : addedIDs)
+			{
+				Journal.Append(id, ChangeJournal::EntityAdded);
+
+				EntityInstance::Ptr* entity = EntityInstances.TryGet(id);
+				if (entity != nullptr && EntityInstance::CanSyncFunc(id, *entity) && snapshot->Find(id) == nullptr)
+					snapshot->Set(EntitySnapshot::Make(**entity));
+			}
+
+			LastSnapshot = snapshot;
+			return snapshot;
+		}
+
+		void ServerWorld::ReplicateSnapshot(WorldSnapshot::Ptr snapshot)
+		{
+			// work on a copy of the peer list, so peers can connect and leave while the tasks run
+			std::vector<ServerEntityController::Ptr> peers;
+			RemoteEnitityControllers.DoForEach([&peers](auto& /*key*/, ServerEntityController::Ptr& peer) { peers.push_back(peer); });
+
+			// each peer's task only touches that peer and reads the rest
+			std::map<tick_t, std::vector<ChangeJournal::Record>> pendingSince;
+			std::vector<ChangeJournal::Record> noRecords;
+			std::vector<const std::vector<ChangeJournal::Record>*> peerRecords(peers.size(), &noRecords);
+			std::vector<bool> due(peers.size(), false);
+			bool interestChanged = false;
+
+			if (snapshot != nullptr)
+			{
+				tick_t tick = snapshot->Tick;
+				interestChanged = UpdateInterest(*snapshot);
+
+				tick_t oldestSync = tick;
+				for (size_t i = 0; i < peers.size(); i++)
+				{
+					auto& peer = peers[i];
+					if (peer->EntitiesSynced && tick - peer->LastSyncedTick < static_cast<tick_t>(std::max(peer->SyncInterval, 1)))
+					{
+						oldestSync = std::min(oldestSync, peer->LastSyncedTick);
+						continue;
+					}
+					due[i] = true;
+
+					// peers synced at the same tick share one read of the journal
+					if (!peer->EntitiesSynced)
+						continue;
+
+					auto pending = pendingSince.find(peer->LastSyncedTick);
+					if (pending == pendingSince.end())
+					{
+						pending = pendingSince.emplace(peer->LastSyncedTick, std::vector<ChangeJournal::Record>()).first;
+						Journal.CollectSince(peer->LastSyncedTick, tick, pending->second);
+					}
+					peerRecords[i] = &pending->second;
+				}
+
+				// every peer has read the segments up to the oldest sync tick once this update is done
+				Journal.Release(oldestSync);
+			}
+
+			auto replicate = [this, &peers, &due, &peerRecords, &snapshot, interestChanged](size_t i)
+			{
+				if (due[i])
+					ReplicatePeer(peers[i], *snapshot, interestChanged, *peerRecords[i]);
+				peers[i]->OutboundMessages.Coalesce(MessagePool, MaxBatchSize);
+			};
+
+			if (ReplicationWorkers != nullptr)
+				ReplicationWorkers->Run(peers.size(), replicate);
+			else
+			{
+				for (size_t i = 0; i < peers.size(); i++)
+					replicate(i);
+			}
+		}
 
-		void ServerWorld::ProcessEntityUpdates()
+		void ServerWorld::ReplicatePeer(ServerEntityController::Ptr peer, const WorldSnapshot& snapshot, bool interestChanged, const std::vector<ChangeJournal::Record>& records)
 		{
-			RemoteEnitityControllers.DoForEach([this](auto& key, ServerEntityController::Ptr& peer)
+			static thread_local BitStreamWriter bits;
+			tick_t tick = snapshot.Tick;
+			tick_t elapsed = peer->EntitiesSynced ? tick - peer->LastSyncedTick : 1;
+
+			// updates the peer didn't get are queued again before anything new
+			ProcessAcks(peer);
+			size_t unacked = peer->SentUpdates.size();
+
+			// with a byte budget adds and updates wait in the peer's pending list and go out by priority at the end
+			bool budgeted = peer->BytesPerTick > 0;
+			auto add = [this, &peer, tick, budgeted](const EntitySnapshot& entity)
+			{
+				if (budgeted)
+					peer->PendingEntities.emplace(entity.ID, 0.0f);
+				else
+					SendEntityAdd(peer, entity, tick);
+			};
+
+			// the interest policy decides what the peer is sent, it says when the peer's view changed enough to look again
+			bool viewChanged = interestChanged;
+			if (IndexedInterest != nullptr && IndexedInterest->UpdatePeer(*peer, snapshot))
+				viewChanged = true;
+
+			// if the client has never seen an entity it is interested in, send it to them
+			if (!peer->EntitiesSynced)
+			{
+				snapshot.DoForEach([this, &peer, &add](const EntitySnapshot::Ptr& entity)
+					{
+						if (!peer->KnownEnitities.ContainsKey(entity->ID) && IsInterested(peer, *entity, true))
+							add(*entity);
+					});
+				peer->EntitiesSynced = true;
+			}
+			else
+			{
+				if (viewChanged)
 				{
-					EntityInstances.DoForEachIf(EntityInstance::CanSyncFunc, [this, &peer](int64_t& id, EntityInstance::Ptr entity)
+					// send what came into view and remove what is now out of it
+					auto offer = [this, &peer, &snapshot, &add](int64_t id)
+					{
+						if (peer->KnownEnitities.ContainsKey(id))
+							return;
+
+						EntitySnapshot::Ptr entity = snapshot.Find(id);
+						if (entity != nullptr && IsInterested(peer, *entity, true))
+							add(*entity);
+					};
+
+					if (IndexedInterest != nullptr)
+						IndexedInterest->ForEachCandidate(*peer, snapshot, offer);
+					else
+						snapshot.DoForEach([&offer](const EntitySnapshot::Ptr& entity) { offer(entity->ID); });
+
+					std::vector<int64_t> leaving;
+					peer->KnownEnitities.DoForEach([this, &peer, &snapshot, &leaving](int64_t& id, KnownEnityDataset& /*known*/)
 						{
-							auto knownEnt = peer->KnownEnitities.Find(id);
-							if (knownEnt == std::nullopt)	// if the client has never seen this entity, send it to them (TODO, check if it's in range once we have spatial)
-							{
-								MessageBufferBuilder addMsg;
-								addMsg.Command = MessageCodes::AddEntity;
-								addMsg.AddID(id);
-								addMsg.AddInt(entity->Descriptor->ID);
-								addMsg.AddID(entity->OwnerID);
-								
-								KnownEnityDataset& dataset = peer->KnownEnitities.Insert(id, KnownEnityDataset());
-								entity->Properties.DoForEach([&addMsg, &dataset](PropertyData::Ptr prop) 
-									{
-										// always pack all values when the server sends an entity
-										prop->PackValue(addMsg);
-										dataset.DataRevisions.push_back(prop->GetRevision());
-									});
-								Send(peer, addMsg);
-							}
-							else
-							{
-								std::vector<PropertyData::Ptr> dirtyProps;
-								int index = 0;
-								// check all the properties find ones that have not been sent to the controller
-								entity->Properties.DoForEach([&knownEnt, &dirtyProps, &index,&peer,&entity](PropertyData::Ptr prop)
-									{
-										auto rev = prop->GetRevision();
-
-										bool transmit = prop->Descriptor->TransmitDef();
-										if (transmit && prop->Descriptor->Scope == PropertyDesc::Scopes::ClientPushSync)
-											transmit = entity->OwnerID != peer->GetID(); // don't send them back updates for a value they pushed to us
-
-										if (index <= knownEnt->DataRevisions.size())
-											knownEnt->DataRevisions.push_back(0);
-											
-										if (transmit && rev != knownEnt->DataRevisions[index] ) // different and we sync it
-											dirtyProps.push_back(prop);
-										knownEnt->DataRevisions[index] = rev;
-										index++;
-									});
-								if (dirtyProps.size() > 0)
-								{
-									MessageBufferBuilder updateMsg;
-									updateMsg.Command = MessageCodes::SetEntityDataValues;
-									updateMsg.AddID(id);
-
-									for (auto p : dirtyProps)
-									{
-										p->PackValue(updateMsg);
-									}
-
-									Send(peer, updateMsg);
-								}
-							}
+							EntitySnapshot::Ptr entity = snapshot.Find(id);
+							if (entity != nullptr && !IsInterested(peer, *entity, false))
+								leaving.push_back(id);
 						});
-				});
+					for (int64_t id : leaving)
+						SendEntityRemove(peer, id);
+				}
+
+				// records are sorted by entity, so each entity's changes are together
+				std::vector<PropertyData::Ptr> dirtyProps;
+				for (size_t first = 0; first < records.size();)
+				{
+					int64_t id = records[first].EntityID;
+					size_t end = first;
+					while (end < records.size() && records[end].EntityID == id)
+						end++;
+
+					if (records[first].PropertyID == ChangeJournal::EntityRemoved)
+					{
+						if (peer->KnownEnitities.ContainsKey(id))
+							SendEntityRemove(peer, id);
+						first = end;
+						continue;
+					}
+
+					EntitySnapshot::Ptr entity = snapshot.Find(id);
+					if (entity == nullptr)
+					{
+						first = end;
+						continue;
+					}
+
+					KnownEnityDataset* knownEnt = peer->KnownEnitities.TryGet(id);
+					if (knownEnt == nullptr)
+					{
+						if (IsInterested(peer, *entity, true))
+							add(*entity);
+						first = end;
+						continue;
+					}
+
+					if (!IsInterested(peer, *entity, false))
+					{
+						SendEntityRemove(peer, id);
+						first = end;
+						continue;
+					}
+
+					if (budgeted || peer->PendingEntities.count(id) > 0)
+					{
+						// the changes are found again from the snapshot when it is sent
+						peer->PendingEntities.emplace(id, 0.0f);
+						first = end;
+						continue;
+					}
+
+					dirtyProps.clear();
+					for (size_t r = first; r < end; r++)
+					{
+						if (records[r].PropertyID == ChangeJournal::EntityAdded)
+							continue;
+
+						auto prop = entity->GetProperty(records[r].PropertyID);
+						if (prop == nullptr || prop->GetChangeTick() <= knownEnt->LastSyncedTick)
+							continue;
+
+						if (prop->Descriptor->Scope == PropertyDesc::Scopes::ClientPushSync && entity->OwnerID == peer->GetID())
+							continue;	// don't send them back updates for a value they pushed to us
+
+						dirtyProps.push_back(prop);
+					}
+					knownEnt->LastSyncedTick = tick;
+
+					if (dirtyProps.size() > 0)
+						SendEntityUpdate(peer, id, dirtyProps, bits, *knownEnt, tick);
+					first = end;
+				}
+			}
+
+			if (!peer->PendingEntities.empty())
+				SendPendingEntities(peer, snapshot, elapsed, bits);
+			peer->LastSyncedTick = tick;
+
+			// close the sync so the client can tell it got all of it. While earlier syncs or adds wait for an ack one without updates
+			// still sends an empty SyncTick, so the ack that finds a loss or lets held state updates go doesn't have to wait for new changes
+			size_t sent = peer->SentUpdates.size() - unacked;
+			if (sent > 0 || peer->AddsAcked < peer->AddsSent || (!peer->SentUpdates.empty() && tick - peer->SentUpdates.front().Tick <= MaxUnackedTicks))
+			{
+				MessageBufferBuilder syncMsg(MessagePool, Wire);
+				syncMsg.Command = MessageCodes::SyncTick;
+				syncMsg.AddID(static_cast<int64_t>(tick));
+				syncMsg.AddInt(static_cast<int>(sent));
+				Send(peer, syncMsg, EntityUpdateReliability);
+			}
+
+			if (sent > 0)
+				peer->LastSentTick = tick;
+
+			// a peer that never acks keeps a limited history, for one that stopped acking the oldest updates are lost.
+			// checked every sync, the probe SyncTicks stop at the same age so no ack may come to find them
+			while (!peer->SentUpdates.empty() && tick - peer->SentUpdates.front().Tick > MaxUnackedTicks)
+			{
+				if (peer->LastAckedTick > 0)
+					UpdateLost(peer, peer->SentUpdates.front());
+				peer->SentUpdates.pop_front();
+			}
+		}
+
+		void ServerWorld::ProcessAcks(ServerEntityController::Ptr peer)
+		{
+			std::vector<ServerEntityController::ReceivedAck> acks;
+			peer->ReceivedAcks.Swap(acks);
+			for (auto& ack : acks)
+			{
+				tick_t acked = ack.Tick;
+				peer->LastAckedTick = std::max(peer->LastAckedTick, acked);
+				peer->AddsAcked = std::max(peer->AddsAcked, ack.Adds);
+
+				// every sync up to the acked one is either in the ack or was lost, later ones may still be on the way
+				while (!peer->SentUpdates.empty() && peer->SentUpdates.front().Tick <= acked)
+				{
+					auto& update = peer->SentUpdates.front();
+					tick_t age = acked - update.Tick;
+					bool received = age == 0 || (age <= 32 && (ack.Bits & (1u << (age - 1))) != 0);
+					if (received)
+						UpdateAcked(peer, update);
+					else
+						UpdateLost(peer, update);
+					peer->SentUpdates.pop_front();
+				}
+			}
+		}
+
+		// the state values in an acked update are the newest baselines the peer has, older ones are not used again
+		void ServerWorld::UpdateAcked(ServerEntityController::Ptr peer, const ServerEntityController::SentUpdate& update)
+		{
+			KnownEnityDataset* known = peer->KnownEnitities.TryGet(update.EntityID);
+			if (known == nullptr || update.Tick < known->AddedTick)
+				return;
+
+			for (auto& states : known->SentStates)
+			{
+				auto acked = std::find_if(states.begin(), states.end(), [&update](const KnownEnityDataset::SentState& state) { return state.Tick == update.Tick; });
+				if (acked == states.end())
+					continue;
+
+				acked->Acked = true;
+				states.erase(states.begin(), acked);
+			}
+		}
+
+		// queue the state values sent in a lost update again, skipping the ones a later sync sent since.
+		// later deltas were built on acked values only, so they are still good.
+		// an update from before the peer's latest add of the entity was replaced by the add
+		void ServerWorld::UpdateLost(ServerEntityController::Ptr peer, const ServerEntityController::SentUpdate& update)
+		{
+			KnownEnityDataset* known = peer->KnownEnitities.TryGet(update.EntityID);
+			if (known == nullptr || update.Tick < known->AddedTick)
+				return;
+
+			for (auto& states : known->SentStates)
+				states.erase(std::remove_if(states.begin(), states.end(), [&update](const KnownEnityDataset::SentState& state) { return state.Tick == update.Tick; }), states.end());
+
+			bool lost = false;
+			for (size_t p = 0; p < known->SentTicks.size(); p++)
+			{
+				if (known->SentTicks[p] != update.Tick)
+					continue;
+
+				known->SentTicks[p] = KnownEnityDataset::LostTick;
+				lost = true;
+			}
+
+			if (lost)
+				peer->PendingEntities.emplace(update.EntityID, 0.0f);
+		}
+
+		void ServerWorld::SendPendingEntities(ServerEntityController::Ptr peer, const WorldSnapshot& snapshot, tick_t elapsed, BitStreamWriter& bits)
+		{
+			tick_t tick = snapshot.Tick;
+
+			// everything still waiting gains priority for the time it waited, weighted by its type and by the interest policy
+			std::vector<std::pair<float, int64_t>> ranked;
+			for (auto pending = peer->PendingEntities.begin(); pending != peer->PendingEntities.end();)
+			{
+				EntitySnapshot::Ptr entity = snapshot.Find(pending->first);
+				if (entity == nullptr || (!peer->KnownEnitities.ContainsKey(pending->first) && !IsInterested(peer, *entity, true)))
+				{
+					pending = peer->PendingEntities.erase(pending);
+					continue;
+				}
+
+				float weight = entity->Descriptor->Priority;
+				if (IndexedInterest != nullptr)
+					weight *= IndexedInterest->GetPriority(*peer, *entity);
+
+				pending->second += weight * static_cast<float>(elapsed);
+				ranked.emplace_back(pending->second, pending->first);
+				pending++;
+			}
+			std::sort(ranked.begin(), ranked.end(), [](auto& a, auto& b) { return a.first > b.first; });
+
+			// unused budget is kept for at most one sync, going over it is paid back from the next one.
+			// without a budget nothing is counted, so one set later starts from zero
+			size_t budget = peer->BytesPerTick;
+			if (budget > 0)
+				peer->ByteCredit = std::min(peer->ByteCredit + static_cast<int64_t>(budget), static_cast<int64_t>(budget));
+			else
+				peer->ByteCredit = 0;
+
+			auto charge = [&peer, budget](size_t bytes)
+			{
+				if (budget > 0)
+					peer->ByteCredit -= static_cast<int64_t>(bytes);
+			};
+
+			std::vector<PropertyData::Ptr> dirtyProps;
+			for (auto& item : ranked)
+			{
+				if (budget > 0 && peer->ByteCredit <= 0)
+					break;
+
+				int64_t id = item.second;
+				EntitySnapshot::Ptr entity = snapshot.Find(id);
+				peer->PendingEntities.erase(id);
+
+				KnownEnityDataset* knownEnt = peer->KnownEnitities.TryGet(id);
+				if (knownEnt == nullptr)
+				{
+					charge(SendEntityAdd(peer, *entity, tick));
+					continue;
+				}
+
+				// everything that changed since the peer last got this entity, and what it was sent and didn't get
+				dirtyProps.clear();
+				for (auto& prop : entity->Properties)
+				{
+					if (prop == nullptr)
+						continue;
+
+					size_t p = static_cast<size_t>(prop->Descriptor->ID);
+					bool lost = p < knownEnt->SentTicks.size() && knownEnt->SentTicks[p] == KnownEnityDataset::LostTick;
+					if (!lost && prop->GetChangeTick() <= knownEnt->LastSyncedTick)
+						continue;
+
+					if (prop->Descriptor->Scope == PropertyDesc::Scopes::ClientPushSync && entity->OwnerID == peer->GetID())
+						continue;
+
+					dirtyProps.push_back(prop);
+				}
+				knownEnt->LastSyncedTick = tick;
+
+				if (dirtyProps.size() > 0)
+					charge(SendEntityUpdate(peer, id, dirtyProps, bits, *knownEnt, tick));
+			}
 		}
 	}
 }
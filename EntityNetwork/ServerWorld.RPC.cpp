@@ -28,10 +28,13 @@ namespace EntityNetwork
 	{
 		int ServerWorld::RegisterRemoteProcedure(RemoteProcedureDef::Ptr desc)
 		{
+			if (desc == nullptr || desc->ArgumentDefs.size() > Schema::RPCDef::MaxArguments)
+				return -1;
 			desc->ID = static_cast<int>(RemoteProcedures.Size());
 			auto ptr = std::make_shared<ServerRPCDef>();
 			ptr->RPCDefintion = desc;
 			RemoteProcedures.PushBack(ptr);
+			RPCIndex.Add(desc->Name, ptr);
 			SendToAll(BuildRPCSetupMessage(desc->ID));
 			return desc->ID;
 		}
@@ -65,11 +68,12 @@ namespace EntityNetwork
 
 		ServerWorld::ServerRPCDef::Ptr ServerWorld::GetRPCDef(const std::string& name)
 		{
-			auto procDef = RemoteProcedures.FindFirstMatch([name](ServerRPCDef::Ptr p) {return p->RPCDefintion->Name == name; });
-			if (procDef == std::nullopt)
-				return nullptr;
+			return RPCIndex.Find(name, nullptr);
+		}
 
-			return *procDef;
+		ServerWorld::ServerRPCDef::Ptr ServerWorld::GetRPCDef(NameKey name)
+		{
+			return RPCIndex.Find(name, nullptr);
 		}
 
 		std::vector<PropertyData::Ptr> ServerWorld::GetRPCArgs(int index)
@@ -134,11 +138,12 @@ namespace EntityNetwork
 			if (data == nullptr)
 				return nullptr;
 
-			MessageBufferBuilder builder;
+			MessageBufferBuilder builder(MessagePool, Wire);
 			builder.Command = MessageCodes::AddRPCDef;
-			builder.AddInt(index);
+			Schema::RPCDef def = Schema::RPCDef::From(*data->RPCDefintion);
+			def.ID = index;
+			builder.AddFixed(def);
 			builder.AddString(data->RPCDefintion->Name);
-			builder.AddByte(static_cast<int>(data->RPCDefintion->Scope));
 			for (auto arg : data->RPCDefintion->ArgumentDefs)
 				builder.AddByte(static_cast<int>(arg->DataType));
 
@@ -155,7 +160,7 @@ namespace EntityNetwork
 			if (procPtr == nullptr || procPtr->RPCDefintion->Scope == RemoteProcedureDef::Scopes::ClientToServer)
 				return false;
 
-			MessageBufferBuilder builder;
+			MessageBufferBuilder builder(MessagePool, Wire);
 			builder.Command = MessageCodes::CallRPC;
 			builder.AddInt(index);
 			for (PropertyData::Ptr arg : args)
@@ -40,11 +40,12 @@ namespace EntityNetwork
 		{
 			PropertyData::Ptr data = WorldProperties.Get(index);
 
-			MessageBufferBuilder builder;
+			MessageBufferBuilder builder(MessagePool, Wire);
 			builder.Command = MessageCodes::AddWordDataDef;
-			builder.AddInt(index);
+			Schema::WorldDataDef def = Schema::WorldDataDef::From(*data->Descriptor);
+			def.ID = index;
+			builder.AddFixed(def);
 			builder.AddString(data->Descriptor->Name);
-			builder.AddByte(static_cast<int>(data->Descriptor->DataType));
 			auto msg = builder.Pack();
 			WorldPropertyDefCache.PushBack(msg);
 
@@ -55,7 +56,7 @@ namespace EntityNetwork
 		{
 			auto data = WorldProperties[index];
 
-			MessageBufferBuilder builder;
+			MessageBufferBuilder builder(MessagePool, Wire);
 			builder.Command = MessageCodes::SetWorldDataValues;
 			data->PackValue(builder);
 			auto msg = builder.Pack();
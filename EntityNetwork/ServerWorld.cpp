@@ -26,12 +26,26 @@ namespace EntityNetwork
 {
 	namespace Server
 	{
+		ServerWorld::~ServerWorld()
+		{
+			// entities can be held past the world, stop them queueing changes here
+			EntityInstances.DoForEach([](auto /*id*/, EntityInstance::Ptr& ent)
+				{
+					ent->ChangeQueued = nullptr;
+				});
+		}
+
 		void ServerWorld::Update()
+		{
+			ReplicateSnapshot(EndTick());
+		}
+
+		WorldSnapshot::Ptr ServerWorld::EndTick()
 		{
 			std::vector<MessageBuffer::Ptr> pendingGlobalUpdates;
 
 			// send out any dirty world data updates
-			MessageBufferBuilder worldDataUpdates;
+			MessageBufferBuilder worldDataUpdates(MessagePool, Wire);
 			worldDataUpdates.Command = MessageCodes::SetWorldDataValues;
 			WorldProperties.DoForEach([this,&worldDataUpdates](PropertyData::Ptr prop)
 				{
@@ -46,12 +60,12 @@ namespace EntityNetwork
 
 			// find all dirty entity controller properties
 			
-			RemoteEnitityControllers.DoForEach([&pendingGlobalUpdates](auto& key, ServerEntityController::Ptr& peer)
+			RemoteEnitityControllers.DoForEach([this, &pendingGlobalUpdates](auto& key, ServerEntityController::Ptr& peer)
 				{
 					auto dirtyProps = peer->GetDirtyProperties();
 					if (dirtyProps.size() > 0)
 					{
-						MessageBufferBuilder builder;
+						MessageBufferBuilder builder(MessagePool, Wire);
 						builder.Command = MessageCodes::SetControllerPropertyDataValues;
 						builder.AddID(peer->GetID());
 						for (auto prop : dirtyProps)
@@ -59,7 +73,6 @@ namespace EntityNetwork
 							if (prop->Descriptor->Private) // we don't replicate private data
 								continue;
 
-							builder.AddInt(prop->Descriptor->ID);
 							prop->PackValue(builder);
 						}
 						pendingGlobalUpdates.push_back(builder.Pack());
@@ -70,7 +83,7 @@ namespace EntityNetwork
 			for (auto msg : pendingGlobalUpdates)
 				SendToAll(msg);
 
-			ProcessEntityUpdates();
+			return CaptureSnapshot();
 		}
 
 		void ServerWorld::AddInboundData(int64_t id, MessageBuffer::Ptr inbound)
@@ -81,66 +94,94 @@ namespace EntityNetwork
 			ServerEntityController::Ptr& peer = (*p);
 			if (inbound != nullptr)
 			{
-				MessageBufferReader reader(inbound);
-				switch (reader.Command)
+				MessageBufferReader reader(inbound, Wire);
+				ProcessMessage(peer, reader);
+			}
+		}
+
+		void ServerWorld::ProcessMessage(ServerEntityController::Ptr peer, MessageBufferReader& reader)
+		{
+			switch (reader.Command)
+			{
+			case MessageCodes::Batch:
+				while (!reader.Done())
 				{
+					MessageBufferReader message = reader.ReadBatchedMessage(Wire);
+					if (message.Message != nullptr)
+						ProcessMessage(peer, message);
+				}
+				break;
+
+			case MessageCodes::SetControllerPropertyDataValues:
+				ProcessControllerDataUpdate(peer, reader);
+			break;
 
-				case MessageCodes::SetControllerPropertyDataValues:
-					ProcessControllerDataUpdate(peer, reader);
+			case MessageCodes::CallRPC:
+				ProcessRPCall(peer, reader);
 				break;
 
-				case MessageCodes::CallRPC:
-					ProcessRPCall(peer, reader);
-					break;
-
-				case MessageCodes::AddEntity:
-					ProcessClientEntityAdd(peer, reader);
-					break;
-
-				case MessageCodes::RemoveEntity:
-					ProcessClientEntityRemove(peer, reader);
-					break;
-
-				case MessageCodes::SetEntityDataValues:
-					ProcessClientEntityUpdate(peer, reader);
-					break;
-
-				// server can't get these, it only sends them
-				case MessageCodes::AddControllerPropertyDef:
-				case MessageCodes::RemoveController:
-				case MessageCodes::AcceptController:
-				case MessageCodes::AddController:
-				case MessageCodes::AddRPCDef:
-				case MessageCodes::AddEntityDef:
-				case MessageCodes::AddWordDataDef:
-				case MessageCodes::InitalWorldDataComplete:
-				case MessageCodes::NoOp:
-				case MessageCodes::NoCode:
-				default:
-					break;
-				}
-			};
+			case MessageCodes::AddEntity:
+				ProcessClientEntityAdd(peer, reader);
+				break;
+
+			case MessageCodes::RemoveEntity:
+				ProcessClientEntityRemove(peer, reader);
+				break;
+
+			case MessageCodes::SetEntityDataValues:
+				ProcessClientEntityUpdate(peer, reader);
+				break;
+
+			case MessageCodes::Ack:
+				ProcessAck(peer, reader);
+				break;
+
+			// server can't get these, it only sends them
+			case MessageCodes::AddControllerPropertyDef:
+			case MessageCodes::RemoveController:
+			case MessageCodes::AcceptController:
+			case MessageCodes::AddController:
+			case MessageCodes::AddRPCDef:
+			case MessageCodes::AddEntityDef:
+			case MessageCodes::AddWordDataDef:
+			case MessageCodes::InitalWorldDataComplete:
+			case MessageCodes::SyncTick:
+			case MessageCodes::SetEntityStateValues:
+			case MessageCodes::NoOp:
+			case MessageCodes::NoCode:
+			default:
+				break;
+			}
 		}
 
 		MessageBuffer::Ptr ServerWorld::PopOutboundData(int64_t id)
 		{
 			auto p = RemoteEnitityControllers.Find(id);
-			if (p == std::nullopt || (*p)->OutboundMessages.Empty())
+			if (p == std::nullopt)
 				return nullptr;
 
 			return (*p)->OutboundMessages.Pop();
 		}
 
+		MessageBuffer::Ptr ServerWorld::PopOutboundData(int64_t id, Reliability reliability)
+		{
+			auto p = RemoteEnitityControllers.Find(id);
+			if (p == std::nullopt)
+				return nullptr;
+
+			return (*p)->OutboundMessages.Pop(reliability);
+		}
+
 		void ServerWorld::Send(ServerEntityController::Ptr peer, MutexedVector<MessageBuffer::Ptr>& messages)
 		{
 			if (peer != nullptr)
 				peer->OutboundMessages.AppendRange(messages);
 		}
 
-		void ServerWorld::Send(ServerEntityController::Ptr peer, MessageBuffer::Ptr message)
+		void ServerWorld::Send(ServerEntityController::Ptr peer, MessageBuffer::Ptr message, Reliability reliability)
 		{
 			if (peer != nullptr)
-				peer->OutboundMessages.Push(message);
+				peer->OutboundMessages.Push(message, reliability);
 		}
 
 		void ServerWorld::SendToAll(MessageBuffer::Ptr message)
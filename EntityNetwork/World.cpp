@@ -51,6 +51,55 @@ namespace EntityNetwork
 		// cache stuff here
 	}
 
+	void World::SetEntityPoolSize(int64_t typeID, size_t maxSize)
+	{
+		if (maxSize == 0)
+		{
+			EntityPools.Remove(typeID);
+			return;
+		}
+
+		EntityPool::Ptr* pool = EntityPools.TryGet(typeID);
+		if (pool != nullptr)
+			(*pool)->MaxSize = maxSize;
+		else
+			EntityPools.Insert(typeID, EntityPool::Make(maxSize));
+	}
+
+	void World::SetEntityPoolSize(const std::string& typeName, size_t maxSize)
+	{
+		auto def = GetEntityDef(typeName);
+		if (def != nullptr)
+			SetEntityPoolSize(def->ID, maxSize);
+	}
+
+	EntityInstance::Ptr World::TakePooledEntity(EntityDesc::Ptr desc)
+	{
+		if (desc == nullptr)
+			return nullptr;
+
+		auto pool = EntityPools.Find(desc->ID);
+		if (pool == std::nullopt)
+			return nullptr;
+
+		// a redefined type doesn't reuse instances built for the old definition
+		EntityInstance::Ptr entity = (*pool)->Take();
+		if (entity != nullptr && entity->Descriptor != desc)
+			return nullptr;
+
+		return entity;
+	}
+
+	void World::RecycleEntity(EntityInstance::Ptr& entity)
+	{
+		if (entity == nullptr)
+			return;
+
+		auto pool = EntityPools.Find(entity->Descriptor->ID);
+		if (pool != std::nullopt)
+			(*pool)->Give(entity);
+	}
+
 	EntityDesc::Ptr World::GetEntityDef(int64_t index)
 	{
 		auto def = EntityDefs.Find(index);
@@ -62,11 +111,12 @@ namespace EntityNetwork
 
 	EntityNetwork::EntityDesc::Ptr World::GetEntityDef(const std::string& typeName)
 	{
-		auto ent = EntityDefs.FindIF([&typeName](int64_t id, EntityDesc::Ptr desc) {return desc->Name == typeName; });
-		if (ent == std::nullopt)
-			return nullptr;
+		return EntityDefIndex.Find(typeName, nullptr);
+	}
 
-		return *ent;
+	EntityNetwork::EntityDesc::Ptr World::GetEntityDef(NameKey typeName)
+	{
+		return EntityDefIndex.Find(typeName, nullptr);
 	}
 
 	void World::SetupEntityController(EntityController::Ptr controller)
@@ -85,6 +135,7 @@ namespace EntityNetwork
 		desc->ID = (int)WorldPropertyDefs.Size();
 		WorldPropertyDefs.PushBack(desc);
 		WorldProperties.PushBack(PropertyData::MakeShared(desc));
+		WorldPropertyIndex.Add(desc->Name, WorldProperties[WorldProperties.Size() - 1]);
 		return desc->ID;
 	}
 
@@ -95,6 +146,7 @@ namespace EntityNetwork
 
 		WorldPropertyDefs.PushBack(desc);
 		WorldProperties.PushBack(PropertyData::MakeShared(WorldPropertyDefs[WorldPropertyDefs.Size()-1]));
+		WorldPropertyIndex.Add(desc->Name, WorldProperties[WorldProperties.Size() - 1]);
 		return desc->ID;
 	}
 
@@ -108,10 +160,11 @@ namespace EntityNetwork
 
 	PropertyData::Ptr  World::GetWorldPropertyData(const std::string& name)
 	{
-		auto match = WorldProperties.FindFirstMatch([name](PropertyData::Ptr prop) {return prop->Descriptor->Name == name; });
-		if (match == std::nullopt)
-			return nullptr;
+		return WorldPropertyIndex.Find(name, nullptr);
+	}
 
-		return *match;
+	PropertyData::Ptr  World::GetWorldPropertyData(NameKey name)
+	{
+		return WorldPropertyIndex.Find(name, nullptr);
 	}
 }
\ No newline at end of file
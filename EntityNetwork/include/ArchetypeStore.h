@@ -0,0 +1,176 @@
+//  Copyright (c) 2020 Jeffery Myers
+//
+//	EntityNetwork and its associated sub proejcts are free software;
+//
+//	Permission is hereby granted, free of charge, to any person obtaining a copy
+//	of this software and associated documentation files (the "Software"), to deal
+//	in the Software without restriction, including without limitation the rights
+//	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//	copies of the Software, and to permit persons to whom the Software is
+//	furnished to do so, subject to the following conditions:
+//	
+//	The above copyright notice and this permission notice shall be included in all
+//	copies or substantial portions of the Software.
+//	
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//	SOFTWARE.
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <mutex>
+#include <cstring>
+#include <algorithm>
+
+#include "PropertyDescriptor.h"
+#include "ThreadTools.h"
+
+namespace EntityNetwork
+{
+	// structure of arrays storage for the properties of every instance of one entity type.
+	// each fixed size property is a column of values laid out back to back, so passes over one property
+	// for all entities walk memory linearly. Strings and buffers stay in their PropertyData.
+	class ArchetypeStore
+	{
+	public:
+		typedef std::shared_ptr<ArchetypeStore> Ptr;
+
+		static constexpr size_t ChunkSlots = 256;	// columns grow a chunk at a time so bound values never move
+
+		ArchetypeStore(const std::vector<PropertyDesc::Ptr>& properties)
+		{
+			for (auto& prop : properties)
+			{
+				Column column;
+				column.Stride = (prop->FixedDataSize() + 7) & ~size_t(7);
+				Columns.push_back(std::move(column));
+			}
+		}
+
+		static inline Ptr Make(const std::vector<PropertyDesc::Ptr>& properties)
+		{
+			return std::make_shared<ArchetypeStore>(properties);
+		}
+
+		// reserves a slot in every column, freed slots are reused first
+		inline size_t Allocate()
+		{
+			MutexGuardian guard(StoreMutex);
+
+			size_t slot = 0;
+			if (!FreeSlots.empty())
+			{
+				slot = FreeSlots.back();
+				FreeSlots.pop_back();
+			}
+			else
+			{
+				slot = Live.size();
+				Live.push_back(0);
+
+				if (slot % ChunkSlots == 0)
+				{
+					for (auto& column : Columns)
+					{
+						if (column.Stride != 0)
+							column.Chunks.emplace_back(new char[column.Stride * ChunkSlots]);
+					}
+				}
+			}
+
+			Live[slot] = 1;
+			for (auto& column : Columns)
+			{
+				if (column.Stride != 0)
+					memset(SlotValue(column, slot), 0, column.Stride);
+			}
+			return slot;
+		}
+
+		inline void Release(size_t slot)
+		{
+			MutexGuardian guard(StoreMutex);
+			if (slot >= Live.size() || !Live[slot])
+				return;
+
+			Live[slot] = 0;
+			FreeSlots.push_back(slot);
+		}
+
+		// value storage for a property of a slot, nullptr for properties that are not stored in columns
+		inline void* GetValue(int propertyID, size_t slot)
+		{
+			MutexGuardian guard(StoreMutex);
+			if (propertyID < 0 || static_cast<size_t>(propertyID) >= Columns.size() || slot >= Live.size())
+				return nullptr;
+
+			Column& column = Columns[propertyID];
+			if (column.Stride == 0)
+				return nullptr;
+
+			return SlotValue(column, slot);
+		}
+
+		inline size_t GetStride(int propertyID)
+		{
+			if (propertyID < 0 || static_cast<size_t>(propertyID) >= Columns.size())
+				return 0;
+			return Columns[propertyID].Stride;
+		}
+
+		// calls func(slot, value) for every live slot in order, walking the column chunk by chunk
+		template<class F>
+		inline void ForEachValue(int propertyID, F&& func)
+		{
+			MutexGuardian guard(StoreMutex);
+			if (propertyID < 0 || static_cast<size_t>(propertyID) >= Columns.size())
+				return;
+
+			Column& column = Columns[propertyID];
+			if (column.Stride == 0)
+				return;
+
+			for (size_t chunk = 0; chunk < column.Chunks.size(); chunk++)
+			{
+				const char* values = column.Chunks[chunk].get();
+				size_t first = chunk * ChunkSlots;
+				size_t end = std::min(first + ChunkSlots, Live.size());
+
+				for (size_t slot = first; slot < end; slot++, values += column.Stride)
+				{
+					if (Live[slot])
+						func(slot, static_cast<const void*>(values));
+				}
+			}
+		}
+
+		inline size_t LiveCount()
+		{
+			MutexGuardian guard(StoreMutex);
+			return Live.size() - FreeSlots.size();
+		}
+
+	private:
+		class Column
+		{
+		public:
+			size_t Stride = 0;	// 0 for properties that are not stored in columns
+			std::vector<std::unique_ptr<char[]>> Chunks;
+		};
+
+		inline void* SlotValue(Column& column, size_t slot)
+		{
+			return column.Chunks[slot / ChunkSlots].get() + (slot % ChunkSlots) * column.Stride;
+		}
+
+		std::vector<Column> Columns;
+		std::vector<char> Live;
+		std::vector<size_t> FreeSlots;
+		std::mutex StoreMutex;
+	};
+}
@@ -0,0 +1,264 @@
+//  Copyright (c) 2020 Jeffery Myers
+//
+//	EntityNetwork and its associated sub proejcts are free software;
+//
+//	Permission is hereby granted, free of charge, to any person obtaining a copy
+//	of this software and associated documentation files (the "Software"), to deal
+//	in the Software without restriction, including without limitation the rights
+//	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//	copies of the Software, and to permit persons to whom the Software is
+//	furnished to do so, subject to the following conditions:
+//	
+//	The above copyright notice and this permission notice shall be included in all
+//	copies or substantial portions of the Software.
+//	
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//	SOFTWARE.
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+
+namespace EntityNetwork
+{
+	// writes values packed at arbitrary bit widths, least significant bit first
+	class BitStreamWriter
+	{
+	public:
+		std::vector<char> Data;
+		size_t BitCount = 0;
+
+		inline void Reset()
+		{
+			Data.clear();
+			BitCount = 0;
+		}
+
+		inline size_t ByteSize() const { return (BitCount + 7) / 8; }
+
+		inline void WriteBits(uint64_t value, int bits)
+		{
+			if (bits <= 0)
+				return;
+
+			if (bits < 64)
+				value &= (uint64_t(1) << bits) - 1;
+
+			while (bits > 0)
+			{
+				size_t byteIndex = BitCount >> 3;
+				int bitIndex = static_cast<int>(BitCount & 7);
+				if (byteIndex >= Data.size())
+					Data.push_back(0);
+
+				int take = std::min(8 - bitIndex, bits);
+				unsigned char chunk = static_cast<unsigned char>(value & ((1u << take) - 1));
+				Data[byteIndex] = static_cast<char>(static_cast<unsigned char>(Data[byteIndex]) | (chunk << bitIndex));
+
+				value >>= take;
+				bits -= take;
+				BitCount += take;
+			}
+		}
+
+		inline void WriteBool(bool value)
+		{
+			WriteBits(value ? 1 : 0, 1);
+		}
+
+		// writes a value in [min,max] using only as many bits as the range needs
+		inline void WriteRangedInt(int64_t value, int64_t min, int64_t max)
+		{
+			value = std::clamp(value, min, max);
+			WriteBits(static_cast<uint64_t>(value - min), BitsRequired(static_cast<uint64_t>(max - min)));
+		}
+
+		inline void WriteFloat(float value)
+		{
+			uint32_t bits = 0;
+			memcpy(&bits, &value, 4);
+			WriteBits(bits, 32);
+		}
+
+		inline void WriteDouble(double value)
+		{
+			uint64_t bits = 0;
+			memcpy(&bits, &value, 8);
+			WriteBits(bits, 64);
+		}
+
+		// maps a value in [min,max] onto an integer of the given bit width
+		inline void WriteQuantizedFloat(float value, float min, float max, int bits)
+		{
+			WriteBits(Quantize(value, min, max, bits), bits);
+		}
+
+		inline void WriteBytes(const void* data, size_t size)
+		{
+			const unsigned char* p = static_cast<const unsigned char*>(data);
+			if ((BitCount & 7) == 0)
+			{
+				Data.resize(BitCount / 8);
+				Data.insert(Data.end(), reinterpret_cast<const char*>(p), reinterpret_cast<const char*>(p) + size);
+				BitCount += size * 8;
+				return;
+			}
+
+			for (size_t i = 0; i < size; i++)
+				WriteBits(p[i], 8);
+		}
+
+		static inline int BitsRequired(uint64_t range)
+		{
+			int bits = 0;
+			while (range > 0)
+			{
+				bits++;
+				range >>= 1;
+			}
+			return bits;
+		}
+
+		// values outside the range are clamped to it, NaN is sent as min
+		static inline uint64_t Quantize(float value, float min, float max, int bits)
+		{
+			if (bits <= 0 || max <= min || std::isnan(value))
+				return 0;
+
+			uint64_t steps = (bits >= 64) ? UINT64_MAX : ((uint64_t(1) << bits) - 1);
+			double normal = (std::clamp(value, min, max) - min) / (double(max) - double(min));
+			return static_cast<uint64_t>(std::llround(normal * double(steps)));
+		}
+
+		static inline float Dequantize(uint64_t value, float min, float max, int bits)
+		{
+			if (bits <= 0 || max <= min)
+				return min;
+
+			uint64_t steps = (bits >= 64) ? UINT64_MAX : ((uint64_t(1) << bits) - 1);
+			return static_cast<float>(min + (double(value) / double(steps)) * (double(max) - double(min)));
+		}
+	};
+
+	// reads values written by a BitStreamWriter, reads past the end return zeros and set Overflow
+	class BitStreamReader
+	{
+	public:
+		const unsigned char* Data = nullptr;
+		size_t BitLength = 0;
+		size_t BitOffset = 0;
+		bool Overflow = false;
+
+		inline BitStreamReader(const void* data, size_t size)
+		{
+			Reset(data, size);
+		}
+
+		inline void Reset(const void* data, size_t size)
+		{
+			Data = static_cast<const unsigned char*>(data);
+			BitLength = size * 8;
+			BitOffset = 0;
+			Overflow = false;
+		}
+
+		inline bool Done() const { return BitOffset >= BitLength; }
+
+		inline uint64_t ReadBits(int bits)
+		{
+			if (bits <= 0)
+				return 0;
+
+			if (BitOffset + bits > BitLength)
+			{
+				Overflow = true;
+				BitOffset = BitLength;
+				return 0;
+			}
+
+			uint64_t value = 0;
+			int shift = 0;
+			while (bits > 0)
+			{
+				size_t byteIndex = BitOffset >> 3;
+				int bitIndex = static_cast<int>(BitOffset & 7);
+				int take = std::min(8 - bitIndex, bits);
+
+				uint64_t chunk = (Data[byteIndex] >> bitIndex) & ((1u << take) - 1);
+				value |= chunk << shift;
+
+				shift += take;
+				bits -= take;
+				BitOffset += take;
+			}
+			return value;
+		}
+
+		inline bool ReadBool()
+		{
+			return ReadBits(1) != 0;
+		}
+
+		inline int64_t ReadRangedInt(int64_t min, int64_t max)
+		{
+			return min + static_cast<int64_t>(ReadBits(BitStreamWriter::BitsRequired(static_cast<uint64_t>(max - min))));
+		}
+
+		inline float ReadFloat()
+		{
+			uint32_t bits = static_cast<uint32_t>(ReadBits(32));
+			float value = 0;
+			memcpy(&value, &bits, 4);
+			return value;
+		}
+
+		inline double ReadDouble()
+		{
+			uint64_t bits = ReadBits(64);
+			double value = 0;
+			memcpy(&value, &bits, 8);
+			return value;
+		}
+
+		inline float ReadQuantizedFloat(float min, float max, int bits)
+		{
+			return BitStreamWriter::Dequantize(ReadBits(bits), min, max, bits);
+		}
+
+		// reads bytes into the destination, a null destination just skips them
+		inline bool ReadBytes(void* destination, size_t size)
+		{
+			if (BitOffset + size * 8 > BitLength)
+			{
+				Overflow = true;
+				BitOffset = BitLength;
+				return false;
+			}
+
+			unsigned char* p = static_cast<unsigned char*>(destination);
+			if ((BitOffset & 7) == 0)
+			{
+				if (p != nullptr)
+					memcpy(p, Data + (BitOffset >> 3), size);
+				BitOffset += size * 8;
+				return true;
+			}
+
+			for (size_t i = 0; i < size; i++)
+			{
+				unsigned char c = static_cast<unsigned char>(ReadBits(8));
+				if (p != nullptr)
+					p[i] = c;
+			}
+			return true;
+		}
+	};
+}
@@ -22,6 +22,8 @@
 #pragma once
 
 #include <vector>
+#include <atomic>
+#include <functional>
 
 #include "MutexedVector.h"
 #include "PropertyData.h"
@@ -32,7 +34,26 @@ namespace EntityNetwork
 	class KnownEnityDataset
 	{
 	public:
-		std::vector<revision_t> DataRevisions;
+		tick_t LastSyncedTick = 0;		// the peer has every change stamped up to and including this tick
+		tick_t AddedTick = 0;			// sync the peer was sent the entity in, updates from before it were sent to a copy it has since removed
+		uint32_t AddSequence = 0;		// count of adds sent to the peer up to this one, state updates wait until the peer has acked that many. 0 when the peer made it
+		std::vector<std::vector<char>> SentValues;		// last value sent for each property, the baseline for delta updates (WireFormat::DeltaValues) sent in order
+		std::vector<tick_t> SentTicks;					// server sync tick each state property was last sent in, LostTick when that sync was not acknowledged or the update is held
+
+		// a state value sent unreliably, with DeltaValues the newest acked one is the baseline for the next
+		class SentState
+		{
+		public:
+			tick_t Tick = 0;
+			bool Acked = false;
+			std::vector<char> Value;
+		};
+		std::vector<std::vector<SentState>> SentStates;	// per state property, oldest first
+
+		static constexpr tick_t LostTick = 0;
+
+		// ticks a state baseline is kept, the client drops older ones
+		static constexpr tick_t MaxBaselineAge = 64;
 	};
 
 	class EntityInstance
@@ -47,20 +68,46 @@ namespace EntityNetwork
 		MutexedVector<PropertyData::Ptr> Properties;
 
 		EntityInstance (EntityDesc::Ptr desc);
-		virtual ~EntityInstance() {}
+		virtual ~EntityInstance();
+
+		// the descriptor's ArchetypeStore and the slot holding this instance's fixed size values, when the type uses one
+		ArchetypeStore::Ptr Store = nullptr;
+		size_t StoreSlot = 0;
+
+		// binds the fixed size values to a slot in the descriptor's ArchetypeStore, if it has one. DetachStore copies them back and frees the slot
+		void AttachStore();
+		void DetachStore();
+
+		// returns the instance to its just constructed state so an EntityPool can hand it out again.
+		// derived classes that keep their own data should reset it and call this
+		virtual void Recycle();
 
 		bool Dirty();
 		void CleanAll();
 
+		// called the first time a property changes after TakeChangedProperties, the world uses it to queue the entity for replication
+		std::function<void(EntityInstance*)> ChangeQueued;
+
+		// marks a property as changed since the last TakeChangedProperties, called by the property's ChangeListener
+		void PropertyDirty(int propertyID);
+
+		// adds the IDs of properties changed since the last call to ids, and clears them
+		void TakeChangedProperties(std::vector<int>& ids);
+
+		// properties with changes the known set has not been sent yet
 		std::vector<PropertyData::Ptr> GetDirtyProperties(KnownEnityDataset& knownSet);
+		std::vector<PropertyData::Ptr> GetChangedSince(tick_t tick);
 
 		inline PropertyData::Ptr FindProperty(const std::string& name)
 		{
-			auto p = Properties.FindFirstMatch([&name](PropertyData::Ptr& ptr) {return ptr->Descriptor->Name == name; });
-			if (p == std::nullopt)
-				return nullptr;
+			auto p = Properties.TryGet(Descriptor->PropertyIndex.Find(name, -1));
+			return p == nullptr ? nullptr : *p;
+		}
 
-			return *p;
+		inline PropertyData::Ptr FindProperty(NameKey name)
+		{
+			auto p = Properties.TryGet(Descriptor->PropertyIndex.Find(name, -1));
+			return p == nullptr ? nullptr : *p;
 		}
 
 		inline virtual void Created() {};
@@ -92,5 +139,8 @@ namespace EntityNetwork
 		}
 
 	protected:
+		// one bit per property ID, set on change and cleared when the world takes them
+		std::vector<std::atomic<uint64_t>> ChangedMask;
+		std::atomic<bool> Queued = { false };
 	};
 }
\ No newline at end of file
@@ -30,6 +30,7 @@
 #include "MutexedMessageBuffer.h"
 #include "MutexedVector.h"
 #include "EventList.h"
+#include "NameTable.h"
 
 namespace EntityNetwork
 {
@@ -63,10 +64,12 @@ namespace EntityNetwork
 
 		inline virtual void AddInbound(MessageBuffer::Ptr message) {}
 		inline virtual MessageBuffer::Ptr GetOutbound() { return nullptr; }
+		inline virtual MessageBuffer::Ptr GetOutbound(Reliability /*reliability*/) { return nullptr; }
 		inline virtual size_t GetOutboundSize() { return 0; }
 
 		PropertyData::Ptr FindPropertyByID(int id);
 		PropertyData::Ptr FindPropertyByName(const std::string& name);
+		PropertyData::Ptr FindPropertyByName(NameKey name);
 
 		std::vector<PropertyData::Ptr> GetDirtyProperties();
 
@@ -79,5 +82,6 @@ namespace EntityNetwork
 
 		int64_t ID = 0;
 		MutexedVector<PropertyData::Ptr> Properties;
+		NameIndex<PropertyData::Ptr> PropertyIndex;
 	};
 }
\ No newline at end of file
@@ -29,6 +29,8 @@
 #include <functional>
 
 #include "PropertyDescriptor.h"
+#include "ArchetypeStore.h"
+#include "NameTable.h"
 
 namespace EntityNetwork
 {
@@ -44,6 +46,12 @@ namespace EntityNetwork
 
 		bool IsAvatar = false;
 
+		// property holding the entity's position, used by the server to send peers only the entities near their avatar. -1 for entities that are everywhere
+		int PositionProperty = -1;
+
+		// server side weight of this type's updates when a peer's byte budget can't fit every change, higher is sent sooner
+		float Priority = 1;
+
 		enum class CreateScopes
 		{
 			ClientLocal,
@@ -54,6 +62,18 @@ namespace EntityNetwork
 		CreateScopes CreateScope = CreateScopes::ServerSync;
 
 		std::vector<PropertyDesc::Ptr> Properties;
+		NameIndex<int> PropertyIndex;	// property ID by name
+
+		// optional column storage shared by every instance of this type, see UseArchetypeStore
+		ArchetypeStore::Ptr Store = nullptr;
+
+		// keeps the fixed size property values of new instances in per property columns.
+		// call after all properties are added and before any instances are created, local to this process
+		inline void UseArchetypeStore()
+		{
+			if (Store == nullptr)
+				Store = ArchetypeStore::Make(Properties);
+		}
 
 		inline bool AllowServerCreate() const
 		{
@@ -74,6 +94,7 @@ namespace EntityNetwork
 		{
 			desc->ID = static_cast<int>(Properties.size());
 			Properties.push_back(desc);
+			PropertyIndex.Add(desc->Name, desc->ID);
 			return desc->ID;
 		}
 
@@ -87,6 +108,31 @@ namespace EntityNetwork
 			return AddPropertyDesc(desc);
 		}
 
+		// a replicated vector or state property, false if there is no property with that name or it can't hold a position
+		inline bool SetPositionProperty(const std::string& name)
+		{
+			PositionProperty = PropertyIndex.Find(name, -1);
+			if (PositionProperty < 0)
+				return false;
+
+			switch (Properties[PositionProperty]->DataType)
+			{
+			case PropertyDesc::DataTypes::Vector3I:
+			case PropertyDesc::DataTypes::Vector4I:
+			case PropertyDesc::DataTypes::Vector3F:
+			case PropertyDesc::DataTypes::Vector4F:
+			case PropertyDesc::DataTypes::Vector3D:
+			case PropertyDesc::DataTypes::Vector4D:
+			case PropertyDesc::DataTypes::StateV3F:
+			case PropertyDesc::DataTypes::StateV3FQ4F:
+				return true;
+
+			default:
+				PositionProperty = -1;
+				return false;
+			}
+		}
+
 	protected:
 	};
 }
\ No newline at end of file
@@ -22,9 +22,15 @@
 #pragma once
 
 #include "Entity.h"
+#include "ArchetypeStore.h"
+#include "EntityPool.h"
+#include "NameTable.h"
+#include "PropertyHandle.h"
 #include "EntityController.h"
 #include "World.h"
 #include "Messages.h"
+#include "MessageSchema.h"
+#include "BitStream.h"
 #include "server/ServerWorld.h"
 #include "client/ClientWorld.h"
 #include "MutexedMessageBuffer.h"
@@ -33,5 +39,6 @@
 
 namespace EntityFramework
 {
-#define PROTOCOL_HEADER "ENT_NET_V01"
+// sent in the HailCheck, bump it with every change to the messages so mismatched builds don't misread each other
+#define PROTOCOL_HEADER "ENT_NET_V02"
 }
\ No newline at end of file
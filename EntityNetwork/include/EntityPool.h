@@ -0,0 +1,100 @@
+//  Copyright (c) 2020 Jeffery Myers
+//
+//	EntityNetwork and its associated sub proejcts are free software;
+//
+//	Permission is hereby granted, free of charge, to any person obtaining a copy
+//	of this software and associated documentation files (the "Software"), to deal
+//	in the Software without restriction, including without limitation the rights
+//	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//	copies of the Software, and to permit persons to whom the Software is
+//	furnished to do so, subject to the following conditions:
+//	
+//	The above copyright notice and this permission notice shall be included in all
+//	copies or substantial portions of the Software.
+//	
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//	SOFTWARE.
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <mutex>
+
+#include "Entity.h"
+#include "ThreadTools.h"
+
+namespace EntityNetwork
+{
+	// removed instances of one entity type kept for reuse, along with their property objects and value storage.
+	// instances come from the world's factory the first time, so pooled ones keep their derived type
+	class EntityPool
+	{
+	public:
+		typedef std::shared_ptr<EntityPool> Ptr;
+
+		size_t MaxSize = 0;
+
+		EntityPool(size_t maxSize) : MaxSize(maxSize) {}
+
+		static inline Ptr Make(size_t maxSize)
+		{
+			return std::make_shared<EntityPool>(maxSize);
+		}
+
+		// an instance in its constructed state, nullptr when the pool is empty
+		inline EntityInstance::Ptr Take()
+		{
+			EntityInstance::Ptr entity = nullptr;
+			{
+				MutexGuardian guard(PoolMutex);
+				if (Free.empty())
+					return nullptr;
+
+				entity = Free.back();
+				Free.pop_back();
+			}
+
+			entity->AttachStore();
+			return entity;
+		}
+
+		// keeps the instance if the pool has room and nothing else holds it or its properties, entity is cleared when it is taken
+		inline bool Give(EntityInstance::Ptr& entity)
+		{
+			if (entity == nullptr || entity.use_count() != 1)
+				return false;
+
+			bool shared = false;
+			entity->Properties.DoForEach([&shared](PropertyData::Ptr& prop) { shared = shared || prop.use_count() > 1; });
+			if (shared)
+				return false;
+
+			{
+				MutexGuardian guard(PoolMutex);
+				if (Free.size() >= MaxSize)
+					return false;
+			}
+
+			entity->Recycle();
+
+			MutexGuardian guard(PoolMutex);
+			Free.push_back(std::move(entity));
+			return true;
+		}
+
+		inline size_t Size()
+		{
+			MutexGuardian guard(PoolMutex);
+			return Free.size();
+		}
+
+	private:
+		std::vector<EntityInstance::Ptr> Free;
+		std::mutex PoolMutex;
+	};
+}
@@ -25,6 +25,7 @@
 #include <memory>
 #include <mutex>
 #include <functional>
+#include "ThreadTools.h"
 
 namespace EntityNetwork
 {
@@ -0,0 +1,202 @@
+//  Copyright (c) 2020 Jeffery Myers
+//
+//	EntityNetwork and its associated sub proejcts are free software;
+//
+//	Permission is hereby granted, free of charge, to any person obtaining a copy
+//	of this software and associated documentation files (the "Software"), to deal
+//	in the Software without restriction, including without limitation the rights
+//	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//	copies of the Software, and to permit persons to whom the Software is
+//	furnished to do so, subject to the following conditions:
+//	
+//	The above copyright notice and this permission notice shall be included in all
+//	copies or substantial portions of the Software.
+//	
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//	SOFTWARE.
+#pragma once
+
+#include <cstdint>
+#include <type_traits>
+
+#include "PropertyDescriptor.h"
+#include "EntityDescriptor.h"
+#include "RemoteProcedureDescriptor.h"
+
+// fixed size prefixes of the definition messages.
+// each message declares its fixed fields once here, the builder and reader copy the whole prefix with one memcpy (MessageBufferBuilder::AddFixed/MessageBufferReader::ReadFixed).
+// variable length fields (names, argument lists, entity properties) are streamed after the prefix in the order given on each struct.
+// the prefixes are the same in every WireFormat, WireFormat::VarInts only applies to the streamed fields
+
+namespace EntityNetwork
+{
+	namespace Schema
+	{
+#pragma pack(push, 1)
+
+		struct QuantizationFields
+		{
+			uint8_t Bits = 0;
+			float Min = 0;
+			float Max = 0;
+
+			static inline QuantizationFields From(const PropertyDesc& desc)
+			{
+				QuantizationFields fields;
+				fields.Bits = static_cast<uint8_t>(desc.QuantizeBits);
+				fields.Min = desc.QuantizeMin;
+				fields.Max = desc.QuantizeMax;
+				return fields;
+			}
+
+			inline void Apply(PropertyDesc& desc) const
+			{
+				desc.SetQuantization(Min, Max, Bits);
+			}
+		};
+
+		// AddControllerPropertyDef: prefix, Name
+		struct ControllerPropertyDef
+		{
+			int32_t ID = 0;
+			uint8_t DataType = 0;
+			uint8_t Scope = 0;
+			uint8_t Private = 0;
+			QuantizationFields Quantization;
+
+			static inline ControllerPropertyDef From(const PropertyDesc& desc)
+			{
+				ControllerPropertyDef def;
+				def.ID = desc.ID;
+				def.DataType = static_cast<uint8_t>(desc.DataType);
+				def.Scope = static_cast<uint8_t>(desc.Scope);
+				def.Private = desc.Private ? 1 : 0;
+				def.Quantization = QuantizationFields::From(desc);
+				return def;
+			}
+
+			inline void Apply(PropertyDesc& desc) const
+			{
+				desc.ID = ID;
+				desc.DataType = static_cast<PropertyDesc::DataTypes>(DataType);
+				desc.Scope = static_cast<PropertyDesc::Scopes>(Scope);
+				desc.Private = Private != 0;
+				Quantization.Apply(desc);
+			}
+		};
+
+		// AddWordDataDef: prefix, Name
+		struct WorldDataDef
+		{
+			int32_t ID = 0;
+			uint8_t DataType = 0;
+			QuantizationFields Quantization;
+
+			static inline WorldDataDef From(const PropertyDesc& desc)
+			{
+				WorldDataDef def;
+				def.ID = desc.ID;
+				def.DataType = static_cast<uint8_t>(desc.DataType);
+				def.Quantization = QuantizationFields::From(desc);
+				return def;
+			}
+
+			inline void Apply(PropertyDesc& desc) const
+			{
+				desc.ID = ID;
+				desc.DataType = static_cast<PropertyDesc::DataTypes>(DataType);
+				Quantization.Apply(desc);
+			}
+		};
+
+		// AddRPCDef: prefix, Name, one DataType byte per argument
+		struct RPCDef
+		{
+			int32_t ID = 0;
+			uint8_t Scope = 0;
+			uint8_t ArgumentCount = 0;
+
+			static constexpr size_t MaxArguments = UINT8_MAX;	// RegisterRemoteProcedure refuses RPCs with more
+
+			static inline RPCDef From(const RemoteProcedureDef& desc)
+			{
+				RPCDef def;
+				def.ID = desc.ID;
+				def.Scope = static_cast<uint8_t>(desc.Scope);
+				def.ArgumentCount = static_cast<uint8_t>(desc.ArgumentDefs.size());
+				return def;
+			}
+
+			inline void Apply(RemoteProcedureDef& desc) const
+			{
+				desc.ID = ID;
+				desc.Scope = static_cast<RemoteProcedureDef::Scopes>(Scope);
+			}
+		};
+
+		// AddEntityDef: prefix, Name, then PropertyCount x (EntityPropertyDef, Name)
+		struct EntityDef
+		{
+			int32_t ID = 0;
+			uint8_t IsAvatar = 0;
+			uint8_t CreateScope = 0;
+			uint16_t PropertyCount = 0;
+
+			static constexpr size_t MaxProperties = UINT16_MAX;	// RegisterEntityDesc refuses entities with more
+
+			static inline EntityDef From(const EntityDesc& desc)
+			{
+				EntityDef def;
+				def.ID = desc.ID;
+				def.IsAvatar = desc.IsAvatar ? 1 : 0;
+				def.CreateScope = static_cast<uint8_t>(desc.CreateScope);
+				def.PropertyCount = static_cast<uint16_t>(desc.Properties.size());
+				return def;
+			}
+
+			inline void Apply(EntityDesc& desc) const
+			{
+				desc.ID = ID;
+				desc.IsAvatar = IsAvatar != 0;
+				desc.CreateScope = static_cast<EntityDesc::CreateScopes>(CreateScope);
+			}
+		};
+
+		struct EntityPropertyDef
+		{
+			int32_t ID = 0;
+			uint8_t Scope = 0;
+			uint8_t DataType = 0;
+			QuantizationFields Quantization;
+
+			static inline EntityPropertyDef From(const PropertyDesc& desc)
+			{
+				EntityPropertyDef def;
+				def.ID = desc.ID;
+				def.Scope = static_cast<uint8_t>(desc.Scope);
+				def.DataType = static_cast<uint8_t>(desc.DataType);
+				def.Quantization = QuantizationFields::From(desc);
+				return def;
+			}
+
+			inline void Apply(PropertyDesc& desc) const
+			{
+				desc.ID = ID;
+				desc.Scope = static_cast<PropertyDesc::Scopes>(Scope);
+				desc.DataType = static_cast<PropertyDesc::DataTypes>(DataType);
+				Quantization.Apply(desc);
+			}
+		};
+
+#pragma pack(pop)
+
+		static_assert(sizeof(ControllerPropertyDef) == 16, "ControllerPropertyDef must be packed");
+		static_assert(sizeof(EntityDef) == 8, "EntityDef must be packed");
+		static_assert(std::is_trivially_copyable<EntityPropertyDef>::value, "schema prefixes are copied with memcpy");
+	}
+}
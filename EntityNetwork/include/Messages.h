@@ -24,6 +24,10 @@
 #include <mutex>
 #include <deque>
 #include <memory>
+#include <vector>
+#include <cstring>
+#include <type_traits>
+#include <functional>
 #include "ThreadTools.h"
 #include "MutexedVector.h"
 
@@ -61,10 +65,29 @@ namespace EntityNetwork
 		// RPC
 		CallRPC,
 
+		// transport
+		Batch,					// several length framed messages packed into one datagram
+
+		// acknowledgement
+		SyncTick,				// server, ends a sync that sent entity updates: the sync's tick and how many SetEntityStateValues it sent
+		Ack,					// client, the newest sync tick it got whole, a bit for each of the 32 ticks before it that it also got and the entity adds it got
+
+		// data updates
+		SetEntityStateValues,	// server, the state properties of one entity in a sync, sent unreliably and counted by its SyncTick
+
 		// special
 		NoCode = -126
 	};
 
+	// how the transport should deliver an outbound message. Each class has its own queue, see PopOutboundData
+	enum class Reliability
+	{
+		ReliableOrdered = 0,	// definitions, controllers, entity adds and removes, RPCs. Everything after them depends on them
+		ReliableUnordered,		// must arrive, but needn't wait behind the ordered stream
+		UnreliableSequenced,	// a lost or late message is dropped, newer ones replace it. Entity state updates, lost ones are sent again from the acks
+	};
+	static constexpr size_t ReliabilityClasses = 3;
+
 	struct StateUpdatePos
 	{
 		uint64_t Step = 0;
@@ -78,6 +101,46 @@ namespace EntityNetwork
 		float Orientation[4] = { 0,0,0,1 };
 	};
 
+	// optional wire encodings, chosen by the server and announced to clients in the HailCheck message
+	class WireFormat
+	{
+	public:
+		bool VarInts = false;				// ints, IDs and lengths are written as zigzag LEB128 varints instead of fixed sizes
+		bool BitPackedEntities = false;		// server entity updates carry a bit stream of changed flags and values instead of ID/length prefixed values
+		bool DeltaValues = false;			// server entity updates send the difference from the last value the peer has when it is smaller
+
+		enum Flags
+		{
+			VarIntFlag = 0x01,
+			BitPackedEntitiesFlag = 0x02,
+			DeltaValuesFlag = 0x04,
+		};
+
+		inline int ToFlags() const
+		{
+			return (VarInts ? VarIntFlag : 0) | (BitPackedEntities ? BitPackedEntitiesFlag : 0) | (DeltaValues ? DeltaValuesFlag : 0);
+		}
+
+		static inline WireFormat FromFlags(int flags)
+		{
+			WireFormat format;
+			format.VarInts = (flags & VarIntFlag) != 0;
+			format.BitPackedEntities = (flags & BitPackedEntitiesFlag) != 0;
+			format.DeltaValues = (flags & DeltaValuesFlag) != 0;
+			return format;
+		}
+
+		static inline uint64_t ZigZag(int64_t value)
+		{
+			return (static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63);
+		}
+
+		static inline int64_t UnZigZag(uint64_t value)
+		{
+			return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+		}
+	};
+
 	class MessageBuffer
 	{
 	public:
@@ -102,17 +165,216 @@ namespace EntityNetwork
 			MessageData = (void*) new char[lenght];
 		}
 
+		// takes over the storage of a builder, no copy is made
+		MessageBuffer(std::vector<char>&& storage)
+		{
+			Adopt(std::move(storage));
+		}
+
+		// called instead of freeing the data for buffers that view memory owned by someone else (such as a transport packet)
+		typedef std::function<void()> ReleaseFunction;
+
+		// points at the data without copying it, release is called when the last reference goes away
+		MessageBuffer(void* data, size_t lenght, ReleaseFunction release) : MessageData(data), MessageLenght(lenght), Release(std::move(release))
+		{
+		}
+
 		virtual ~MessageBuffer()
 		{
-			if (MessageData != nullptr)
-				delete[] MessageData;
+			if (Release != nullptr)
+				Release();
+			else if (MessageData != nullptr && !UsesStorage)
+				delete[] (char*)MessageData;
+		}
+
+		inline void Adopt(std::vector<char>&& storage)
+		{
+			Storage = std::move(storage);
+			UsesStorage = true;
+			MessageData = Storage.data();
+			MessageLenght = Storage.size();
+		}
+
+		inline std::vector<char> ReleaseStorage()
+		{
+			MessageData = nullptr;
+			MessageLenght = 0;
+			return std::move(Storage);
 		}
 
 		typedef std::shared_ptr<MessageBuffer> Ptr;
 		static inline Ptr MakeShared(void* data, size_t len, bool canOwn = false) { return std::make_shared<MessageBuffer>(data, len, canOwn); }
 		static inline Ptr MakeShared(size_t len) { return std::make_shared<MessageBuffer>(len); }
+		static inline Ptr MakeShared(std::vector<char>&& storage) { return std::make_shared<MessageBuffer>(std::move(storage)); }
+		static inline Ptr MakeView(void* data, size_t len, ReleaseFunction release) { return std::make_shared<MessageBuffer>(data, len, std::move(release)); }
+
+	protected:
+		std::vector<char> Storage;
+		bool UsesStorage = false;
+		ReleaseFunction Release;
+	};
+
+	// recycles message storage, buffer objects and their reference count blocks so that steady state message building does not hit the heap
+	class MessageBufferPool : public std::enable_shared_from_this<MessageBufferPool>
+	{
+	public:
+		typedef std::shared_ptr<MessageBufferPool> Ptr;
+
+		static inline Ptr Make() { return std::make_shared<MessageBufferPool>(); }
+
+		size_t InitialCapacity = 128;
+		size_t MaxRetainedCapacity = 64 * 1024;
+		size_t MaxFreeItems = 1024;
+
+		virtual ~MessageBufferPool()
+		{
+			for (auto buffer : FreeBuffers)
+				delete buffer;
+
+			for (auto block : FreeBlocks)
+				::operator delete(block);
+		}
+
+		inline std::vector<char> TakeStorage()
+		{
+			{
+				MutexGuardian guard(PoolMutex);
+				if (!FreeStorage.empty())
+				{
+					std::vector<char> storage = std::move(FreeStorage.back());
+					FreeStorage.pop_back();
+					return storage;
+				}
+			}
+
+			std::vector<char> storage;
+			storage.reserve(InitialCapacity);
+			return storage;
+		}
+
+		inline void ReturnStorage(std::vector<char>&& storage)
+		{
+			if (storage.capacity() == 0 || storage.capacity() > MaxRetainedCapacity)
+				return;
+
+			storage.clear();
+			MutexGuardian guard(PoolMutex);
+			if (FreeStorage.size() < MaxFreeItems)
+				FreeStorage.push_back(std::move(storage));
+		}
+
+		inline void* TakeBlock(size_t size)
+		{
+			if (size > BlockSize)
+				return ::operator new(size);
+
+			{
+				MutexGuardian guard(PoolMutex);
+				if (!FreeBlocks.empty())
+				{
+					void* block = FreeBlocks.back();
+					FreeBlocks.pop_back();
+					return block;
+				}
+			}
+			return ::operator new(BlockSize);
+		}
+
+		inline void ReturnBlock(void* block, size_t size)
+		{
+			if (size <= BlockSize)
+			{
+				MutexGuardian guard(PoolMutex);
+				if (FreeBlocks.size() < MaxFreeItems)
+				{
+					FreeBlocks.push_back(block);
+					return;
+				}
+			}
+			::operator delete(block);
+		}
+
+		// wrap builder storage in a shared buffer that comes back to this pool when the last reference is dropped
+		inline MessageBuffer::Ptr Adopt(std::vector<char>&& storage);
+
+	protected:
+		static constexpr size_t BlockSize = 128;
+
+		std::mutex PoolMutex;
+		std::vector<std::vector<char>> FreeStorage;
+		std::vector<MessageBuffer*> FreeBuffers;
+		std::vector<void*> FreeBlocks;
+
+		inline void Recycle(MessageBuffer* buffer)
+		{
+			std::vector<char> storage = buffer->ReleaseStorage();
+			ReturnStorage(std::move(storage));
+
+			{
+				MutexGuardian guard(PoolMutex);
+				if (FreeBuffers.size() < MaxFreeItems)
+				{
+					FreeBuffers.push_back(buffer);
+					return;
+				}
+			}
+			delete buffer;
+		}
+
+		// the shared pointer's control block holds a copy of this allocator, so the pool lives until the last pooled buffer is gone
+		template <class T>
+		class BlockAllocator
+		{
+		public:
+			typedef T value_type;
+
+			MessageBufferPool::Ptr Pool;
+
+			BlockAllocator(MessageBufferPool::Ptr pool) : Pool(pool) {}
+
+			template <class U>
+			BlockAllocator(const BlockAllocator<U>& other) : Pool(other.Pool) {}
+
+			inline T* allocate(size_t count) { return static_cast<T*>(Pool->TakeBlock(count * sizeof(T))); }
+			inline void deallocate(T* ptr, size_t count) { Pool->ReturnBlock(ptr, count * sizeof(T)); }
+
+			template <class U>
+			inline bool operator == (const BlockAllocator<U>& rhs) const { return Pool == rhs.Pool; }
+
+			template <class U>
+			inline bool operator != (const BlockAllocator<U>& rhs) const { return Pool != rhs.Pool; }
+		};
+
+		class Recycler
+		{
+		public:
+			MessageBufferPool* Pool = nullptr;
+
+			Recycler(MessageBufferPool* pool) : Pool(pool) {}
+			inline void operator () (MessageBuffer* buffer) const { Pool->Recycle(buffer); }
+		};
 	};
 
+	inline MessageBuffer::Ptr MessageBufferPool::Adopt(std::vector<char>&& storage)
+	{
+		MessageBuffer* buffer = nullptr;
+		{
+			MutexGuardian guard(PoolMutex);
+			if (!FreeBuffers.empty())
+			{
+				buffer = FreeBuffers.back();
+				FreeBuffers.pop_back();
+			}
+		}
+
+		if (buffer == nullptr)
+			buffer = new MessageBuffer(std::move(storage));
+		else
+			buffer->Adopt(std::move(storage));
+
+		return MessageBuffer::Ptr(buffer, Recycler(this), BlockAllocator<MessageBuffer>(shared_from_this()));
+	}
+
 	class MessageBufferBuilder
 	{
 	public:
@@ -120,18 +382,37 @@ namespace EntityNetwork
 
 		MessageCodes Command = MessageCodes::NoOp;
 
+		MessageBufferPool::Ptr Pool;
+
+		WireFormat Format;
+
 	private:
 		void Insert(const void* ptr, size_t size)
 		{
+			if (Data.empty() && Command != MessageCodes::NoCode) // storage was handed off by Pack, start a new message
+			{
+				if (Data.capacity() == 0)
+					TakeStorage();
+				Data.push_back(0);
+			}
+
 			const char* p = (const char*)ptr;
 			Data.insert(Data.end(), p, p + size);
 		}
 
+		inline void TakeStorage()
+		{
+			if (Pool != nullptr)
+				Data = Pool->TakeStorage();
+			else
+				Data.reserve(128);
+		}
+
 	public:
 
 		inline MessageBufferBuilder(bool useCode = true)
 		{
-			Data.reserve(128);
+			TakeStorage();
 			if (useCode)
 				Data.push_back(0);
 			else
@@ -140,11 +421,47 @@ namespace EntityNetwork
 
 		inline MessageBufferBuilder(MessageCodes code)
 		{
-			Data.reserve(128);
+			TakeStorage();
 			Command = code;
 			Data.push_back((char)Command);
 		}
 
+		inline MessageBufferBuilder(MessageBufferPool::Ptr pool, bool useCode = true) : Pool(pool)
+		{
+			TakeStorage();
+			if (useCode)
+				Data.push_back(0);
+			else
+				Command = MessageCodes::NoCode;
+		}
+
+		inline MessageBufferBuilder(MessageBufferPool::Ptr pool, MessageCodes code) : Pool(pool)
+		{
+			TakeStorage();
+			Command = code;
+			Data.push_back((char)Command);
+		}
+
+		inline MessageBufferBuilder(MessageBufferPool::Ptr pool, const WireFormat& format, bool useCode = true) : Pool(pool), Format(format)
+		{
+			TakeStorage();
+			if (useCode)
+				Data.push_back(0);
+			else
+				Command = MessageCodes::NoCode;
+		}
+
+		MessageBufferBuilder(const MessageBufferBuilder&) = default;
+		MessageBufferBuilder(MessageBufferBuilder&&) = default;
+		MessageBufferBuilder& operator = (const MessageBufferBuilder&) = default;
+		MessageBufferBuilder& operator = (MessageBufferBuilder&&) = default;
+
+		inline ~MessageBufferBuilder()
+		{
+			if (Pool != nullptr)
+				Pool->ReturnStorage(std::move(Data));
+		}
+
 		inline bool Empty()
 		{
 			if (Command == MessageCodes::NoCode)
@@ -155,14 +472,44 @@ namespace EntityNetwork
 
 		inline void Clear()
 		{
-			Data = std::vector<char>();
+			if (Data.capacity() == 0)
+				TakeStorage();
+
+			Data.clear();
 			if (Command != MessageCodes::NoCode)
 				Data.push_back(0);
 		}
 
+		inline void AddVarInt(uint64_t value)
+		{
+			unsigned char bytes[10];
+			size_t count = 0;
+			while (value >= 0x80)
+			{
+				bytes[count++] = static_cast<unsigned char>(value | 0x80);
+				value >>= 7;
+			}
+			bytes[count++] = static_cast<unsigned char>(value);
+			Insert(bytes, count);
+		}
+
+		inline void AddLength(size_t lenght)
+		{
+			if (Format.VarInts)
+				AddVarInt(lenght);
+			else
+			{
+				uint16_t len = (uint16_t)lenght;
+				Insert(&len, 2);
+			}
+		}
+
 		inline void AddInt(int value)
 		{
-			Insert(&value, 4);
+			if (Format.VarInts)
+				AddVarInt(WireFormat::ZigZag(value));
+			else
+				Insert(&value, 4);
 		}
 
 		inline void AddByte(int value)
@@ -177,25 +524,47 @@ namespace EntityNetwork
 			Insert(&c, 1);
 		}
 
+		inline void AddFloat(float value)
+		{
+			Insert(&value, 4);
+		}
+
 		inline void AddID(int64_t value)
 		{
-			Insert(&value, 8);
+			if (Format.VarInts)
+				AddVarInt(WireFormat::ZigZag(value));
+			else
+				Insert(&value, 8);
 		}
 
 		inline void AddString(const std::string& str)
 		{
 			uint16_t strLen = (uint16_t)str.length();
-			Insert(&strLen, 2);
+			AddLength(strLen);
 			Insert(str.c_str(), strLen);
 		}
 
 		inline void AddBuffer(void* value, size_t size)
 		{
 			uint16_t len = (uint16_t)size;
-			Insert(&len, 2);
+			AddLength(len);
+			Insert(value, len);
+		}
+
+		// raw bytes with no length prefix, the reader must know how much to take
+		inline void AddBytes(const void* value, size_t size)
+		{
 			Insert(value, size);
 		}
 
+		// copies a packed, fixed size structure (see MessageSchema.h) in one go
+		template<class T>
+		inline void AddFixed(const T& value)
+		{
+			static_assert(std::is_trivially_copyable<T>::value, "fixed message data must be trivially copyable");
+			Insert(&value, sizeof(T));
+		}
+
 		inline void AddStateUpdatePos(StateUpdatePos& state)
 		{
 			Insert(&state, 8 + (4*3));
@@ -206,12 +575,20 @@ namespace EntityNetwork
 			Insert(&state, 8 + (4 * 7));
 		}
 
+		// hands the builder's storage off to a buffer without copying it, the builder is left empty and starts a new message on the next add
 		inline MessageBuffer::Ptr Pack()
 		{
 			if (Command != MessageCodes::NoCode)
+			{
+				if (Data.empty())
+					Data.push_back(0);
 				Data[0] = (char)Command;
+			}
+
+			if (Pool != nullptr)
+				return Pool->Adopt(std::move(Data));
 
-			return MessageBuffer::MakeShared(&(Data[0]), Data.size(), false);
+			return MessageBuffer::MakeShared(std::move(Data));
 		}
 	};
 
@@ -220,13 +597,17 @@ namespace EntityNetwork
 	public:
 		MessageBuffer::Ptr Message;
 		size_t ReadOffset = 0;
+		size_t ReadEnd = 0;			// end of the readable data, shorter than the message for messages inside a batch
 
 		MessageCodes Command = MessageCodes::NoOp;
 
+		WireFormat Format;
+
 		inline void Reset(MessageBuffer::Ptr data, bool useCode = true)
 		{
 			Message = data;
 			ReadOffset = 0;
+			ReadEnd = data != nullptr ? data->MessageLenght : 0;
 			if (useCode && data != nullptr && data->MessageLenght > 0)
 			{
 				ReadOffset = 1;
@@ -239,13 +620,13 @@ namespace EntityNetwork
 
 		inline bool Done()
 		{
-			return Message == nullptr || ReadOffset >= Message->MessageLenght;
+			return Message == nullptr || ReadOffset >= ReadEnd;
 		}
 
 		inline void End()
 		{
 			if (Message != nullptr)
-				ReadOffset = Message->MessageLenght;
+				ReadOffset = ReadEnd;
 			else
 				ReadOffset = 0;
 		}
@@ -255,10 +636,25 @@ namespace EntityNetwork
 			ReadOffset += size;
 		}
 
+		// the unread tail of the message, used for data that is not byte aligned such as bit streams
+		inline const void* RemainingData()
+		{
+			if (Done())
+				return nullptr;
+			return (char*)Message->MessageData + ReadOffset;
+		}
+
+		inline size_t RemainingSize()
+		{
+			if (Done())
+				return 0;
+			return ReadEnd - ReadOffset;
+		}
+
 	private:
 		void* Read(size_t size)
 		{
-			if (ReadOffset + size > Message->MessageLenght)
+			if (ReadOffset + size > ReadEnd)
 				return nullptr;
 
 			void* p = (char*)Message->MessageData + ReadOffset;
@@ -267,6 +663,44 @@ namespace EntityNetwork
 			return p;
 		}
 
+		// decodes a varint at the offset without consuming it, returns the number of bytes used or 0 if the data is truncated
+		size_t PeekVarInt(size_t offset, uint64_t& value)
+		{
+			value = 0;
+			const unsigned char* p = static_cast<const unsigned char*>(Message->MessageData);
+			for (size_t i = 0; i < 10 && offset + i < ReadEnd; i++)
+			{
+				value |= static_cast<uint64_t>(p[offset + i] & 0x7F) << (7 * i);
+				if ((p[offset + i] & 0x80) == 0)
+					return i + 1;
+			}
+			return 0;
+		}
+
+		// reads the size prefix of a string or buffer, returns the number of bytes used by the prefix or 0 if the data is truncated
+		size_t PeekLength(size_t& lenght)
+		{
+			lenght = 0;
+			if (Message == nullptr)
+				return 0;
+
+			if (Format.VarInts)
+			{
+				uint64_t value = 0;
+				size_t used = PeekVarInt(ReadOffset, value);
+				lenght = static_cast<size_t>(value);
+				return used;
+			}
+
+			if (ReadOffset + 2 > ReadEnd)
+				return 0;
+
+			uint16_t len = 0;
+			memcpy(&len, (char*)Message->MessageData + ReadOffset, 2);
+			lenght = len;
+			return 2;
+		}
+
 	public:
 
 		inline MessageBufferReader(MessageBuffer::Ptr data, bool useCommand = true)
@@ -274,8 +708,66 @@ namespace EntityNetwork
 			Reset(data, useCommand);
 		}
 
+		inline MessageBufferReader(MessageBuffer::Ptr data, const WireFormat& format) : Format(format)
+		{
+			Reset(data, true);
+		}
+
+		// reads the next message out of a Batch, the sub reader shares the batch data and is limited to the framed message
+		inline MessageBufferReader ReadBatchedMessage(const WireFormat& format)
+		{
+			MessageBufferReader sub(nullptr, format);
+			uint64_t lenght = ReadVarInt();
+			if (Done() || lenght == 0 || ReadOffset + lenght > ReadEnd)
+			{
+				End();
+				return sub;
+			}
+
+			sub.Message = Message;
+			sub.Command = static_cast<MessageCodes>(static_cast<unsigned char*>(Message->MessageData)[ReadOffset]);
+			sub.ReadOffset = ReadOffset + 1;
+			sub.ReadEnd = ReadOffset + static_cast<size_t>(lenght);
+			ReadOffset = sub.ReadEnd;
+			return sub;
+		}
+
+		// reads a packed, fixed size structure (see MessageSchema.h) with a single bounds check, returns false if the message is too short
+		template<class T>
+		inline bool ReadFixed(T& value)
+		{
+			static_assert(std::is_trivially_copyable<T>::value, "fixed message data must be trivially copyable");
+			void* p = Read(sizeof(T));
+			if (p == nullptr)
+			{
+				End();
+				return false;
+			}
+			memcpy(&value, p, sizeof(T));
+			return true;
+		}
+
+		inline uint64_t ReadVarInt()
+		{
+			if (Message == nullptr)
+				return 0;
+
+			uint64_t value = 0;
+			size_t used = PeekVarInt(ReadOffset, value);
+			if (used == 0)
+			{
+				End();
+				return 0;
+			}
+			ReadOffset += used;
+			return value;
+		}
+
 		inline int ReadInt()
 		{
+			if (Format.VarInts)
+				return static_cast<int>(WireFormat::UnZigZag(ReadVarInt()));
+
 			void* p = Read(4);
 			if (p == nullptr)
 				return 0;
@@ -295,11 +787,25 @@ namespace EntityNetwork
 			void* p = Read(1);
 			if (p == nullptr)
 				return false;
-			return static_cast<unsigned char*>(p) != 0;
+			return *static_cast<unsigned char*>(p) != 0;
+		}
+
+		inline float ReadFloat()
+		{
+			void* p = Read(4);
+			if (p == nullptr)
+				return 0;
+
+			float value = 0;
+			memcpy(&value, p, 4);
+			return value;
 		}
 
 		inline int64_t ReadID()
 		{
+			if (Format.VarInts)
+				return WireFormat::UnZigZag(ReadVarInt());
+
 			void* p = Read(8);
 			if (p == nullptr)
 				return 0;
@@ -308,12 +814,13 @@ namespace EntityNetwork
 
 		inline std::string ReadString()
 		{
-			void* p = Read(2);
-			if (p == nullptr)
+			size_t strLen = 0;
+			size_t used = PeekLength(strLen);
+			if (used == 0)
 				return std::string();
-			size_t strLen = *(uint16_t*)p;
+			ReadOffset += used;
 
-			p = Read(strLen);
+			void* p = Read(strLen);
 			if (p == nullptr)
 				return std::string();
 
@@ -322,23 +829,20 @@ namespace EntityNetwork
 
 		inline size_t PeakBufferSize()
 		{
-			if (ReadOffset + 2 > Message->MessageLenght)
-				return 0;
-
-			void* p = (char*)Message->MessageData + ReadOffset;
-			size_t buffLen = *(uint16_t*)p;
-
+			size_t buffLen = 0;
+			PeekLength(buffLen);
 			return buffLen;
 		}
 
 		inline bool ReadBuffer(void* destinationBuffer)
 		{
-			void* p = Read(2);
-			if (p == nullptr)
+			size_t buffLen = 0;
+			size_t used = PeekLength(buffLen);
+			if (used == 0)
 				return false;
-			size_t buffLen = *(uint16_t*)p;
+			ReadOffset += used;
 
-			p = Read(buffLen);
+			void* p = Read(buffLen);
 			if (p == nullptr)
 				return false;
 
@@ -348,6 +852,22 @@ namespace EntityNetwork
 			return true;
 		}
 
+		// returns a pointer to the buffer data inside the message without copying it, nullptr if the message is truncated
+		inline const void* ReadBufferData(size_t& lenght)
+		{
+			size_t used = PeekLength(lenght);
+			if (used == 0)
+				return nullptr;
+			ReadOffset += used;
+
+			return Read(lenght);
+		}
+
+		inline bool SkipBuffer()
+		{
+			return ReadBuffer(nullptr);
+		}
+
 		inline StateUpdatePos ReadStateUpdatePos()
 		{
 			void* p = Read(8);
@@ -78,6 +78,17 @@ namespace EntityNetwork
 			return std::nullopt;
 		}
 
+		// the stored value itself so it can be changed in place, nullptr if the key is not found. Only valid until the key is removed
+		inline V* TryGet(K key)
+		{
+			MutexGuardian guardian(DataMutex);
+			auto itr = Data.find(key);
+			if (itr != Data.end())
+				return &itr->second;
+
+			return nullptr;
+		}
+
 		inline bool ContainsKey(K key)
 		{
 			MutexGuardian guardian(DataMutex);
@@ -74,5 +74,146 @@ namespace EntityNetwork
 			Messages.insert(Messages.end(), raw.begin(), raw.end());
 			newMessages.ReleaseExclusiveAccess();
 		}
+
+		// packs runs of queued messages into Batch messages of no more than maxSize bytes so the transport sends fewer, fuller packets.
+		// messages that are too big to share a packet are left as they are, and so is the HailCheck so a client of any build can read it. order is preserved
+		inline void Coalesce(MessageBufferPool::Ptr pool, size_t maxSize)
+		{
+			MutexGuardian guardian(MessageMutex);
+			if (Messages.size() < 2 || maxSize == 0)
+				return;
+
+			MessageBufferBuilder batch(pool, MessageCodes::Batch);
+			MessageBuffer::Ptr first;	// held back until a second message joins it, a batch of one is sent as the plain message
+			size_t batchSize = 0;
+			size_t write = 0;
+
+			auto addFrame = [&batch](MessageBuffer::Ptr& msg)
+			{
+				batch.AddVarInt(msg->MessageLenght);
+				batch.AddBytes(msg->MessageData, msg->MessageLenght);
+			};
+
+			auto flush = [&]()
+			{
+				if (first != nullptr)
+					Messages[write++] = first;
+				else if (batchSize > 0)
+					Messages[write++] = batch.Pack();
+
+				first = nullptr;
+				batchSize = 0;
+			};
+
+			for (size_t i = 0; i < Messages.size(); i++)
+			{
+				MessageBuffer::Ptr msg = Messages[i];
+				size_t framed = msg == nullptr ? 0 : msg->MessageLenght + VarIntSize(msg->MessageLenght);
+				if (framed == 0 || framed + 1 > maxSize || static_cast<unsigned char*>(msg->MessageData)[0] == static_cast<unsigned char>(MessageCodes::HailCheck))
+				{
+					flush();
+					Messages[write++] = msg;
+					continue;
+				}
+
+				if (batchSize > 0 && batchSize + framed > maxSize)
+					flush();
+
+				if (batchSize == 0)
+				{
+					first = msg;
+					batchSize = 1 + framed;
+					continue;
+				}
+
+				if (first != nullptr)
+				{
+					addFrame(first);
+					first = nullptr;
+				}
+				addFrame(msg);
+				batchSize += framed;
+			}
+			flush();
+
+			Messages.resize(write);
+		}
+
+	private:
+		static inline size_t VarIntSize(uint64_t value)
+		{
+			size_t size = 1;
+			while (value >= 0x80)
+			{
+				value >>= 7;
+				size++;
+			}
+			return size;
+		}
+	};
+
+	// a peer's outbound messages, one queue for each Reliability class
+	class OutboundMessageQueues
+	{
+	public:
+		inline MutexedMessageBufferDeque& operator[](Reliability reliability)
+		{
+			return Queues[static_cast<size_t>(reliability)];
+		}
+
+		inline bool Empty()
+		{
+			for (auto& queue : Queues)
+			{
+				if (!queue.Empty())
+					return false;
+			}
+			return true;
+		}
+
+		inline size_t Size()
+		{
+			size_t size = 0;
+			for (auto& queue : Queues)
+				size += queue.Size();
+			return size;
+		}
+
+		// the next message of any class, reliable ones first. For transports that send everything the same way
+		inline MessageBuffer::Ptr Pop()
+		{
+			for (auto& queue : Queues)
+			{
+				MessageBuffer::Ptr msg = queue.Pop();
+				if (msg != nullptr)
+					return msg;
+			}
+			return nullptr;
+		}
+
+		inline MessageBuffer::Ptr Pop(Reliability reliability)
+		{
+			return (*this)[reliability].Pop();
+		}
+
+		inline void Push(MessageBuffer::Ptr msg, Reliability reliability = Reliability::ReliableOrdered)
+		{
+			(*this)[reliability].Push(msg);
+		}
+
+		inline void AppendRange(MutexedVector<MessageBuffer::Ptr>& newMessages, Reliability reliability = Reliability::ReliableOrdered)
+		{
+			(*this)[reliability].AppendRange(newMessages);
+		}
+
+		// batches never mix classes
+		inline void Coalesce(MessageBufferPool::Ptr pool, size_t maxSize)
+		{
+			for (auto& queue : Queues)
+				queue.Coalesce(pool, maxSize);
+		}
+
+	private:
+		MutexedMessageBufferDeque Queues[ReliabilityClasses];
 	};
 }
\ No newline at end of file
@@ -162,5 +162,12 @@ namespace EntityNetwork
 			MutexGuardian guardian(DataMutex);
 			Data = other;
 		}
+
+		// exchanges the contents with other, used to take everything queued so far in one lock
+		inline void Swap(std::vector<V>& other)
+		{
+			MutexGuardian guardian(DataMutex);
+			Data.swap(other);
+		}
 	};
 }
\ No newline at end of file
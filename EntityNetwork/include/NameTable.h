@@ -0,0 +1,146 @@
+//  Copyright (c) 2020 Jeffery Myers
+//
+//	EntityNetwork and its associated sub proejcts are free software;
+//
+//	Permission is hereby granted, free of charge, to any person obtaining a copy
+//	of this software and associated documentation files (the "Software"), to deal
+//	in the Software without restriction, including without limitation the rights
+//	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//	copies of the Software, and to permit persons to whom the Software is
+//	furnished to do so, subject to the following conditions:
+//	
+//	The above copyright notice and this permission notice shall be included in all
+//	copies or substantial portions of the Software.
+//	
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//	SOFTWARE.
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <shared_mutex>
+#include <mutex>
+#include <functional>
+
+namespace EntityNetwork
+{
+	// stable integer stand in for an interned name, compare and hash it instead of the string
+	class NameKey
+	{
+	public:
+		uint32_t ID = 0;	// 0 is never handed out
+
+		inline bool Valid() const { return ID != 0; }
+		inline bool operator == (const NameKey& other) const { return ID == other.ID; }
+		inline bool operator != (const NameKey& other) const { return ID != other.ID; }
+	};
+
+	// process wide string interning, the same name always gets the same key. Thread safe
+	class NameTable
+	{
+	public:
+		// key for the name, added on first use. Cache the result (a static is fine) for names used in hot paths
+		static inline NameKey Intern(const std::string& name)
+		{
+			NameTable& table = Instance();
+			{
+				std::shared_lock<std::shared_mutex> reading(table.TableMutex);
+				auto itr = table.Keys.find(name);
+				if (itr != table.Keys.end())
+					return itr->second;
+			}
+
+			std::unique_lock<std::shared_mutex> writing(table.TableMutex);
+			auto itr = table.Keys.find(name);
+			if (itr != table.Keys.end())
+				return itr->second;
+
+			table.Names.push_back(name);
+			NameKey key;
+			key.ID = static_cast<uint32_t>(table.Names.size());
+			table.Keys[name] = key;
+			return key;
+		}
+
+		// key for an already interned name, an invalid key if it never was
+		static inline NameKey Find(const std::string& name)
+		{
+			NameTable& table = Instance();
+			std::shared_lock<std::shared_mutex> reading(table.TableMutex);
+			auto itr = table.Keys.find(name);
+			if (itr != table.Keys.end())
+				return itr->second;
+			return NameKey();
+		}
+
+		static inline std::string GetName(NameKey key)
+		{
+			NameTable& table = Instance();
+			std::shared_lock<std::shared_mutex> reading(table.TableMutex);
+			if (!key.Valid() || key.ID > table.Names.size())
+				return std::string();
+			return table.Names[key.ID - 1];
+		}
+
+	private:
+		static inline NameTable& Instance()
+		{
+			static NameTable table;
+			return table;
+		}
+
+		std::unordered_map<std::string, NameKey> Keys;
+		std::vector<std::string> Names;
+		std::shared_mutex TableMutex;
+	};
+
+	// hashed name lookup for things registered by name (definitions, properties, RPCs), filled in as they are registered.
+	// lookups take a shared lock on the index only, never the lock of the container holding the values
+	template<class V>
+	class NameIndex
+	{
+	public:
+		// a name that is already registered keeps its first value, as a scan in registration order would find
+		inline void Add(const std::string& name, const V& value)
+		{
+			NameKey key = NameTable::Intern(name);
+
+			std::unique_lock<std::shared_mutex> writing(IndexMutex);
+			ByName.emplace(name, value);
+			ByKey.emplace(key.ID, value);
+		}
+
+		// the value registered under the name, or fallback
+		inline V Find(const std::string& name, const V& fallback) const
+		{
+			std::shared_lock<std::shared_mutex> reading(IndexMutex);
+			auto itr = ByName.find(name);
+			return itr == ByName.end() ? fallback : itr->second;
+		}
+
+		inline V Find(NameKey key, const V& fallback) const
+		{
+			std::shared_lock<std::shared_mutex> reading(IndexMutex);
+			auto itr = ByKey.find(key.ID);
+			return itr == ByKey.end() ? fallback : itr->second;
+		}
+
+		inline void Clear()
+		{
+			std::unique_lock<std::shared_mutex> writing(IndexMutex);
+			ByName.clear();
+			ByKey.clear();
+		}
+
+	private:
+		std::unordered_map<std::string, V> ByName;
+		std::unordered_map<uint32_t, V> ByKey;
+		mutable std::shared_mutex IndexMutex;
+	};
+}
@@ -23,30 +23,68 @@
 
 #include "PropertyDescriptor.h"
 #include "MutexedMessageBuffer.h"
+#include "BitStream.h"
+#include "PropertyDelta.h"
 #include "ThreadTools.h"
 #include <mutex>
+#include <atomic>
 #include <string>
 #include <memory>
 #include <vector>
 #include <functional>
+#include <algorithm>
+#include <limits>
 
 namespace EntityNetwork
 {
-	typedef unsigned char revision_t;
+	typedef uint64_t tick_t;	// server update counter, changes are stamped with the tick that replicates them
+
+	template<class T> class PropertyHandle;
 
 	class PropertyData
 	{
 	private:
-		bool Dirty = false;
-		std::mutex DirtyMutex;
+		template<class T> friend class PropertyHandle;
+
+		// values up to this size (every fixed size type) live inside the object, larger ones keep their heap block as they change size
+		static constexpr size_t InlineCapacity = 40;
+		alignas(8) char InlineData[InlineCapacity];
+
+		// sets the value size, existing storage is reused when it is big enough. Contents are undefined after a grow
+		inline void Resize(size_t lenght)
+		{
+			if (DataPtr == nullptr)
+			{
+				DataPtr = InlineData;
+				DataCapacity = InlineCapacity;
+			}
+
+			if (lenght > DataCapacity)
+			{
+				if (DataPtr != InlineData && !ExternalStorage)
+					delete[] (char*)DataPtr;
+
+				ExternalStorage = false;
+				DataCapacity = std::max(lenght, DataCapacity * 2);
+				DataPtr = (void*) new char[DataCapacity];
+			}
+			DataLenght = lenght;
+		}
 
-		revision_t Revision = 0;
+		bool ExternalStorage = false;	// DataPtr is owned by an ArchetypeStore column
 
+		// dirty flag in the low bit, change tick above it. One word so both are read together without a lock
+		static constexpr uint64_t DirtyBit = 0x01;
+		static constexpr int TickShift = 1;
+		std::atomic<uint64_t> State = { 0 };
+
+		// release so a reader that sees the flag also sees the value written before it
 		void SetDirty()
 		{
-			MutexGuardian guard(DirtyMutex);
-			Dirty = true;
-			Revision++;
+			State.fetch_or(DirtyBit, std::memory_order_release);
+
+			if (ChangeListener)
+				ChangeListener(Descriptor->ID);
 		}
 
 	public:
@@ -59,79 +97,70 @@ namespace EntityNetwork
 
 		void*	DataPtr = nullptr;
 		size_t DataLenght = 0;
+		size_t DataCapacity = 0;
+
+		// last value received from the server, the reference for delta encoded updates (WireFormat::DeltaValues)
+		std::vector<char> DeltaBaseline;
+
+		// called with the property ID after every change, set by the owning entity
+		std::function<void(int)> ChangeListener;
+
+		inline bool IsDirty() const
+		{
+			return (State.load(std::memory_order_acquire) & DirtyBit) != 0;
+		}
 
-		inline bool IsDirty()
+		// tick of the last update that replicated a change to this value, 0 if it has never changed on a server
+		inline tick_t GetChangeTick() const
 		{
-			MutexGuardian guard(DirtyMutex);
-			return Dirty;
+			return State.load(std::memory_order_acquire) >> TickShift;
 		}
 
-		inline revision_t GetRevision()
+		// called by the server when it collects a change, keeps the dirty flag
+		inline void StampChange(tick_t tick)
 		{
-			MutexGuardian guard(DirtyMutex);
-			return Revision;
+			uint64_t state = State.load(std::memory_order_relaxed);
+			while (!State.compare_exchange_weak(state, (tick << TickShift) | (state & DirtyBit), std::memory_order_release, std::memory_order_relaxed));
 		}
 
 		inline void SetClean()
 		{
-			MutexGuardian guard(DirtyMutex);
-			Dirty = false;
+			State.fetch_and(~DirtyBit, std::memory_order_release);
 		}
 
 		PropertyData(PropertyDesc::Ptr desc) : Descriptor(desc)
 		{
+			Reset();
+		}
+
+		// back to the constructed state, a zeroed value of the default size that is clean and has never changed. Existing storage is kept
+		inline void Reset()
+		{
+			State.store(0, std::memory_order_release);
+			DeltaBaseline.clear();
+
 			DataLenght = 0;
-			if (desc == nullptr)
+			if (Descriptor == nullptr)
 				return;
 
-			switch (desc->DataType)
+			size_t lenght = 0;
+			switch (Descriptor->DataType)
 			{
-			case PropertyDesc::DataTypes::Integer:
-			case PropertyDesc::DataTypes::Float:
-				DataLenght = 4;
-				break;
-
-			case PropertyDesc::DataTypes::Vector3I:
-			case PropertyDesc::DataTypes::Vector3F:
-				DataLenght = 4 * 3;
-				break;
-
-			case PropertyDesc::DataTypes::Vector4I:
-			case PropertyDesc::DataTypes::Vector4F:
-				DataLenght = 4 * 4;
-				break;
-
-			case PropertyDesc::DataTypes::Double:
-				DataLenght = 8;
-				break;
-
-			case PropertyDesc::DataTypes::Vector3D:
-				DataLenght = 8 * 3;
-				break;
-
-			case PropertyDesc::DataTypes::Vector4D:
-				DataLenght = 8 * 4;
-				break;
-
 			case PropertyDesc::DataTypes::String:
-				DataLenght = desc->BufferSize == 0 ? 64 : desc->BufferSize;
+				lenght = Descriptor->BufferSize == 0 ? 64 : Descriptor->BufferSize;
 				break;
 
 			case PropertyDesc::DataTypes::Buffer:
-				DataLenght = desc->BufferSize;
-				break;
-
-			case PropertyDesc::DataTypes::StateV3F:
-				DataLenght = 8 + (4 * 3);
+				lenght = Descriptor->BufferSize;
 				break;
 
-			case PropertyDesc::DataTypes::StateV3FQ4F:
-				DataLenght = 8 + (4 * 7);
+			default:
+				lenght = Descriptor->FixedDataSize();
 				break;
-
 			}
 
-			DataPtr = (void*) new char[DataLenght];
+			Resize(lenght);
+			memset(DataPtr, 0, DataLenght);
 		}
 
 		static inline std::shared_ptr<PropertyData> MakeShared(PropertyDesc::Ptr desc)
@@ -141,13 +170,52 @@ namespace EntityNetwork
 
 		virtual ~PropertyData()
 		{
-			if (DataPtr != nullptr)
-				delete[] DataPtr;
+			if (DataPtr != InlineData && !ExternalStorage)
+				delete[] (char*)DataPtr;
 
 			DataPtr = nullptr;
 			DataLenght = 0;
 		}
 
+		// moves the value into storage owned by someone else (an ArchetypeStore column slot), fixed size values only
+		inline void BindStorage(void* storage)
+		{
+			if (storage == nullptr || storage == DataPtr)
+				return;
+
+			memcpy(storage, DataPtr, DataLenght);
+			if (DataPtr != InlineData && !ExternalStorage)
+				delete[] (char*)DataPtr;
+
+			DataPtr = storage;
+			DataCapacity = DataLenght;
+			ExternalStorage = true;
+		}
+
+		// copies the value back inside the object so it outlives the external storage
+		inline void UnbindStorage()
+		{
+			if (!ExternalStorage)
+				return;
+
+			memcpy(InlineData, DataPtr, DataLenght);
+			DataPtr = InlineData;
+			DataCapacity = InlineCapacity;
+			ExternalStorage = false;
+		}
+
+		inline bool HasExternalStorage() const { return ExternalStorage; }
+
+		// detached copy of the value and change tick for readers on other threads, clean and without a listener
+		inline Ptr CopyValue() const
+		{
+			auto copy = MakeShared(Descriptor);
+			copy->Resize(DataLenght);
+			memcpy(copy->DataPtr, DataPtr, DataLenght);
+			copy->State.store(State.load(std::memory_order_acquire) & ~DirtyBit, std::memory_order_relaxed);
+			return copy;
+		}
+
 		inline void SetValueI(int val)
 		{
 			if (Descriptor->DataType != PropertyDesc::DataTypes::Integer)
@@ -345,11 +413,7 @@ namespace EntityNetwork
 			if (Descriptor->DataType != PropertyDesc::DataTypes::String)
 				return;
 
-			DataLenght = strlen(value)+1;
-			if (DataPtr != nullptr)
-				delete[] DataPtr;
-
-			DataPtr = (void*) new char[DataLenght];
+			Resize(strlen(value) + 1);
 			memcpy(DataPtr, value, DataLenght-1);
 			((char*)DataPtr)[DataLenght - 1] = '\0';
 			SetDirty();
@@ -360,11 +424,7 @@ namespace EntityNetwork
 			if (Descriptor->DataType != PropertyDesc::DataTypes::String)
 				return;
 
-			DataLenght = value.size() + 1;
-			if (DataPtr != nullptr)
-				delete[] DataPtr;
-
-			DataPtr = (void*) new char[DataLenght];
+			Resize(value.size() + 1);
 			memcpy(DataPtr, value.c_str(), value.size());
 			((char*)DataPtr)[value.size()] = '\0';
 			SetDirty();
@@ -383,11 +443,7 @@ namespace EntityNetwork
 			if (Descriptor->DataType != PropertyDesc::DataTypes::Buffer)
 				return;
 
-			DataLenght = lenght;
-			if (DataPtr != nullptr)
-				delete[] DataPtr;
-
-			DataPtr = (void*) new char[lenght];
+			Resize(lenght);
 			memcpy(DataPtr, value, DataLenght);
 			SetDirty();
 		}
@@ -413,7 +469,9 @@ namespace EntityNetwork
 			if (Descriptor->DataType != PropertyDesc::DataTypes::StateV3F)
 				return StateUpdatePos();
 
-			return *(StateUpdatePos*)DataPtr;
+			StateUpdatePos val;
+			memcpy(&val, DataPtr, DataLenght);
+			return val;
 		}
 
 		inline void SetValueStateUpdatePosRot(StateUpdatePosRot val)
@@ -429,7 +487,9 @@ namespace EntityNetwork
 			if (Descriptor->DataType != PropertyDesc::DataTypes::StateV3FQ4F)
 				return StateUpdatePosRot();
 
-			return *(StateUpdatePosRot*)DataPtr;
+			StateUpdatePosRot val;
+			memcpy(&val, DataPtr, DataLenght);
+			return val;
 		}
 
 		inline void SetValueWriter(MessageBufferBuilder& builder)
@@ -441,11 +501,7 @@ namespace EntityNetwork
 			if (builder.Command != MessageCodes::NoCode)
 				offset = 1;
 
-			DataLenght = builder.Data.size() - offset;
-			if (DataPtr != nullptr)
-				delete[] DataPtr;
-
-			DataPtr = (void*) new char[DataLenght];
+			Resize(builder.Data.size() - offset);
 			memcpy(DataPtr, &builder.Data[offset], DataLenght);
 			SetDirty();
 		}
@@ -461,24 +517,276 @@ namespace EntityNetwork
 		inline void PackValue(MessageBufferBuilder& builder)
 		{
 			builder.AddByte(Descriptor->ID);
-			builder.AddBuffer(DataPtr, DataLenght);
+			PackData(builder);
+		}
+
+		// the value without the property ID in front of it, as UnpackValue reads it
+		inline void PackData(MessageBufferBuilder& builder)
+		{
+			if (!Descriptor->Quantized())
+			{
+				builder.AddBuffer(DataPtr, DataLenght);
+				return;
+			}
+
+			static thread_local BitStreamWriter writer;
+			writer.Reset();
+			PackQuantized(writer);
+			builder.AddBuffer(writer.Data.data(), writer.ByteSize());
+		}
+
+		// bit packed form used by entity updates, fixed sized values have no length prefix
+		inline void PackBits(BitStreamWriter& writer)
+		{
+			if (Descriptor->Quantized())
+			{
+				PackQuantized(writer);
+				return;
+			}
+
+			if (Descriptor->FixedDataSize() == 0)
+				writer.WriteBits(DataLenght, 16);
+
+			writer.WriteBytes(DataPtr, DataLenght);
+		}
+
+		inline void UnpackBits(BitStreamReader& reader, bool save)
+		{
+			if (Descriptor->Quantized())
+			{
+				UnpackQuantized(reader, save);
+				return;
+			}
+
+			size_t lenght = Descriptor->FixedDataSize();
+			if (lenght == 0)
+				lenght = static_cast<size_t>(reader.ReadBits(16));
+
+			if (!save)
+			{
+				reader.ReadBytes(nullptr, lenght);
+				return;
+			}
+
+			Resize(lenght);
+			reader.ReadBytes(DataPtr, DataLenght);
+			SetDirty();
 		}
 
 		inline void UnpackValue(MessageBufferReader& reader, bool save)
 		{
 			if (!save)
-				reader.Advance(reader.PeakBufferSize() + 2);
-			else
+				reader.SkipBuffer();
+			else if (Descriptor->Quantized())
 			{
-				DataLenght = reader.PeakBufferSize();
-				if (DataPtr != nullptr)
-					delete[] DataPtr;
+				size_t lenght = 0;
+				const void* data = reader.ReadBufferData(lenght);
+				if (data == nullptr)
+					return;
 
-				DataPtr = (void*) new char[DataLenght];
+				BitStreamReader bits(data, lenght);
+				UnpackQuantized(bits, true);
+			}
+			else
+			{
+				Resize(reader.PeakBufferSize());
 				reader.ReadBuffer(DataPtr);
 
 				SetDirty();
 			}
 		}
+
+		// writes the value as a delta from the baseline (the last value the peer has) when that is smaller, otherwise the full value.
+		// the property ID goes in front as a varint with the low bit set for a delta (ReadDeltaHeader). The baseline is updated to the current value
+		inline void PackDelta(MessageBufferBuilder& builder, std::vector<char>& baseline)
+		{
+			static thread_local std::vector<char> delta;
+			bool useDelta = !Descriptor->Quantized() && PropertyDelta::Encode(Descriptor->DataType, DataPtr, DataLenght, baseline, delta) && delta.size() < DataLenght;
+
+			builder.AddVarInt((static_cast<uint64_t>(Descriptor->ID) << 1) | (useDelta ? 1 : 0));
+			if (useDelta)
+				builder.AddBuffer(delta.data(), delta.size());
+			else
+				PackData(builder);
+
+			if (!Descriptor->Quantized())
+				baseline.assign(static_cast<char*>(DataPtr), static_cast<char*>(DataPtr) + DataLenght);
+		}
+
+		// reads the property ID PackDelta writes in front of a value, -1 if it can't be a property ID
+		static inline int ReadDeltaHeader(MessageBufferReader& reader, bool& isDelta)
+		{
+			uint64_t header = reader.ReadVarInt();
+			isDelta = (header & 1) != 0;
+			if ((header >> 1) > static_cast<uint64_t>(std::numeric_limits<int>::max()))
+				return -1;
+			return static_cast<int>(header >> 1);
+		}
+
+		// reads a value written by PackDelta, the header has already been read.
+		// the baseline follows the sender even when the value is not saved, false when it could not be read
+		inline bool UnpackDelta(MessageBufferReader& reader, bool save, bool isDelta, std::vector<char>& baseline)
+		{
+			if (Descriptor->Quantized())
+			{
+				UnpackValue(reader, save);
+				return true;
+			}
+
+			size_t lenght = 0;
+			const void* data = reader.ReadBufferData(lenght);
+			if (data == nullptr)
+				return false;
+
+			if (!isDelta)
+				baseline.assign(static_cast<const char*>(data), static_cast<const char*>(data) + lenght);
+			else if (!PropertyDelta::Decode(Descriptor->DataType, data, lenght, baseline))
+				return false;
+
+			if (save)
+				StoreValue(baseline.data(), baseline.size());
+			return true;
+		}
+
+		// bit packed form of PackDelta, a flag bit says if a delta or the full value follows
+		inline void PackBitsDelta(BitStreamWriter& writer, std::vector<char>& baseline)
+		{
+			if (Descriptor->Quantized())
+			{
+				PackBits(writer);
+				return;
+			}
+
+			static thread_local std::vector<char> delta;
+			bool useDelta = PropertyDelta::Encode(Descriptor->DataType, DataPtr, DataLenght, baseline, delta) && delta.size() < DataLenght;
+			writer.WriteBool(useDelta);
+			if (useDelta)
+			{
+				writer.WriteBits(delta.size(), 16);
+				writer.WriteBytes(delta.data(), delta.size());
+			}
+			else
+				PackBits(writer);
+
+			baseline.assign(static_cast<char*>(DataPtr), static_cast<char*>(DataPtr) + DataLenght);
+		}
+
+		inline void UnpackBitsDelta(BitStreamReader& reader, bool save, std::vector<char>& baseline)
+		{
+			if (Descriptor->Quantized())
+			{
+				UnpackBits(reader, save);
+				return;
+			}
+
+			if (reader.ReadBool())
+			{
+				static thread_local std::vector<char> delta;
+				delta.resize(static_cast<size_t>(reader.ReadBits(16)));
+				reader.ReadBytes(delta.data(), delta.size());
+				if (reader.Overflow || !PropertyDelta::Decode(Descriptor->DataType, delta.data(), delta.size(), baseline))
+					return;
+			}
+			else
+			{
+				size_t lenght = Descriptor->FixedDataSize();
+				if (lenght == 0)
+					lenght = static_cast<size_t>(reader.ReadBits(16));
+
+				baseline.resize(lenght);
+				reader.ReadBytes(baseline.data(), lenght);
+				if (reader.Overflow)
+					return;
+			}
+
+			if (save)
+				StoreValue(baseline.data(), baseline.size());
+		}
+
+	private:
+		inline void StoreValue(const void* data, size_t lenght)
+		{
+			Resize(lenght);
+			memcpy(DataPtr, data, DataLenght);
+			SetDirty();
+		}
+
+		// float components of the quantizable types, the 64 bit step of state types goes out as is
+		inline void GetQuantizedLayout(size_t& rawBytes, int& positions, int& rotations) const
+		{
+			rawBytes = 0;
+			positions = 0;
+			rotations = 0;
+			switch (Descriptor->DataType)
+			{
+			case PropertyDesc::DataTypes::Float:
+				positions = 1;
+				break;
+
+			case PropertyDesc::DataTypes::Vector3F:
+				positions = 3;
+				break;
+
+			case PropertyDesc::DataTypes::Vector4F:
+				positions = 4;
+				break;
+
+			case PropertyDesc::DataTypes::StateV3F:
+				rawBytes = 8;
+				positions = 3;
+				break;
+
+			case PropertyDesc::DataTypes::StateV3FQ4F:
+				rawBytes = 8;
+				positions = 3;
+				rotations = 4;
+				break;
+
+			default:
+				break;
+			}
+		}
+
+		inline void PackQuantized(BitStreamWriter& writer)
+		{
+			size_t rawBytes = 0;
+			int positions = 0, rotations = 0;
+			GetQuantizedLayout(rawBytes, positions, rotations);
+
+			writer.WriteBytes(DataPtr, rawBytes);
+
+			const float* components = reinterpret_cast<const float*>(static_cast<char*>(DataPtr) + rawBytes);
+			for (int i = 0; i < positions; i++)
+				writer.WriteQuantizedFloat(components[i], Descriptor->QuantizeMin, Descriptor->QuantizeMax, Descriptor->QuantizeBits);
+
+			for (int i = 0; i < rotations; i++)
+				writer.WriteQuantizedFloat(components[positions + i], -1.0f, 1.0f, Descriptor->QuantizeBits);
+		}
+
+		inline void UnpackQuantized(BitStreamReader& reader, bool save)
+		{
+			size_t rawBytes = 0;
+			int positions = 0, rotations = 0;
+			GetQuantizedLayout(rawBytes, positions, rotations);
+
+			if (!save)
+			{
+				reader.ReadBytes(nullptr, rawBytes);
+				for (int i = 0; i < positions + rotations; i++)
+					reader.ReadBits(Descriptor->QuantizeBits);
+				return;
+			}
+
+			reader.ReadBytes(DataPtr, rawBytes);
+
+			float* components = reinterpret_cast<float*>(static_cast<char*>(DataPtr) + rawBytes);
+			for (int i = 0; i < positions; i++)
+				components[i] = reader.ReadQuantizedFloat(Descriptor->QuantizeMin, Descriptor->QuantizeMax, Descriptor->QuantizeBits);
+
+			for (int i = 0; i < rotations; i++)
+				components[positions + i] = reader.ReadQuantizedFloat(-1.0f, 1.0f, Descriptor->QuantizeBits);
+
+			SetDirty();
+		}
 	};
 }
\ No newline at end of file
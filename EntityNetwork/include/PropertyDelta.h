@@ -0,0 +1,227 @@
+//  Copyright (c) 2020 Jeffery Myers
+//
+//	EntityNetwork and its associated sub proejcts are free software;
+//
+//	Permission is hereby granted, free of charge, to any person obtaining a copy
+//	of this software and associated documentation files (the "Software"), to deal
+//	in the Software without restriction, including without limitation the rights
+//	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//	copies of the Software, and to permit persons to whom the Software is
+//	furnished to do so, subject to the following conditions:
+//	
+//	The above copyright notice and this permission notice shall be included in all
+//	copies or substantial portions of the Software.
+//	
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//	SOFTWARE.
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <cstring>
+
+#include "PropertyDescriptor.h"
+#include "Messages.h"
+
+namespace EntityNetwork
+{
+	// encodes a property value as the difference from a baseline value both sides already have (WireFormat::DeltaValues).
+	// numeric components (ints, floats, doubles and state steps) send the zigzag varint of the arithmetic difference of their bit patterns,
+	// so unchanged components cost one byte and nearby floats of the same sign only a few.
+	// strings and buffers of the same size send runs of XORed bytes that differ.
+	class PropertyDelta
+	{
+	public:
+		// writes the delta from baseline to value into out, returns false if the value can't be delta encoded against the baseline
+		static inline bool Encode(PropertyDesc::DataTypes dataType, const void* value, size_t lenght, const std::vector<char>& baseline, std::vector<char>& out)
+		{
+			out.clear();
+			if (baseline.size() != lenght || lenght == 0)
+				return false;
+
+			const unsigned char* current = static_cast<const unsigned char*>(value);
+			const unsigned char* previous = reinterpret_cast<const unsigned char*>(baseline.data());
+
+			if (PropertyDesc::FixedDataSize(dataType) == 0)
+			{
+				EncodeRuns(current, previous, lenght, out);
+				return true;
+			}
+
+			size_t offset = 0;
+			size_t firstSize = 0, componentSize = 0;
+			GetComponentLayout(dataType, firstSize, componentSize);
+			while (offset < lenght)
+			{
+				size_t size = offset == 0 ? firstSize : componentSize;
+				if (size == 8)
+					WriteVarInt(out, WireFormat::ZigZag(static_cast<int64_t>(Load64(current + offset) - Load64(previous + offset))));
+				else
+					WriteVarInt(out, WireFormat::ZigZag(static_cast<int32_t>(Load32(current + offset) - Load32(previous + offset))));
+				offset += size;
+			}
+			return true;
+		}
+
+		// applies a delta to the baseline in place, afterwards the baseline holds the new value. returns false on malformed data
+		static inline bool Decode(PropertyDesc::DataTypes dataType, const void* delta, size_t deltaLenght, std::vector<char>& baseline)
+		{
+			const unsigned char* data = static_cast<const unsigned char*>(delta);
+			size_t read = 0;
+			unsigned char* target = reinterpret_cast<unsigned char*>(baseline.data());
+
+			if (PropertyDesc::FixedDataSize(dataType) == 0)
+				return DecodeRuns(data, deltaLenght, target, baseline.size());
+
+			if (baseline.size() != PropertyDesc::FixedDataSize(dataType))
+				return false;
+
+			size_t offset = 0;
+			size_t firstSize = 0, componentSize = 0;
+			GetComponentLayout(dataType, firstSize, componentSize);
+			while (offset < baseline.size())
+			{
+				uint64_t value = 0;
+				if (!ReadVarInt(data, deltaLenght, read, value))
+					return false;
+
+				size_t size = offset == 0 ? firstSize : componentSize;
+				if (size == 8)
+					Store64(target + offset, Load64(target + offset) + static_cast<uint64_t>(WireFormat::UnZigZag(value)));
+				else
+					Store32(target + offset, Load32(target + offset) + static_cast<uint32_t>(WireFormat::UnZigZag(value)));
+				offset += size;
+			}
+			return read == deltaLenght;
+		}
+
+	private:
+		// state types lead with a 64 bit step, doubles are 64 bit, everything else is made of 32 bit components
+		static inline void GetComponentLayout(PropertyDesc::DataTypes dataType, size_t& firstSize, size_t& componentSize)
+		{
+			switch (dataType)
+			{
+			case PropertyDesc::DataTypes::Double:
+			case PropertyDesc::DataTypes::Vector3D:
+			case PropertyDesc::DataTypes::Vector4D:
+				firstSize = componentSize = 8;
+				break;
+
+			case PropertyDesc::DataTypes::StateV3F:
+			case PropertyDesc::DataTypes::StateV3FQ4F:
+				firstSize = 8;
+				componentSize = 4;
+				break;
+
+			default:
+				firstSize = componentSize = 4;
+				break;
+			}
+		}
+
+		// runs of changed bytes, a zero gap shorter than this is cheaper to send than to start a new run
+		static constexpr size_t MinRunGap = 3;
+
+		static inline void EncodeRuns(const unsigned char* current, const unsigned char* previous, size_t lenght, std::vector<char>& out)
+		{
+			// count first so the decoder knows when to stop
+			size_t runs = 0;
+			ForEachRun(current, previous, lenght, [&runs](size_t, size_t) { runs++; });
+			WriteVarInt(out, runs);
+
+			size_t last = 0;
+			ForEachRun(current, previous, lenght, [&](size_t start, size_t count)
+				{
+					WriteVarInt(out, start - last);
+					WriteVarInt(out, count);
+					for (size_t i = start; i < start + count; i++)
+						out.push_back(static_cast<char>(current[i] ^ previous[i]));
+					last = start + count;
+				});
+		}
+
+		template<class F>
+		static inline void ForEachRun(const unsigned char* current, const unsigned char* previous, size_t lenght, F&& function)
+		{
+			size_t i = 0;
+			while (i < lenght)
+			{
+				if (current[i] == previous[i])
+				{
+					i++;
+					continue;
+				}
+
+				size_t start = i;
+				size_t end = i + 1;	// one past the last changed byte
+				for (i = end; i < lenght && i < end + MinRunGap; i++)
+				{
+					if (current[i] != previous[i])
+						end = i + 1;
+				}
+				i = end;
+				function(start, end - start);
+			}
+		}
+
+		static inline bool DecodeRuns(const unsigned char* data, size_t lenght, unsigned char* target, size_t targetLenght)
+		{
+			size_t read = 0;
+			uint64_t runs = 0;
+			if (!ReadVarInt(data, lenght, read, runs))
+				return false;
+
+			size_t offset = 0;
+			for (uint64_t run = 0; run < runs; run++)
+			{
+				uint64_t skip = 0, count = 0;
+				if (!ReadVarInt(data, lenght, read, skip) || !ReadVarInt(data, lenght, read, count))
+					return false;
+
+				offset += static_cast<size_t>(skip);
+				if (offset + count > targetLenght || read + count > lenght)
+					return false;
+
+				for (size_t i = 0; i < count; i++)
+					target[offset + i] ^= data[read + i];
+
+				offset += static_cast<size_t>(count);
+				read += static_cast<size_t>(count);
+			}
+			return read == lenght;
+		}
+
+		static inline void WriteVarInt(std::vector<char>& out, uint64_t value)
+		{
+			while (value >= 0x80)
+			{
+				out.push_back(static_cast<char>(value | 0x80));
+				value >>= 7;
+			}
+			out.push_back(static_cast<char>(value));
+		}
+
+		static inline bool ReadVarInt(const unsigned char* data, size_t lenght, size_t& read, uint64_t& value)
+		{
+			value = 0;
+			for (int shift = 0; shift < 64 && read < lenght; shift += 7)
+			{
+				unsigned char byte = data[read++];
+				value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+				if ((byte & 0x80) == 0)
+					return true;
+			}
+			return false;
+		}
+
+		static inline uint32_t Load32(const unsigned char* p) { uint32_t v; memcpy(&v, p, 4); return v; }
+		static inline uint64_t Load64(const unsigned char* p) { uint64_t v; memcpy(&v, p, 8); return v; }
+		static inline void Store32(unsigned char* p, uint32_t v) { memcpy(p, &v, 4); }
+		static inline void Store64(unsigned char* p, uint64_t v) { memcpy(p, &v, 8); }
+	};
+}
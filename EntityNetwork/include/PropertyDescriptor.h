@@ -24,6 +24,7 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <memory>
 
 namespace EntityNetwork
 {
@@ -80,6 +81,88 @@ namespace EntityNetwork
 
 		size_t BufferSize = 0;
 
+		// size in bytes of a value of the given type, 0 for types that vary in size (strings and buffers)
+		static constexpr size_t FixedDataSize(DataTypes dataType)
+		{
+			switch (dataType)
+			{
+			case DataTypes::Integer:
+			case DataTypes::Float:
+				return 4;
+
+			case DataTypes::Vector3I:
+			case DataTypes::Vector3F:
+				return 4 * 3;
+
+			case DataTypes::Vector4I:
+			case DataTypes::Vector4F:
+				return 4 * 4;
+
+			case DataTypes::Double:
+				return 8;
+
+			case DataTypes::Vector3D:
+				return 8 * 3;
+
+			case DataTypes::Vector4D:
+				return 8 * 4;
+
+			case DataTypes::StateV3F:
+				return 8 + (4 * 3);
+
+			case DataTypes::StateV3FQ4F:
+				return 8 + (4 * 7);
+
+			case DataTypes::String:
+			case DataTypes::Buffer:
+			default:
+				return 0;
+			}
+		}
+
+		inline size_t FixedDataSize() const
+		{
+			return FixedDataSize(DataType);
+		}
+
+		// optional quantization of float components on the wire. Positions use the min/max range, orientation quaternions always use -1 to 1.
+		// 0 bits sends full 32 bit floats
+		float QuantizeMin = 0;
+		float QuantizeMax = 0;
+		int QuantizeBits = 0;
+
+		inline void SetQuantization(float min, float max, int bitsPerComponent)
+		{
+			QuantizeMin = min;
+			QuantizeMax = max;
+			QuantizeBits = bitsPerComponent;
+		}
+
+		inline bool Quantized() const
+		{
+			if (QuantizeBits <= 0 || QuantizeBits > 32 || QuantizeMax <= QuantizeMin)
+				return false;
+
+			switch (DataType)
+			{
+			case DataTypes::Float:
+			case DataTypes::Vector3F:
+			case DataTypes::Vector4F:
+			case DataTypes::StateV3F:
+			case DataTypes::StateV3FQ4F:
+				return true;
+
+			default:
+				return false;
+			}
+		}
+
+		// movement states, the only values entity updates send unreliably (MessageCodes::SetEntityStateValues)
+		inline bool IsState() const
+		{
+			return DataType == DataTypes::StateV3F || DataType == DataTypes::StateV3FQ4F;
+		}
+
 		typedef std::shared_ptr<PropertyDesc> Ptr;
 		typedef std::vector<Ptr> Vec;
 		typedef std::map<std::string, Ptr> Map;
@@ -0,0 +1,121 @@
+//  Copyright (c) 2020 Jeffery Myers
+//
+//	EntityNetwork and its associated sub proejcts are free software;
+//
+//	Permission is hereby granted, free of charge, to any person obtaining a copy
+//	of this software and associated documentation files (the "Software"), to deal
+//	in the Software without restriction, including without limitation the rights
+//	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//	copies of the Software, and to permit persons to whom the Software is
+//	furnished to do so, subject to the following conditions:
+//	
+//	The above copyright notice and this permission notice shall be included in all
+//	copies or substantial portions of the Software.
+//	
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//	SOFTWARE.
+#pragma once
+
+#include <array>
+#include <string>
+#include <cstring>
+
+#include "Entity.h"
+#include "Messages.h"
+
+namespace EntityNetwork
+{
+	// the property data type that stores each value type a PropertyHandle can be used with
+	template<class T> class PropertyTraits;
+
+	template<> class PropertyTraits<int> { public: static constexpr PropertyDesc::DataTypes DataType = PropertyDesc::DataTypes::Integer; };
+	template<> class PropertyTraits<std::array<int, 3>> { public: static constexpr PropertyDesc::DataTypes DataType = PropertyDesc::DataTypes::Vector3I; };
+	template<> class PropertyTraits<std::array<int, 4>> { public: static constexpr PropertyDesc::DataTypes DataType = PropertyDesc::DataTypes::Vector4I; };
+	template<> class PropertyTraits<float> { public: static constexpr PropertyDesc::DataTypes DataType = PropertyDesc::DataTypes::Float; };
+	template<> class PropertyTraits<std::array<float, 3>> { public: static constexpr PropertyDesc::DataTypes DataType = PropertyDesc::DataTypes::Vector3F; };
+	template<> class PropertyTraits<std::array<float, 4>> { public: static constexpr PropertyDesc::DataTypes DataType = PropertyDesc::DataTypes::Vector4F; };
+	template<> class PropertyTraits<double> { public: static constexpr PropertyDesc::DataTypes DataType = PropertyDesc::DataTypes::Double; };
+	template<> class PropertyTraits<std::array<double, 3>> { public: static constexpr PropertyDesc::DataTypes DataType = PropertyDesc::DataTypes::Vector3D; };
+	template<> class PropertyTraits<std::array<double, 4>> { public: static constexpr PropertyDesc::DataTypes DataType = PropertyDesc::DataTypes::Vector4D; };
+	template<> class PropertyTraits<StateUpdatePos> { public: static constexpr PropertyDesc::DataTypes DataType = PropertyDesc::DataTypes::StateV3F; };
+	template<> class PropertyTraits<StateUpdatePosRot> { public: static constexpr PropertyDesc::DataTypes DataType = PropertyDesc::DataTypes::StateV3FQ4F; };
+
+	// typed access to one fixed size property, bound once by ID or name.
+	// the data type is checked when binding, after that Get and Set are plain loads and stores with no type switch.
+	// an unbound handle gets default values and ignores sets. Using a value type with no PropertyTraits is a compile error
+	template<class T>
+	class PropertyHandle
+	{
+	public:
+		static constexpr PropertyDesc::DataTypes DataType = PropertyTraits<T>::DataType;
+		static constexpr size_t DataSize = PropertyDesc::FixedDataSize(DataType);	// state types are packed, smaller than sizeof(T)
+
+		static_assert(DataSize <= sizeof(T), "value type is smaller than the property data");
+
+		PropertyHandle() {}
+		PropertyHandle(PropertyData::Ptr prop) { Bind(prop); }
+
+		// returns false and leaves the handle unbound if the property is missing or of another data type
+		inline bool Bind(PropertyData::Ptr prop)
+		{
+			Property = nullptr;
+			if (prop == nullptr || prop->Descriptor == nullptr || prop->Descriptor->DataType != DataType || prop->DataLenght != DataSize)
+				return false;
+
+			Property = prop;
+			return true;
+		}
+
+		inline bool Bind(EntityInstance& entity, int propertyID)
+		{
+			auto prop = entity.Properties.TryGet(propertyID);
+			return Bind(prop == nullptr ? nullptr : *prop);
+		}
+
+		inline bool Bind(EntityInstance& entity, const std::string& name)
+		{
+			return Bind(entity.FindProperty(name));
+		}
+
+		inline bool Bound() const { return Property != nullptr; }
+
+		inline bool Is(const PropertyData::Ptr& prop) const { return Property != nullptr && Property == prop; }
+
+		inline T Get() const
+		{
+			T value = T();
+			if (Property != nullptr)
+				memcpy(&value, Property->DataPtr, DataSize);
+			return value;
+		}
+
+		// marks the property dirty like the PropertyData setters do, even when the value is the one it already has
+		inline void Set(const T& value)
+		{
+			if (Property == nullptr)
+				return;
+
+			memcpy(Property->DataPtr, &value, DataSize);
+			Property->SetDirty();
+		}
+
+		// only writes and marks the property dirty when the value differs from the one it has, true if it did.
+		// for callers that often write back the same value, it costs a compare on every call
+		inline bool SetIfChanged(const T& value)
+		{
+			if (Property == nullptr || memcmp(Property->DataPtr, &value, DataSize) == 0)
+				return false;
+
+			memcpy(Property->DataPtr, &value, DataSize);
+			Property->SetDirty();
+			return true;
+		}
+
+		PropertyData::Ptr Property = nullptr;
+	};
+}
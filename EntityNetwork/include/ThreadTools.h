@@ -23,8 +23,122 @@
 
 #include <mutex>
 #include <thread>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
 
 namespace EntityNetwork
 {
 	typedef std::lock_guard<std::mutex> MutexGuardian;
+
+	// a fixed set of threads that split up the items of a batch, the thread calling Run works on the batch too
+	class WorkerPool
+	{
+	public:
+		typedef std::shared_ptr<WorkerPool> Ptr;
+
+		// threads counts the calling thread, 0 uses one per hardware thread
+		static inline Ptr Make(size_t threads = 0) { return std::make_shared<WorkerPool>(threads); }
+
+		WorkerPool(size_t threads = 0)
+		{
+			if (threads == 0)
+				threads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+
+			for (size_t i = 1; i < threads; i++)
+				Threads.emplace_back([this]() { WorkerLoop(); });
+		}
+
+		virtual ~WorkerPool()
+		{
+			{
+				MutexGuardian guard(PoolMutex);
+				Stopping = true;
+			}
+			WorkReady.notify_all();
+
+			for (auto& thread : Threads)
+				thread.join();
+		}
+
+		inline size_t GetThreadCount() const { return Threads.size() + 1; }
+
+		// calls func once for every index below count and returns when all of them are done.
+		// items run in any order and at the same time, so func must only share state it can read concurrently
+		inline void Run(size_t count, const std::function<void(size_t)>& func)
+		{
+			if (Threads.empty() || count <= 1)
+			{
+				for (size_t i = 0; i < count; i++)
+					func(i);
+				return;
+			}
+
+			// one batch at a time
+			MutexGuardian batch(RunMutex);
+
+			std::unique_lock<std::mutex> lock(PoolMutex);
+			Job = &func;
+			JobSize = count;
+			NextItem = 0;
+			Pending = Threads.size();
+			Generation++;
+			lock.unlock();
+			WorkReady.notify_all();
+
+			Work(func, count);
+
+			// the workers hold a pointer to func until they check in
+			lock.lock();
+			WorkDone.wait(lock, [this]() { return Pending == 0; });
+			Job = nullptr;
+		}
+
+	private:
+		std::vector<std::thread> Threads;
+		std::mutex RunMutex;
+		std::mutex PoolMutex;
+		std::condition_variable WorkReady;
+		std::condition_variable WorkDone;
+
+		const std::function<void(size_t)>* Job = nullptr;
+		size_t JobSize = 0;
+		std::atomic<size_t> NextItem = { 0 };
+		size_t Pending = 0;
+		uint64_t Generation = 0;
+		bool Stopping = false;
+
+		inline void Work(const std::function<void(size_t)>& func, size_t count)
+		{
+			for (size_t i = NextItem++; i < count; i = NextItem++)
+				func(i);
+		}
+
+		inline void WorkerLoop()
+		{
+			uint64_t seen = 0;
+			std::unique_lock<std::mutex> lock(PoolMutex);
+			while (true)
+			{
+				WorkReady.wait(lock, [this, &seen]() { return Stopping || Generation != seen; });
+				if (Stopping)
+					return;
+
+				seen = Generation;
+				auto job = Job;
+				size_t size = JobSize;
+				lock.unlock();
+
+				Work(*job, size);
+
+				lock.lock();
+				if (--Pending == 0)
+					WorkDone.notify_one();
+			}
+		}
+	};
 }
@@ -27,6 +27,7 @@
 #include <MutexedMap.h>
 #include "RemoteProcedureDescriptor.h"
 #include "EntityDescriptor.h"
+#include "EntityPool.h"
 
 #include <vector>
 
@@ -49,21 +50,50 @@ namespace EntityNetwork
 		// get the data for a world property, data set will be synced to all clients
 		PropertyData::Ptr GetWorldPropertyData(int id);
 		PropertyData::Ptr GetWorldPropertyData(const std::string& name);
+		PropertyData::Ptr GetWorldPropertyData(NameKey name);
 
 		EntityDesc::Ptr GetEntityDef(int64_t index);
 		EntityDesc::Ptr GetEntityDef(const std::string& name);
+		EntityDesc::Ptr GetEntityDef(NameKey name);
+
+		// keep up to maxSize removed instances of an entity type to reuse for later creates, 0 turns pooling off
+		void SetEntityPoolSize(int64_t typeID, size_t maxSize);
+		void SetEntityPoolSize(const std::string& typeName, size_t maxSize);
+
+		// encoding used for all messages after the HailCheck. Servers set this before registering any data, clients take it from the server's HailCheck
+		WireFormat Wire;
+
+		// outbound messages queued during an Update are packed into Batch messages up to this size (a typical MTU payload), 0 sends every message on its own
+		size_t MaxBatchSize = 1200;
+
+		// counts server updates, entity property changes are stamped with the tick that collects them
+		tick_t CurrentTick = 0;
 
 	protected:
 		// entity controllers
 		MutexedVector<PropertyDesc::Ptr> EntityControllerProperties;
 		MutexedVector<PropertyDesc::Ptr> WorldPropertyDefs;
 		MutexedMap<int64_t, EntityDesc::Ptr>	EntityDefs;
+		NameIndex<EntityDesc::Ptr> EntityDefIndex;
 
 		virtual void SetupControllerProperty(int index);
 		virtual void SetupEntityController(EntityController::Ptr controller);
 
 		// world properties
 		MutexedVector<PropertyData::Ptr> WorldProperties;
+		NameIndex<PropertyData::Ptr> WorldPropertyIndex;
+
+		// storage for all messages built by this world, recycled once the transport drops them
+		MessageBufferPool::Ptr MessagePool = MessageBufferPool::Make();
+
+		// recycled entity instances by type ID
+		MutexedMap<int64_t, EntityPool::Ptr> EntityPools;
+
+		// a pooled instance of the type, nullptr if there is none and the factory has to make one
+		EntityInstance::Ptr TakePooledEntity(EntityDesc::Ptr desc);
+
+		// hands a removed instance to its type's pool, if it has one
+		void RecycleEntity(EntityInstance::Ptr& entity);
 
 	};
 }
\ No newline at end of file
@@ -41,11 +41,17 @@ namespace EntityNetwork
 				InboundMessages.Push(message);
 			}
 
+			// the next outbound message of any class, reliable ones first
 			inline virtual MessageBuffer::Ptr GetOutbound()
 			{
 				return OutboundMessages.Pop();
 			}
 
+			inline virtual MessageBuffer::Ptr GetOutbound(Reliability reliability)
+			{
+				return OutboundMessages.Pop(reliability);
+			}
+
 			inline virtual size_t GetOutboundSize()
 			{
 				return OutboundMessages.Size();
@@ -60,7 +66,7 @@ namespace EntityNetwork
 			friend class ClientWorld;
 
 			MutexedMessageBufferDeque InboundMessages;
-			MutexedMessageBufferDeque OutboundMessages;
+			OutboundMessageQueues OutboundMessages;
 		};
 	}
 }
\ No newline at end of file
@@ -28,6 +28,8 @@
 #include "MutexedVector.h"
 #include "EventList.h"
 #include "Entity.h"
+#include <deque>
+#include <unordered_map>
 
 namespace EntityNetwork
 {
@@ -61,11 +63,13 @@ namespace EntityNetwork
 			// process any dirty data and build up any outbound data that needs to go out
 			virtual void Update();
 
-			// called to add data packets from the server
+			// called to add data packets from the server. The message may be a view of transport memory (MessageBuffer::MakeView), it is not kept after the call
 			virtual void AddInboundData(MessageBuffer::Ptr message);
 
 			// remove one outbound message that the library expects to be sent form the server, nullptr if no data is left
+			// the first form returns every class, reliable ones first, the second only messages of one class
 			virtual  MessageBuffer::Ptr PopOutboundData();
+			virtual  MessageBuffer::Ptr PopOutboundData(Reliability reliability);
 		
 			// events
 			enum class ControllerEventTypes
@@ -94,6 +98,7 @@ namespace EntityNetwork
 				Negotiating,						// The server has connected but is still sending out all definitions and global data
 				ActiveSyncing,						// The connection is working in normal mode, syncing entities as needed
 				Disconnected,						// The connection is not active
+				ProtocolMismatch,					// The server's HailCheck had another PROTOCOL_HEADER, nothing more from it is processed
 			};
 			EventList<StateEventTypes, std::function<void(StateEventTypes state)>> StateEvents;
 
@@ -117,6 +122,7 @@ namespace EntityNetwork
 			// finds an RPC definition by name/id
 			ClientRPCDef::Ptr GetRPCDef(int index);
 			ClientRPCDef::Ptr GetRPCDef(const std::string& name);
+			ClientRPCDef::Ptr GetRPCDef(NameKey name);
 
 			// build up an empty set of arguments for an RPC using its data definition
 			std::vector<PropertyData::Ptr> GetRPCArgs(int index);
@@ -147,12 +153,13 @@ namespace EntityNetwork
 			std::vector< EntityInstance::Ptr> GetEntitiesOfType(const std::string& typeID);
 
 		protected:
-			void Send(MessageBuffer::Ptr message);
+			void Send(MessageBuffer::Ptr message, Reliability reliability = Reliability::ReliableOrdered);
 
 			ClientEntityController::Ptr PeerFromID(int64_t id);
 
 			virtual void ExecuteRemoteProcedureFunction(int index, std::vector<PropertyData::Ptr>& arguments);
 
+			void ProcessMessage(MessageBufferReader& reader);
 			void ProcessAddController(MessageBufferReader& reader);
 			void ProcessSetControllerPropertyData(MessageBufferReader& reader);
 			void ProcessRPC(MessageBufferReader& reader);
@@ -160,10 +167,31 @@ namespace EntityNetwork
 			void ProcessRemoveEntity(MessageBufferReader& reader);
 			void ProcessAcceptClientAddEntity(MessageBufferReader& reader);
 			void ProcessEntityDataChange(MessageBufferReader& reader);
+			void ProcessEntityStateChange(MessageBufferReader& reader);
+
+			void ProcessSyncTick(MessageBufferReader& reader);
 
 			MutexedVector<std::shared_ptr<ClientRPCDef>> RemoteProcedures;
+			NameIndex<ClientRPCDef::Ptr> RPCIndex;
 			std::map<std::string, ClientRPCFunction> CacheedRPCFunctions;
 
+			// acknowledgement of the server's entity syncs, a sync is received whole when every update it sent was applied
+			tick_t LastReceivedTick = 0;		// newest sync received whole
+			uint32_t ReceivedTickBits = 0;		// bit n set when the sync n + 1 ticks before it was received whole too
+			bool AckPending = false;			// received a sync since the last ack was sent
+			int SyncUpdates = 0;				// state updates received since the last SyncTick
+			bool SyncBroken = false;			// a state update since the last SyncTick could not be applied
+			uint32_t AddsReceived = 0;			// entity adds received from the server, acked so it can send their state updates
+
+			// state values received for an entity, with WireFormat::DeltaValues the baselines the server's deltas refer to
+			class ReceivedStates
+			{
+			public:
+				tick_t AddedTick = 0;		// sync the server sent the entity in, state updates from before it were for an earlier copy
+				std::map<int, std::deque<std::pair<tick_t, std::vector<char>>>> Values;	// per state property by tick, oldest first
+			};
+			std::unordered_map<int64_t, ReceivedStates> EntityStates;
+
 		private:
 			void HandlePropteryDescriptorMessage(MessageBufferReader& reader);
 
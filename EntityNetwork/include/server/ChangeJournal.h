@@ -0,0 +1,138 @@
+//  Copyright (c) 2020 Jeffery Myers
+//
+//	EntityNetwork and its associated sub proejcts are free software;
+//
+//	Permission is hereby granted, free of charge, to any person obtaining a copy
+//	of this software and associated documentation files (the "Software"), to deal
+//	in the Software without restriction, including without limitation the rights
+//	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//	copies of the Software, and to permit persons to whom the Software is
+//	furnished to do so, subject to the following conditions:
+//	
+//	The above copyright notice and this permission notice shall be included in all
+//	copies or substantial portions of the Software.
+//	
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//	SOFTWARE.
+#pragma once
+
+#include <deque>
+#include <vector>
+#include <algorithm>
+#include <mutex>
+
+#include "PropertyData.h"
+#include "ThreadTools.h"
+
+namespace EntityNetwork
+{
+	namespace Server
+	{
+		// append only log of entity changes, one segment per server tick.
+		// peers read the segments newer than the tick they were last synced at, segments every peer has passed are recycled.
+		// written by the simulation thread and read by replication, which may run on another thread
+		class ChangeJournal
+		{
+		public:
+			static constexpr int EntityAdded = -1;	// property ID of the record written when an entity is created
+			static constexpr int EntityRemoved = -2;	// and when it is removed, sorts first among the entity's records
+
+			class Record
+			{
+			public:
+				int64_t EntityID = 0;
+				int PropertyID = 0;
+				tick_t Tick = 0;
+
+				inline bool operator < (const Record& other) const
+				{
+					return EntityID < other.EntityID || (EntityID == other.EntityID && PropertyID < other.PropertyID);
+				}
+
+				inline bool operator == (const Record& other) const
+				{
+					return EntityID == other.EntityID && PropertyID == other.PropertyID;
+				}
+			};
+
+			// starts the segment for a new tick, records are appended to it until the next call
+			inline void BeginTick(tick_t tick)
+			{
+				MutexGuardian guard(JournalMutex);
+				Segment segment;
+				segment.Tick = tick;
+				if (!FreeRecords.empty())
+				{
+					segment.Records.swap(FreeRecords.back());
+					FreeRecords.pop_back();
+				}
+				Segments.push_back(std::move(segment));
+			}
+
+			inline void Append(int64_t entityID, int propertyID)
+			{
+				MutexGuardian guard(JournalMutex);
+				if (Segments.empty())
+					return;
+
+				Record record;
+				record.EntityID = entityID;
+				record.PropertyID = propertyID;
+				record.Tick = Segments.back().Tick;
+				Segments.back().Records.push_back(record);
+			}
+
+			// replaces records with every change newer than tick up to and including through, sorted by entity and property with repeats removed
+			inline void CollectSince(tick_t tick, tick_t through, std::vector<Record>& records)
+			{
+				records.clear();
+				{
+					MutexGuardian guard(JournalMutex);
+					for (auto itr = Segments.rbegin(); itr != Segments.rend() && itr->Tick > tick; itr++)
+					{
+						if (itr->Tick <= through)
+							records.insert(records.end(), itr->Records.begin(), itr->Records.end());
+					}
+				}
+
+				std::sort(records.begin(), records.end());
+				records.erase(std::unique(records.begin(), records.end()), records.end());
+			}
+
+			// recycles the segments up to and including tick, call with the oldest tick any peer is synced to
+			inline void Release(tick_t tick)
+			{
+				MutexGuardian guard(JournalMutex);
+				while (!Segments.empty() && Segments.front().Tick <= tick)
+				{
+					Segments.front().Records.clear();
+					FreeRecords.push_back(std::move(Segments.front().Records));
+					Segments.pop_front();
+				}
+			}
+
+			inline size_t SegmentCount()
+			{
+				MutexGuardian guard(JournalMutex);
+				return Segments.size();
+			}
+
+		private:
+			class Segment
+			{
+			public:
+				tick_t Tick = 0;
+				std::vector<Record> Records;
+			};
+
+			std::mutex JournalMutex;
+			std::deque<Segment> Segments;
+			std::vector<std::vector<Record>> FreeRecords;
+		};
+	}
+}
@@ -0,0 +1,193 @@
+//  Copyright (c) 2020 Jeffery Myers
+//
+//	EntityNetwork and its associated sub proejcts are free software;
+//
+//	Permission is hereby granted, free of charge, to any person obtaining a copy
+//	of this software and associated documentation files (the "Software"), to deal
+//	in the Software without restriction, including without limitation the rights
+//	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//	copies of the Software, and to permit persons to whom the Software is
+//	furnished to do so, subject to the following conditions:
+//	
+//	The above copyright notice and this permission notice shall be included in all
+//	copies or substantial portions of the Software.
+//	
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//	SOFTWARE.
+#pragma once
+
+#include <cmath>
+#include <cstdlib>
+#include <unordered_map>
+#include <vector>
+#include <algorithm>
+
+#include "server/InterestPolicy.h"
+
+namespace EntityNetwork
+{
+	namespace Server
+	{
+		// spatial hash of entities by the cell their position falls in. Radii are rounded up to whole cells,
+		// a peer gets the entities in the block of cells around its avatar's cell and looks again when the avatar changes cells
+		class GridInterest : public SpatialInterest
+		{
+		public:
+			typedef std::shared_ptr<GridInterest> Ptr;
+
+			float CellSize = 100;	// world units per cell
+
+			static inline Ptr Make(float cellSize, float enterRadius, float leaveRadius)
+			{
+				auto grid = std::make_shared<GridInterest>();
+				grid->CellSize = cellSize;
+				grid->EnterRadius = enterRadius;
+				grid->LeaveRadius = leaveRadius;
+				return grid;
+			}
+
+			class Cell
+			{
+			public:
+				int32_t X = 0;
+				int32_t Y = 0;
+				int32_t Z = 0;
+
+				inline bool operator == (const Cell& other) const { return X == other.X && Y == other.Y && Z == other.Z; }
+				inline bool operator != (const Cell& other) const { return !(*this == other); }
+			};
+
+			inline Cell CellOf(const float position[3]) const
+			{
+				Cell cell;
+				cell.X = static_cast<int32_t>(std::floor(position[0] / CellSize));
+				cell.Y = static_cast<int32_t>(std::floor(position[1] / CellSize));
+				cell.Z = static_cast<int32_t>(std::floor(position[2] / CellSize));
+				return cell;
+			}
+
+			// cells between two cells along the furthest axis
+			static inline int Distance(const Cell& a, const Cell& b)
+			{
+				return std::max(std::abs(a.X - b.X), std::max(std::abs(a.Y - b.Y), std::abs(a.Z - b.Z)));
+			}
+
+			inline size_t CellCount() const { return Cells.size(); }
+
+		protected:
+			inline int CellRadius(float radius) const
+			{
+				return static_cast<int>(std::ceil(radius / CellSize));
+			}
+
+			inline void Insert(int64_t id, const float position[3]) override
+			{
+				Move(id, position);
+			}
+
+			inline void Move(int64_t id, const float position[3]) override
+			{
+				Cell cell = CellOf(position);
+				auto itr = EntityCells.find(id);
+				if (itr != EntityCells.end())
+				{
+					if (itr->second == cell)
+						return;
+					Unlink(id, itr->second);
+					itr->second = cell;
+				}
+				else
+					EntityCells.emplace(id, cell);
+
+				Cells[cell].push_back(id);
+			}
+
+			inline void Erase(int64_t id) override
+			{
+				auto itr = EntityCells.find(id);
+				if (itr == EntityCells.end())
+					return;
+
+				Unlink(id, itr->second);
+				EntityCells.erase(itr);
+			}
+
+			inline void ClearIndex() override
+			{
+				Cells.clear();
+				EntityCells.clear();
+			}
+
+			inline void Query(const float center[3], float radius, const std::function<void(int64_t)>& func) const override
+			{
+				Cell middle = CellOf(center);
+				int cells = CellRadius(radius);
+
+				Cell cell;
+				for (cell.X = middle.X - cells; cell.X <= middle.X + cells; cell.X++)
+				{
+					for (cell.Y = middle.Y - cells; cell.Y <= middle.Y + cells; cell.Y++)
+					{
+						for (cell.Z = middle.Z - cells; cell.Z <= middle.Z + cells; cell.Z++)
+						{
+							auto itr = Cells.find(cell);
+							if (itr == Cells.end())
+								continue;
+
+							for (int64_t id : itr->second)
+								func(id);
+						}
+					}
+				}
+			}
+
+			inline bool Within(const float a[3], const float b[3], float radius) const override
+			{
+				return Distance(CellOf(a), CellOf(b)) <= CellRadius(radius);
+			}
+
+			inline bool ViewChanged(const float from[3], const float to[3]) const override
+			{
+				return CellOf(from) != CellOf(to);
+			}
+
+		private:
+			class CellHash
+			{
+			public:
+				inline size_t operator () (const Cell& cell) const
+				{
+					uint64_t h = static_cast<uint32_t>(cell.X);
+					h = h * 0x9E3779B97F4A7C15ull + static_cast<uint32_t>(cell.Y);
+					h = h * 0x9E3779B97F4A7C15ull + static_cast<uint32_t>(cell.Z);
+					return static_cast<size_t>(h ^ (h >> 29));
+				}
+			};
+
+			std::unordered_map<Cell, std::vector<int64_t>, CellHash> Cells;
+			std::unordered_map<int64_t, Cell> EntityCells;
+
+			inline void Unlink(int64_t id, const Cell& cell)
+			{
+				auto itr = Cells.find(cell);
+				if (itr == Cells.end())
+					return;
+
+				auto& ids = itr->second;
+				auto pos = std::find(ids.begin(), ids.end(), id);
+				if (pos != ids.end())
+				{
+					*pos = ids.back();
+					ids.pop_back();
+				}
+				if (ids.empty())
+					Cells.erase(itr);
+			}
+		};
+	}
+}
@@ -0,0 +1,244 @@
+//  Copyright (c) 2020 Jeffery Myers
+//
+//	EntityNetwork and its associated sub proejcts are free software;
+//
+//	Permission is hereby granted, free of charge, to any person obtaining a copy
+//	of this software and associated documentation files (the "Software"), to deal
+//	in the Software without restriction, including without limitation the rights
+//	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//	copies of the Software, and to permit persons to whom the Software is
+//	furnished to do so, subject to the following conditions:
+//	
+//	The above copyright notice and this permission notice shall be included in all
+//	copies or substantial portions of the Software.
+//	
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//	SOFTWARE.
+#pragma once
+
+#include <cmath>
+#include <memory>
+#include <functional>
+#include <unordered_map>
+#include <algorithm>
+
+#include "server/WorldSnapshot.h"
+#include "Messages.h"
+
+namespace EntityNetwork
+{
+	namespace Server
+	{
+		class ServerEntityController;
+
+		// decides which entities each peer is sent. ServerWorld::Interest, nullptr sends every entity to every peer.
+		// the index calls (EntityAdded to Clear) are made between peer syncs and are never concurrent with anything. Peers are synced in parallel
+		// when ServerWorld::ReplicationWorkers is set, so UpdatePeer, IsInterested, ForEachCandidate and GetPriority can run at the same time for
+		// different peers: UpdatePeer may only write the peer's InterestState and the others are const
+		class InterestPolicy
+		{
+		public:
+			typedef std::shared_ptr<InterestPolicy> Ptr;
+
+			// data a policy keeps per peer, stored on the controller (ServerEntityController::InterestState)
+			class PeerState
+			{
+			public:
+				typedef std::shared_ptr<PeerState> Ptr;
+				virtual ~PeerState() {}
+			};
+
+			virtual ~InterestPolicy() {}
+
+			// the policy's index is kept from the snapshots replication reads. Added is called for every entity when the policy is first used
+			// and for each new one after that, Moved when an entity's PositionProperty changes
+			virtual void EntityAdded(const EntitySnapshot& entity) = 0;
+			virtual void EntityMoved(const EntitySnapshot& entity) = 0;
+			virtual void EntityRemoved(int64_t id) = 0;
+			virtual void Clear() = 0;
+
+			// called at the start of each sync of a peer. Returns true when the peer's view has changed enough that entities it doesn't
+			// have should be offered again (ForEachCandidate) and the ones it has checked again
+			virtual bool UpdatePeer(ServerEntityController& peer, const WorldSnapshot& snapshot) = 0;
+
+			// true if the peer should have the entity. entering is set for entities the peer doesn't have yet,
+			// policies can ask more of those than of ones the peer keeps so entities on a boundary aren't added and removed every update
+			virtual bool IsInterested(ServerEntityController& peer, const EntitySnapshot& entity, bool entering) const = 0;
+
+			// calls func with every entity IsInterested may accept as entering, the whole snapshot by default
+			virtual void ForEachCandidate(ServerEntityController& /*peer*/, const WorldSnapshot& snapshot, const std::function<void(int64_t)>& func) const
+			{
+				snapshot.DoForEach([&func](const EntitySnapshot::Ptr& entity) { func(entity->ID); });
+			}
+
+			// how urgently the peer needs the entity's changes, from 0 to 1. Used to pick what is sent first when a peer's
+			// byte budget (ServerEntityController::BytesPerTick) can't fit everything, 1 by default
+			virtual float GetPriority(ServerEntityController& /*peer*/, const EntitySnapshot& /*entity*/) const
+			{
+				return 1;
+			}
+
+			// reads the first three components of the entity's position property, false if it has none
+			static inline bool GetPosition(const EntitySnapshot& entity, float position[3])
+			{
+				auto prop = entity.GetProperty(entity.Descriptor->PositionProperty);
+				if (prop == nullptr)
+					return false;
+
+				for (int i = 0; i < 3; i++)
+				{
+					switch (prop->Descriptor->DataType)
+					{
+					case PropertyDesc::DataTypes::Vector3I:
+					case PropertyDesc::DataTypes::Vector4I:
+						position[i] = static_cast<float>(static_cast<const int*>(prop->DataPtr)[i]);
+						break;
+
+					case PropertyDesc::DataTypes::Vector3F:
+					case PropertyDesc::DataTypes::Vector4F:
+						position[i] = static_cast<const float*>(prop->DataPtr)[i];
+						break;
+
+					case PropertyDesc::DataTypes::Vector3D:
+					case PropertyDesc::DataTypes::Vector4D:
+						position[i] = static_cast<float>(static_cast<const double*>(prop->DataPtr)[i]);
+						break;
+
+					case PropertyDesc::DataTypes::StateV3F:
+					case PropertyDesc::DataTypes::StateV3FQ4F:
+						position[i] = static_cast<const StateUpdatePos*>(prop->DataPtr)->Postion[i];
+						break;
+
+					default:
+						return false;
+					}
+				}
+				return true;
+			}
+		};
+
+		// base for policies that send a peer the entities near the avatar it owns (EntityDesc::IsAvatar), by the entity type's PositionProperty.
+		// peers without an avatar, the peer's own entities and entities without a position are always sent.
+		// derived policies supply the spatial index. Override IsInterested to add other rules (teams, visibility) on top of the distance test
+		class SpatialInterest : public InterestPolicy
+		{
+		public:
+			float EnterRadius = 100;	// entities within this distance of a peer's avatar are sent to it
+			float LeaveRadius = 150;	// and removed past this one, the gap keeps entities on the edge from flickering in and out
+
+			inline void EntityAdded(const EntitySnapshot& entity) override
+			{
+				if (entity.Descriptor->IsAvatar)
+					Avatars[entity.OwnerID] = entity.ID;
+
+				float position[3];
+				if (GetPosition(entity, position))
+					Insert(entity.ID, position);
+			}
+
+			inline void EntityMoved(const EntitySnapshot& entity) override
+			{
+				float position[3];
+				if (GetPosition(entity, position))
+					Move(entity.ID, position);
+			}
+
+			inline void EntityRemoved(int64_t id) override
+			{
+				Erase(id);
+				for (auto avatar = Avatars.begin(); avatar != Avatars.end(); avatar++)
+				{
+					if (avatar->second == id)
+					{
+						Avatars.erase(avatar);
+						break;
+					}
+				}
+			}
+
+			inline void Clear() override
+			{
+				Avatars.clear();
+				ClearIndex();
+			}
+
+			bool UpdatePeer(ServerEntityController& peer, const WorldSnapshot& snapshot) override;
+
+			inline bool IsInterested(ServerEntityController& peer, const EntitySnapshot& entity, bool entering) const override
+			{
+				const Center* center = GetCenter(peer);
+				float position[3];
+				if (center == nullptr || IsOwner(peer, entity) || !GetPosition(entity, position))
+					return true;
+
+				return Within(center->Position, position, entering ? EnterRadius : std::max(LeaveRadius, EnterRadius));
+			}
+
+			inline void ForEachCandidate(ServerEntityController& peer, const WorldSnapshot& snapshot, const std::function<void(int64_t)>& func) const override
+			{
+				const Center* center = GetCenter(peer);
+				if (center == nullptr)
+					InterestPolicy::ForEachCandidate(peer, snapshot, func);
+				else
+					Query(center->Position, EnterRadius, func);
+			}
+
+			// full priority at the avatar, halved at the enter radius
+			inline float GetPriority(ServerEntityController& peer, const EntitySnapshot& entity) const override
+			{
+				const Center* center = GetCenter(peer);
+				float position[3];
+				if (center == nullptr || IsOwner(peer, entity) || !GetPosition(entity, position))
+					return 1;
+
+				float distance = std::sqrt(DistanceSq(center->Position, position));
+				return EnterRadius / (EnterRadius + distance);
+			}
+
+		protected:
+			// where a peer's avatar was at its last sync
+			class Center : public PeerState
+			{
+			public:
+				bool HasAvatar = false;
+				float Position[3] = { 0, 0, 0 };
+				float Viewed[3] = { 0, 0, 0 };	// where it was the last time the view changed, what ViewChanged measures from
+			};
+
+			std::unordered_map<int64_t, int64_t> Avatars;	// avatar entity ID by owner
+
+			// the spatial index, Move is also called for entities that were not inserted yet
+			virtual void Insert(int64_t id, const float position[3]) = 0;
+			virtual void Move(int64_t id, const float position[3]) = 0;
+			virtual void Erase(int64_t id) = 0;
+			virtual void ClearIndex() = 0;
+			virtual void Query(const float center[3], float radius, const std::function<void(int64_t)>& func) const = 0;
+
+			// distance matching the index, 3D by default
+			virtual float DistanceSq(const float a[3], const float b[3]) const
+			{
+				float dx = a[0] - b[0], dy = a[1] - b[1], dz = a[2] - b[2];
+				return dx * dx + dy * dy + dz * dz;
+			}
+
+			virtual bool Within(const float a[3], const float b[3], float radius) const
+			{
+				return DistanceSq(a, b) <= radius * radius;
+			}
+
+			// true when the avatar moved far enough from where the peer's entities were last offered to look again
+			virtual bool ViewChanged(const float from[3], const float to[3]) const
+			{
+				return from[0] != to[0] || from[1] != to[1] || from[2] != to[2];
+			}
+
+			const Center* GetCenter(ServerEntityController& peer) const;
+			bool IsOwner(ServerEntityController& peer, const EntitySnapshot& entity) const;
+		};
+	}
+}
@@ -24,9 +24,13 @@
 #include "EntityController.h"
 #include "MutexedMessageBuffer.h"
 #include "MutexedMap.h"
+#include "MutexedVector.h"
 #include "Entity.h"
 #include "server/ServerWorld.h"
+#include "server/InterestPolicy.h"
 #include <mutex>
+#include <unordered_map>
+#include <deque>
 
 namespace EntityNetwork
 {
@@ -39,6 +43,21 @@ namespace EntityNetwork
 			typedef std::function<ServerEntityController::Ptr(int64_t)> CreateFunction;
 
 			MutexedMap<int64_t, KnownEnityDataset> KnownEnitities;
+			bool EntitiesSynced = false;	// every existing entity has been sent, after that only new ones are checked
+
+			tick_t LastSyncedTick = 0;		// server tick this peer's entities were last brought current at
+			int SyncInterval = 1;			// server updates between entity syncs for this peer, changes in between are merged
+
+			InterestPolicy::PeerState::Ptr InterestState;	// kept by the world's InterestPolicy
+
+			// entity bytes this peer may be sent per sync, 0 for no limit. Over budget, entity adds and updates wait for a later sync,
+			// most urgent first, removes are always sent
+			size_t BytesPerTick = 0;
+
+			// acknowledgement. Syncs that send state updates end with a SyncTick, the client acks the ones it got whole (MessageCodes::Ack).
+			// state values in a sync the client did not ack are sent again unless a later sync already sent the property
+			tick_t LastSentTick = 0;		// last sync that sent this peer entity updates
+			tick_t LastAckedTick = 0;		// newest sync the peer acknowledged, 0 until the peer acks
 
 			ServerEntityController(int64_t id) : EntityController(id) {}
 			virtual ~ServerEntityController() {}
@@ -48,11 +67,17 @@ namespace EntityNetwork
 				InboundMessages.Push(message);
 			}
 
+			// the next outbound message of any class, reliable ones first
 			inline virtual MessageBuffer::Ptr GetOutbound()
 			{
 				return OutboundMessages.Pop();
 			}
 
+			inline virtual MessageBuffer::Ptr GetOutbound(Reliability reliability)
+			{
+				return OutboundMessages.Pop(reliability);
+			}
+
 			inline virtual size_t GetOutboundSize()
 			{
 				return OutboundMessages.Size();
@@ -61,7 +86,33 @@ namespace EntityNetwork
 			friend class ServerWorld;
 
 			MutexedMessageBufferDeque InboundMessages;
-			MutexedMessageBufferDeque OutboundMessages;
+			OutboundMessageQueues OutboundMessages;
+
+			// entities with an add or changes that didn't fit the budget yet and their accumulated priority, only used by replication
+			std::unordered_map<int64_t, float> PendingEntities;
+			int64_t ByteCredit = 0;			// budget left over, negative when the last message sent went past it, 0 without a budget
+
+			// an entity update in a sync not acknowledged yet
+			class SentUpdate
+			{
+			public:
+				tick_t Tick = 0;
+				int64_t EntityID = 0;
+			};
+			std::deque<SentUpdate> SentUpdates;		// oldest first, only used by replication
+
+			// entity adds sent to the peer and how many of them its acks say it got, only used by replication
+			uint32_t AddsSent = 0;
+			uint32_t AddsAcked = 0;
+
+			class ReceivedAck
+			{
+			public:
+				tick_t Tick = 0;
+				uint32_t Bits = 0;
+				uint32_t Adds = 0;
+			};
+			MutexedVector<ReceivedAck> ReceivedAcks;	// acks waiting for the next sync of this peer
 		};
 	}
 }
\ No newline at end of file
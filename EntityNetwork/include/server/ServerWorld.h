@@ -23,12 +23,19 @@
 
 #include "World.h"
 #include "server/ServerEntityController.h"
+#include "server/ChangeJournal.h"
+#include "server/WorldSnapshot.h"
+#include "server/InterestPolicy.h"
+#include "server/GridInterest.h"
+#include "server/SpatialTree.h"
 #include "MutexedMessageBuffer.h"
 #include "MutexedMap.h"
 #include "MutexedVector.h"
 #include "EventList.h"
 #include "RemoteProcedureDescriptor.h"
+#include "ThreadTools.h"
 #include <functional>
+#include <atomic>
 
 namespace EntityNetwork
 {
@@ -60,10 +67,19 @@ namespace EntityNetwork
 				CreateEntityInstance = [](EntityDesc::Ptr desc, int64_t id) { auto e = EntityInstance::Make(desc); e->SetID(id); return e; };
 			}
 
+			virtual ~ServerWorld();
+
 			// external servicing
 			// process any dirty data and build up any outbound data that needs to go out
 			virtual void Update();
 
+			// the two halves of Update, for servers that replicate entities off the simulation thread.
+			// EndTick sends world and controller data and snapshots entity state, call it on the thread that changes entities.
+			// ReplicateSnapshot encodes a snapshot for every peer and only reads the snapshot, so it can run on another thread while the next tick simulates.
+			// snapshots must be replicated one at a time and in the order they were taken
+			virtual WorldSnapshot::Ptr EndTick();
+			virtual void ReplicateSnapshot(WorldSnapshot::Ptr snapshot);
+
 			// called when a client connects to the server, client can assign the ID, or the library can compute it. returns a smart pointer to the controller associated with this client conenction
 			// Id will be used for all other external events
 			virtual ServerEntityController::Ptr AddRemoteController(int64_t id = -1);
@@ -71,11 +87,14 @@ namespace EntityNetwork
 			// called when a client disconnects from the server
 			virtual void RemoveRemoteController(int64_t id);
 
-			// called to add data packets for a specific client ID
+			// called to add data packets for a specific client ID. The message may be a view of transport memory (MessageBuffer::MakeView), it is not kept after the call
 			virtual void AddInboundData(int64_t id, MessageBuffer::Ptr message);
 
 			// remove one outbound message that the library expects to be sent to the client with the specified ID, nullptr if no data is left
+			// the first form returns every class, reliable ones first, for transports that send everything reliably and in order.
+			// the second only returns messages of one class, so each can go out on a channel that delivers it that way
 			virtual MessageBuffer::Ptr PopOutboundData(int64_t id);
+			virtual MessageBuffer::Ptr PopOutboundData(int64_t id, Reliability reliability);
 
 			// properties
 
@@ -87,7 +106,7 @@ namespace EntityNetwork
 
 			// remote procedure calls
 
-			// register a remote procedure call definition to send to all clients
+			// register a remote procedure call definition to send to all clients, -1 if it has more arguments than the definition message holds
 			virtual int RegisterRemoteProcedure(RemoteProcedureDef::Ptr	 desc);
 
 			// associate a local function to a RPC name/ID that will be called when the RPC is triggered by the client.
@@ -97,6 +116,7 @@ namespace EntityNetwork
 			// finds an RPC definition by name/id
 			ServerRPCDef::Ptr GetRPCDef(int index);
 			ServerRPCDef::Ptr GetRPCDef(const std::string& name);
+			ServerRPCDef::Ptr GetRPCDef(NameKey name);
 
 			// build up an empty set of arguments for an RPC using its data definition
 			std::vector<PropertyData::Ptr> GetRPCArgs(int index);
@@ -108,7 +128,7 @@ namespace EntityNetwork
 
 			// entities
 
-			// register an entity definition
+			// register an entity definition, -1 if it has more properties than the definition message holds
 			virtual int RegisterEntityDesc(EntityDesc::Ptr desc);
 
 			// All created entities
@@ -142,6 +162,21 @@ namespace EntityNetwork
 
 			MutexedMap<int64_t, ServerEntityController::Ptr>	RemoteEnitityControllers;	// controllers that are fully synced
 
+			// interest management, decides which entities each peer is sent. nullptr sends everything to everyone.
+			// GridInterest, QuadtreeInterest and OctreeInterest send peers the entities near their avatar. Set it while entities are not being replicated
+			InterestPolicy::Ptr Interest;
+
+			// threads that encode the per peer updates in ReplicateSnapshot, one task per peer. nullptr encodes every peer on the calling thread
+			WorkerPool::Ptr ReplicationWorkers;
+
+			// the class state updates (SetEntityStateValues) and their SyncTicks are sent in. Unreliable by default, the client's acks
+			// get lost ones sent again. Other entity updates are always reliable and ordered, behind the entity's add.
+			// unless this is ReliableOrdered an entity's state updates wait until the peer acks its add
+			Reliability EntityUpdateReliability = Reliability::UnreliableSequenced;
+
+			// ticks a sent update may go unacknowledged, past that it is treated as lost once the peer has acked anything
+			static constexpr tick_t MaxUnackedTicks = 64;
+
 			void RegisterEntityFactory(int64_t id, EntityInstance::CreateFunction function);
 			void RegisterEntityFactory(const std::string& name, EntityInstance::CreateFunction function);
 
@@ -154,6 +189,22 @@ namespace EntityNetwork
 			MutexedVector<MessageBuffer::Ptr> RPCDefCache;
 			MutexedVector<MessageBuffer::Ptr> EntityDefCache;
 			MutexedVector<std::shared_ptr<ServerRPCDef>> RemoteProcedures;
+			NameIndex<ServerRPCDef::Ptr> RPCIndex;
+
+			// entities queued by a property change since the last update (EntityInstance::ChangeQueued), and entities created or removed since then
+			MutexedVector<int64_t> ChangedEntities;
+			MutexedVector<int64_t> AddedEntities;
+			MutexedVector<int64_t> RemovedEntities;
+
+			// entity state at the end of the last tick, the next snapshot starts from it
+			WorldSnapshot::Ptr LastSnapshot = std::make_shared<WorldSnapshot>();
+
+			// the policy whose index is current and the snapshot tick it was brought up to
+			InterestPolicy::Ptr IndexedInterest;
+			tick_t InterestTick = 0;
+
+			// per tick record of those changes, read by each peer from its LastSyncedTick
+			ChangeJournal Journal;
 
 			MessageBuffer::Ptr BuildControllerPropertySetupMessage(PropertyDesc::Ptr desc);
 			MessageBuffer::Ptr BuildWorldPropertySetupMessage(int index);
@@ -161,22 +212,40 @@ namespace EntityNetwork
 			MessageBuffer::Ptr BuildEntityDefMessage(int index);
 			MessageBuffer::Ptr BuildWorldPropertyDataMessage(int index);
 
-			virtual void Send(ServerEntityController::Ptr peer, MessageBuffer::Ptr message);
+			virtual void Send(ServerEntityController::Ptr peer, MessageBuffer::Ptr message, Reliability reliability = Reliability::ReliableOrdered);
 			virtual void Send(ServerEntityController::Ptr peer, MutexedVector<MessageBuffer::Ptr>& messages);
-			inline void Send(ServerEntityController::Ptr peer, MessageBufferBuilder& builder) { Send(peer, builder.Pack()); }
+			inline void Send(ServerEntityController::Ptr peer, MessageBufferBuilder& builder, Reliability reliability = Reliability::ReliableOrdered) { Send(peer, builder.Pack(), reliability); }
 			void SendToAll(MessageBuffer::Ptr message);
 
 			virtual void ExecuteRemoteProcedureFunction(int index, ServerEntityController::Ptr sender, std::vector<PropertyData::Ptr>& arguments);
 
-			virtual void ProcessEntityUpdates();
+			virtual void ProcessMessage(ServerEntityController::Ptr peer, MessageBufferReader& reader);
+			virtual WorldSnapshot::Ptr CaptureSnapshot();
+			size_t SendEntityAdd(ServerEntityController::Ptr peer, const EntitySnapshot& entity, tick_t tick);
+			size_t SendEntityUpdate(ServerEntityController::Ptr peer, int64_t entityID, const std::vector<PropertyData::Ptr>& properties, BitStreamWriter& bits, KnownEnityDataset& known, tick_t tick);
+			void SendEntityRemove(ServerEntityController::Ptr peer, int64_t entityID);
+			bool UpdateInterest(const WorldSnapshot& snapshot);
+			bool IsInterested(ServerEntityController::Ptr peer, const EntitySnapshot& entity, bool entering);
+			void ReplicatePeer(ServerEntityController::Ptr peer, const WorldSnapshot& snapshot, bool interestChanged, const std::vector<ChangeJournal::Record>& records);
+			void SendPendingEntities(ServerEntityController::Ptr peer, const WorldSnapshot& snapshot, tick_t elapsed, BitStreamWriter& bits);
+			void PackEntityUpdate(MessageBufferBuilder& builder, const std::vector<PropertyData::Ptr>& properties, BitStreamWriter& bits, KnownEnityDataset& known);
+			void PackStateUpdate(MessageBufferBuilder& builder, const std::vector<PropertyData::Ptr>& properties, KnownEnityDataset& known, tick_t tick);
 			virtual void ProcessRPCall(ServerEntityController::Ptr peer, MessageBufferReader& reader);
 			virtual void ProcessControllerDataUpdate(ServerEntityController::Ptr peer, MessageBufferReader& reader);
 
 			virtual void ProcessClientEntityAdd(ServerEntityController::Ptr peer, MessageBufferReader& reader);
 			virtual void ProcessClientEntityRemove(ServerEntityController::Ptr peer, MessageBufferReader& reader);
 			virtual void ProcessClientEntityUpdate(ServerEntityController::Ptr peer, MessageBufferReader& reader);
+			virtual void ProcessAck(ServerEntityController::Ptr peer, MessageBufferReader& reader);
+
+			void ProcessAcks(ServerEntityController::Ptr peer);
+			void UpdateAcked(ServerEntityController::Ptr peer, const ServerEntityController::SentUpdate& update);
+			void UpdateLost(ServerEntityController::Ptr peer, const ServerEntityController::SentUpdate& update);
 
 		private:
+			// IDs are never reused, a removed entity's ID may still be in a peer's journal or a pooled instance's past
+			std::atomic<int64_t> NextEntityID = { 0 };
+
 			std::map<int64_t, EntityInstance::CreateFunction> EntityFactories;
 			std::map<std::string, EntityInstance::CreateFunction> PendingEntityFactories;
 
@@ -0,0 +1,405 @@
+//  Copyright (c) 2020 Jeffery Myers
+//
+//	EntityNetwork and its associated sub proejcts are free software;
+//
+//	Permission is hereby granted, free of charge, to any person obtaining a copy
+//	of this software and associated documentation files (the "Software"), to deal
+//	in the Software without restriction, including without limitation the rights
+//	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//	copies of the Software, and to permit persons to whom the Software is
+//	furnished to do so, subject to the following conditions:
+//	
+//	The above copyright notice and this permission notice shall be included in all
+//	copies or substantial portions of the Software.
+//	
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//	SOFTWARE.
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <memory>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+
+#include "server/InterestPolicy.h"
+
+namespace EntityNetwork
+{
+	namespace Server
+	{
+		// region tree of points, a quadtree in 2 dimensions and an octree in 3. Leaves split when they fill and merge back as they empty,
+		// the root doubles toward points outside it, so the tree follows uneven density without knowing the world bounds
+		template<int Dimensions>
+		class SpatialTree
+		{
+		public:
+			static constexpr int Children = 1 << Dimensions;
+
+			typedef std::array<float, Dimensions> Point;
+
+			size_t LeafCapacity = 16;	// items a leaf holds before it splits
+			float MinNodeSize = 1;		// leaves this small don't split, however many items share them
+			float InitialSize = 1024;	// edge of the root when the first item goes in
+
+			inline void Insert(int64_t id, const Point& point)
+			{
+				if (Leaves.find(id) != Leaves.end())
+				{
+					Move(id, point);
+					return;
+				}
+
+				for (float value : point)
+				{
+					if (!std::isfinite(value))
+						return;
+				}
+
+				if (Root == nullptr)
+				{
+					Root = std::make_unique<Node>();
+					for (int i = 0; i < Dimensions; i++)
+						Root->Min[i] = point[i] - InitialSize / 2;
+					Root->Size = InitialSize;
+				}
+
+				while (!Root->Contains(point))
+					Grow(point);
+
+				Node* node = Root.get();
+				while (!node->Leaf)
+					node = node->Child[node->ChildIndex(point)].get();
+
+				Add(node, id, point);
+				if (node->Items.size() > LeafCapacity)
+					Split(node);
+			}
+
+			// moves an item, within its leaf this only updates the point
+			inline void Move(int64_t id, const Point& point)
+			{
+				auto itr = Leaves.find(id);
+				if (itr == Leaves.end())
+				{
+					Insert(id, point);
+					return;
+				}
+
+				Node* node = itr->second;
+				if (node->Contains(point))
+				{
+					for (auto& item : node->Items)
+					{
+						if (item.ID == id)
+						{
+							item.Position = point;
+							return;
+						}
+					}
+				}
+
+				Erase(id);
+				Insert(id, point);
+			}
+
+			inline void Erase(int64_t id)
+			{
+				auto itr = Leaves.find(id);
+				if (itr == Leaves.end())
+					return;
+
+				Node* node = itr->second;
+				Leaves.erase(itr);
+				for (size_t i = 0; i < node->Items.size(); i++)
+				{
+					if (node->Items[i].ID == id)
+					{
+						node->Items[i] = node->Items.back();
+						node->Items.pop_back();
+						break;
+					}
+				}
+
+				// merge parents whose leaves hold few enough items between them
+				for (Node* parent = node->Parent; parent != nullptr && CanMerge(parent); parent = parent->Parent)
+					Merge(parent);
+			}
+
+			inline void Clear()
+			{
+				Root = nullptr;
+				Leaves.clear();
+			}
+
+			inline size_t Size() const { return Leaves.size(); }
+
+			// leaf nodes in the tree, follows the splits and merges
+			inline size_t LeafCount() const
+			{
+				return Root == nullptr ? 0 : CountLeaves(Root.get());
+			}
+
+			// calls func with the ID of every item within radius of center
+			template<class F>
+			inline void Query(const Point& center, float radius, F func) const
+			{
+				if (Root != nullptr)
+					QueryNode(Root.get(), center, radius * radius, func);
+			}
+
+			static inline float DistanceSq(const Point& a, const Point& b)
+			{
+				float total = 0;
+				for (int i = 0; i < Dimensions; i++)
+					total += (a[i] - b[i]) * (a[i] - b[i]);
+				return total;
+			}
+
+		private:
+			class Item
+			{
+			public:
+				int64_t ID = 0;
+				Point Position;
+			};
+
+			class Node
+			{
+			public:
+				Point Min;
+				float Size = 0;
+				Node* Parent = nullptr;
+				bool Leaf = true;
+				std::array<std::unique_ptr<Node>, Children> Child;
+				std::vector<Item> Items;
+
+				inline bool Contains(const Point& point) const
+				{
+					for (int i = 0; i < Dimensions; i++)
+					{
+						if (point[i] < Min[i] || point[i] >= Min[i] + Size)
+							return false;
+					}
+					return true;
+				}
+
+				inline int ChildIndex(const Point& point) const
+				{
+					int index = 0;
+					for (int i = 0; i < Dimensions; i++)
+					{
+						if (point[i] >= Min[i] + Size / 2)
+							index |= 1 << i;
+					}
+					return index;
+				}
+
+				// squared distance from the point to the closest point of this node's box
+				inline float DistanceSq(const Point& point) const
+				{
+					float total = 0;
+					for (int i = 0; i < Dimensions; i++)
+					{
+						float d = std::max(Min[i] - point[i], std::max(0.0f, point[i] - (Min[i] + Size)));
+						total += d * d;
+					}
+					return total;
+				}
+			};
+
+			std::unique_ptr<Node> Root;
+			std::unordered_map<int64_t, Node*> Leaves;	// leaf holding each item
+
+			static inline size_t CountLeaves(const Node* node)
+			{
+				if (node->Leaf)
+					return 1;
+
+				size_t count = 0;
+				for (auto& child : node->Child)
+					count += CountLeaves(child.get());
+				return count;
+			}
+
+			template<class F>
+			inline void QueryNode(const Node* node, const Point& center, float radiusSq, F& func) const
+			{
+				if (node->DistanceSq(center) > radiusSq)
+					return;
+
+				if (!node->Leaf)
+				{
+					for (auto& child : node->Child)
+						QueryNode(child.get(), center, radiusSq, func);
+					return;
+				}
+
+				for (auto& item : node->Items)
+				{
+					if (DistanceSq(item.Position, center) <= radiusSq)
+						func(item.ID);
+				}
+			}
+
+			inline void Add(Node* node, int64_t id, const Point& point)
+			{
+				Item item;
+				item.ID = id;
+				item.Position = point;
+				node->Items.push_back(item);
+				Leaves[id] = node;
+			}
+
+			inline std::unique_ptr<Node> MakeChild(Node* parent, int index)
+			{
+				auto child = std::make_unique<Node>();
+				child->Parent = parent;
+				child->Size = parent->Size / 2;
+				for (int i = 0; i < Dimensions; i++)
+					child->Min[i] = parent->Min[i] + ((index & (1 << i)) ? child->Size : 0);
+				return child;
+			}
+
+			// doubles the root toward the point, the old root becomes one of its children
+			inline void Grow(const Point& point)
+			{
+				auto root = std::make_unique<Node>();
+				root->Size = Root->Size * 2;
+				root->Leaf = false;
+
+				int oldIndex = 0;
+				for (int i = 0; i < Dimensions; i++)
+				{
+					if (point[i] < Root->Min[i])
+					{
+						root->Min[i] = Root->Min[i] - Root->Size;
+						oldIndex |= 1 << i;
+					}
+					else
+						root->Min[i] = Root->Min[i];
+				}
+
+				for (int c = 0; c < Children; c++)
+				{
+					if (c != oldIndex)
+						root->Child[c] = MakeChild(root.get(), c);
+				}
+				Root->Parent = root.get();
+				root->Child[oldIndex] = std::move(Root);
+				Root = std::move(root);
+			}
+
+			inline void Split(Node* node)
+			{
+				if (node->Size / 2 < MinNodeSize)
+					return;
+
+				node->Leaf = false;
+				for (int c = 0; c < Children; c++)
+					node->Child[c] = MakeChild(node, c);
+
+				std::vector<Item> items;
+				items.swap(node->Items);
+				for (auto& item : items)
+					Add(node->Child[node->ChildIndex(item.Position)].get(), item.ID, item.Position);
+
+				for (auto& child : node->Child)
+				{
+					if (child->Items.size() > LeafCapacity)
+						Split(child.get());
+				}
+			}
+
+			inline bool CanMerge(const Node* node) const
+			{
+				size_t count = 0;
+				for (auto& child : node->Child)
+				{
+					if (!child->Leaf)
+						return false;
+					count += child->Items.size();
+				}
+				return count <= LeafCapacity / 2;
+			}
+
+			inline void Merge(Node* node)
+			{
+				for (auto& child : node->Child)
+				{
+					for (auto& item : child->Items)
+						Add(node, item.ID, item.Position);
+					child = nullptr;
+				}
+				node->Leaf = true;
+			}
+		};
+
+		// avatar interest backed by a SpatialTree, exact distance tests on the tree's axes. QuadtreeInterest for mostly flat worlds, OctreeInterest for full 3D
+		template<int Dimensions>
+		class TreeInterest : public SpatialInterest
+		{
+		public:
+			typedef std::shared_ptr<TreeInterest<Dimensions>> Ptr;
+
+			SpatialTree<Dimensions> Tree;
+			std::array<int, Dimensions> Axes;	// position components the tree is built on, X and Y for the quadtree
+
+			TreeInterest()
+			{
+				for (int i = 0; i < Dimensions; i++)
+					Axes[i] = i;
+			}
+
+			static inline Ptr Make(float enterRadius, float leaveRadius)
+			{
+				auto tree = std::make_shared<TreeInterest<Dimensions>>();
+				tree->EnterRadius = enterRadius;
+				tree->LeaveRadius = leaveRadius;
+				return tree;
+			}
+
+		protected:
+			typedef typename SpatialTree<Dimensions>::Point Point;
+
+			inline Point Project(const float position[3]) const
+			{
+				Point point;
+				for (int i = 0; i < Dimensions; i++)
+					point[i] = position[Axes[i]];
+				return point;
+			}
+
+			inline void Insert(int64_t id, const float position[3]) override { Tree.Insert(id, Project(position)); }
+			inline void Move(int64_t id, const float position[3]) override { Tree.Move(id, Project(position)); }
+			inline void Erase(int64_t id) override { Tree.Erase(id); }
+			inline void ClearIndex() override { Tree.Clear(); }
+
+			inline void Query(const float center[3], float radius, const std::function<void(int64_t)>& func) const override
+			{
+				Tree.Query(Project(center), radius, func);
+			}
+
+			inline float DistanceSq(const float a[3], const float b[3]) const override
+			{
+				return SpatialTree<Dimensions>::DistanceSq(Project(a), Project(b));
+			}
+
+			// entities found at the last query stay inside LeaveRadius until the avatar has moved half the gap between the radii, so the tree isn't queried for every step
+			inline bool ViewChanged(const float from[3], const float to[3]) const override
+			{
+				float threshold = std::max(0.0f, (LeaveRadius - EnterRadius) / 2);
+				return DistanceSq(from, to) > threshold * threshold;
+			}
+		};
+
+		typedef TreeInterest<2> QuadtreeInterest;
+		typedef TreeInterest<3> OctreeInterest;
+	}
+}
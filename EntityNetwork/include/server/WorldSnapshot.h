@@ -0,0 +1,235 @@
+//  Copyright (c) 2020 Jeffery Myers
+//
+//	EntityNetwork and its associated sub proejcts are free software;
+//
+//	Permission is hereby granted, free of charge, to any person obtaining a copy
+//	of this software and associated documentation files (the "Software"), to deal
+//	in the Software without restriction, including without limitation the rights
+//	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//	copies of the Software, and to permit persons to whom the Software is
+//	furnished to do so, subject to the following conditions:
+//	
+//	The above copyright notice and this permission notice shall be included in all
+//	copies or substantial portions of the Software.
+//	
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//	SOFTWARE.
+#pragma once
+
+#include <array>
+#include <memory>
+#include <vector>
+#include <algorithm>
+
+#include "Entity.h"
+
+namespace EntityNetwork
+{
+	namespace Server
+	{
+		// immutable copy of the replicated state of one entity, taken on the simulation thread at the end of a tick
+		class EntitySnapshot
+		{
+		public:
+			typedef std::shared_ptr<const EntitySnapshot> Ptr;
+
+			int64_t ID = EntityInstance::InvalidID;
+			int64_t OwnerID = EntityInstance::InvalidID;
+			EntityDesc::Ptr Descriptor;
+			std::vector<PropertyData::Ptr> Properties;	// indexed by property ID, never written once the snapshot is taken
+
+			// copies every property of the entity
+			static inline Ptr Make(EntityInstance& entity)
+			{
+				auto snapshot = std::make_shared<EntitySnapshot>();
+				snapshot->ID = entity.ID;
+				snapshot->OwnerID = entity.OwnerID;
+				snapshot->Descriptor = entity.Descriptor;
+				snapshot->Properties.reserve(entity.Properties.Size());
+				entity.Properties.DoForEach([&snapshot](PropertyData::Ptr& prop)
+					{
+						snapshot->Properties.push_back(prop->CopyValue());
+					});
+				return snapshot;
+			}
+
+			// copies the changed properties of the entity, the rest are shared with the previous snapshot
+			static inline Ptr Update(const EntitySnapshot& previous, EntityInstance& entity, const std::vector<int>& changedIDs)
+			{
+				auto snapshot = std::make_shared<EntitySnapshot>(previous);
+				snapshot->OwnerID = entity.OwnerID;
+				for (int id : changedIDs)
+				{
+					auto prop = entity.Properties.TryGet(id);
+					if (prop != nullptr && static_cast<size_t>(id) < snapshot->Properties.size())
+						snapshot->Properties[id] = (*prop)->CopyValue();
+				}
+				return snapshot;
+			}
+
+			inline PropertyData::Ptr GetProperty(int id) const
+			{
+				if (id < 0 || static_cast<size_t>(id) >= Properties.size())
+					return nullptr;
+				return Properties[id];
+			}
+		};
+
+		// copy on write view of every synced entity at the end of a server tick.
+		// entities are kept in small leaves by ID, grouped into pages. A new snapshot shares every page and leaf with the one before it
+		// and only copies the ones holding an entity that changed, so taking one costs the changes rather than the whole world.
+		// Once published a snapshot is not written and can be read from any thread
+		class WorldSnapshot
+		{
+		public:
+			typedef std::shared_ptr<const WorldSnapshot> Ptr;
+
+			static constexpr size_t LeafEntities = 16;
+			static constexpr size_t PageLeaves = 256;
+
+			tick_t Tick = 0;
+
+			inline EntitySnapshot::Ptr Find(int64_t id) const
+			{
+				if (id < 0)
+					return nullptr;
+
+				size_t leaf = static_cast<size_t>(id) / LeafEntities;
+				size_t page = leaf / PageLeaves;
+				if (page >= Pages.size() || Pages[page] == nullptr)
+					return nullptr;
+
+				auto& leafPtr = (*Pages[page])[leaf % PageLeaves];
+				if (leafPtr == nullptr)
+					return nullptr;
+				return (*leafPtr)[static_cast<size_t>(id) % LeafEntities];
+			}
+
+			template<class F>
+			inline void DoForEach(F func) const
+			{
+				for (auto& page : Pages)
+				{
+					if (page == nullptr)
+						continue;
+
+					for (auto& leaf : *page)
+					{
+						if (leaf == nullptr)
+							continue;
+
+						for (auto& entity : *leaf)
+						{
+							if (entity != nullptr)
+								func(entity);
+						}
+					}
+				}
+			}
+
+			inline size_t Size() const { return Count; }
+
+			// pages and leaves holding at least one entity, what the snapshot keeps alive
+			inline size_t PageCount() const
+			{
+				return std::count_if(Pages.begin(), Pages.end(), [](const std::shared_ptr<Page>& p) { return p != nullptr; });
+			}
+
+			inline size_t LeafCount() const
+			{
+				size_t count = 0;
+				for (auto& page : Pages)
+				{
+					if (page != nullptr)
+						count += std::count_if(page->begin(), page->end(), [](const std::shared_ptr<Leaf>& l) { return l != nullptr; });
+				}
+				return count;
+			}
+
+			// starts the snapshot for the next tick, sharing everything with this one
+			inline std::shared_ptr<WorldSnapshot> Next(tick_t tick) const
+			{
+				auto next = std::make_shared<WorldSnapshot>();
+				next->Tick = tick;
+				next->Pages = Pages;
+				next->Count = Count;
+				return next;
+			}
+
+			// only valid between Next and publishing the snapshot
+			inline void Set(EntitySnapshot::Ptr entity)
+			{
+				if (entity == nullptr || entity->ID < 0)
+					return;
+
+				auto& slot = WriteSlot(entity->ID);
+				if (slot == nullptr)
+					Count++;
+				slot = entity;
+			}
+
+			inline void Erase(int64_t id)
+			{
+				if (Find(id) == nullptr)
+					return;
+
+				WriteSlot(id) = nullptr;
+				Count--;
+
+				// drop leaves and pages that emptied so IDs that are never reused don't leave a trail behind
+				size_t leaf = static_cast<size_t>(id) / LeafEntities;
+				size_t page = leaf / PageLeaves;
+				auto& leafPtr = (*Pages[page])[leaf % PageLeaves];
+				if (std::all_of(leafPtr->begin(), leafPtr->end(), [](const EntitySnapshot::Ptr& e) { return e == nullptr; }))
+				{
+					leafPtr = nullptr;
+					if (std::all_of(Pages[page]->begin(), Pages[page]->end(), [](const std::shared_ptr<Leaf>& l) { return l == nullptr; }))
+						Pages[page] = nullptr;
+				}
+			}
+
+		private:
+			typedef std::array<EntitySnapshot::Ptr, LeafEntities> Leaf;
+			typedef std::array<std::shared_ptr<Leaf>, PageLeaves> Page;
+
+			std::vector<std::shared_ptr<Page>> Pages;
+			size_t Count = 0;
+
+			// pages and leaves copied since Next, the only ones that can be written in place
+			std::vector<bool> OwnedPages;
+			std::vector<bool> OwnedLeaves;
+
+			inline EntitySnapshot::Ptr& WriteSlot(int64_t id)
+			{
+				size_t leaf = static_cast<size_t>(id) / LeafEntities;
+				size_t page = leaf / PageLeaves;
+
+				if (page >= Pages.size())
+					Pages.resize(page + 1);
+				if (page >= OwnedPages.size())
+					OwnedPages.resize(page + 1, false);
+				if (leaf >= OwnedLeaves.size())
+					OwnedLeaves.resize(leaf + 1, false);
+
+				if (!OwnedPages[page] || Pages[page] == nullptr)
+				{
+					Pages[page] = Pages[page] == nullptr ? std::make_shared<Page>() : std::make_shared<Page>(*Pages[page]);
+					OwnedPages[page] = true;
+				}
+
+				auto& leafPtr = (*Pages[page])[leaf % PageLeaves];
+				if (!OwnedLeaves[leaf] || leafPtr == nullptr)
+				{
+					leafPtr = leafPtr == nullptr ? std::make_shared<Leaf>() : std::make_shared<Leaf>(*leafPtr);
+					OwnedLeaves[leaf] = true;
+				}
+				return (*leafPtr)[static_cast<size_t>(id) % LeafEntities];
+			}
+		};
+	}
+}
@@ -0,0 +1,991 @@
+//  Copyright (c) 2020 Jeffery Myers
+//
+//	EntityNetwork and its associated sub proejcts are free software;
+//
+//	Permission is hereby granted, free of charge, to any person obtaining a copy
+//	of this software and associated documentation files (the "Software"), to deal
+//	in the Software without restriction, including without limitation the rights
+//	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//	copies of the Software, and to permit persons to whom the Software is
+//	furnished to do so, subject to the following conditions:
+//	
+//	The above copyright notice and this permission notice shall be included in all
+//	copies or substantial portions of the Software.
+//	
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//	SOFTWARE.
+// serialization benchmarks for Messages.h, PropertyData and the full world entity messages.
+// reports time, throughput, heap allocations and wire bytes per operation for every wire format.
+// build and run on Linux with the Makefile in this folder, an optional argument scales the iteration counts.
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+
+#include "EntityNetwork.h"
+
+using namespace EntityNetwork;
+
+// count every heap allocation made by the process
+static std::atomic<size_t> AllocationCount(0);
+
+void* operator new(size_t size)
+{
+	AllocationCount++;
+	void* p = malloc(size == 0 ? 1 : size);
+	if (p == nullptr)
+		throw std::bad_alloc();
+	return p;
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+static double IterationScale = 1.0;
+static volatile uint64_t Sink = 0;	// results are folded in here so the optimizer can't drop the work
+
+// times a function returning the number of bytes it encoded or decoded
+template<class F>
+static void Run(const std::string& name, size_t iterations, F&& func)
+{
+	iterations = static_cast<size_t>(iterations * IterationScale);
+	if (iterations == 0)
+		iterations = 1;
+
+	for (size_t i = 0; i < iterations / 10 + 1; i++)
+		func();
+
+	size_t bytes = 0;
+	size_t allocations = AllocationCount;
+	auto start = std::chrono::steady_clock::now();
+
+	for (size_t i = 0; i < iterations; i++)
+		bytes += func();
+
+	auto end = std::chrono::steady_clock::now();
+	allocations = AllocationCount - allocations;
+
+	double ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+	double megabytes = bytes / (1024.0 * 1024.0);
+	double seconds = ns / 1e9;
+
+	printf("%-52s %10.1f ns/op %9.1f MB/s %8.2f allocs/op %9.1f bytes/op\n", name.c_str(), ns / iterations, seconds > 0 ? megabytes / seconds : 0.0, double(allocations) / iterations, double(bytes) / iterations);
+}
+
+struct FormatCase
+{
+	const char* Name;
+	WireFormat Format;
+};
+
+static std::vector<FormatCase> GetFormats()
+{
+	std::vector<FormatCase> formats;
+
+	WireFormat format;
+	formats.push_back({ "fixed", format });
+
+	format.VarInts = true;
+	formats.push_back({ "varint", format });
+
+	format.VarInts = false;
+	format.BitPackedEntities = true;
+	formats.push_back({ "bits", format });
+
+	format.VarInts = true;
+	formats.push_back({ "varint+bits", format });
+
+	format = WireFormat();
+	format.DeltaValues = true;
+	formats.push_back({ "delta", format });
+
+	format.VarInts = true;
+	format.BitPackedEntities = true;
+	formats.push_back({ "varint+bits+delta", format });
+	return formats;
+}
+
+static const char* DataTypeName(PropertyDesc::DataTypes dataType)
+{
+	switch (dataType)
+	{
+	case PropertyDesc::DataTypes::Integer: return "Integer";
+	case PropertyDesc::DataTypes::Vector3I: return "Vector3I";
+	case PropertyDesc::DataTypes::Vector4I: return "Vector4I";
+	case PropertyDesc::DataTypes::Float: return "Float";
+	case PropertyDesc::DataTypes::Vector3F: return "Vector3F";
+	case PropertyDesc::DataTypes::Vector4F: return "Vector4F";
+	case PropertyDesc::DataTypes::Double: return "Double";
+	case PropertyDesc::DataTypes::Vector3D: return "Vector3D";
+	case PropertyDesc::DataTypes::Vector4D: return "Vector4D";
+	case PropertyDesc::DataTypes::String: return "String";
+	case PropertyDesc::DataTypes::Buffer: return "Buffer";
+	case PropertyDesc::DataTypes::StateV3F: return "StateV3F";
+	case PropertyDesc::DataTypes::StateV3FQ4F: return "StateV3FQ4F";
+	}
+	return "Unknown";
+}
+
+// puts a typical value for the type in the property
+static void FillValue(PropertyData& prop, int seed)
+{
+	int ints[4] = { seed, -seed * 3, 70000 + seed, 12 };
+	float floats[4] = { seed * 0.5f, -12.25f, 300.125f, 0.707f };
+	double doubles[4] = { seed * 0.25, -1024.5, 1e6 + seed, 0.5 };
+
+	switch (prop.Descriptor->DataType)
+	{
+	case PropertyDesc::DataTypes::Integer: prop.SetValueI(ints[0]); break;
+	case PropertyDesc::DataTypes::Vector3I: prop.SetValue3I(ints); break;
+	case PropertyDesc::DataTypes::Vector4I: prop.SetValue4I(ints); break;
+	case PropertyDesc::DataTypes::Float: prop.SetValueF(floats[0]); break;
+	case PropertyDesc::DataTypes::Vector3F: prop.SetValue3F(floats); break;
+	case PropertyDesc::DataTypes::Vector4F: prop.SetValue4F(floats); break;
+	case PropertyDesc::DataTypes::Double: prop.SetValueD(doubles[0]); break;
+	case PropertyDesc::DataTypes::Vector3D: prop.SetValue3D(doubles); break;
+	case PropertyDesc::DataTypes::Vector4D: prop.SetValue4D(doubles); break;
+	case PropertyDesc::DataTypes::String: prop.SetValueStr("player_" + std::to_string(seed)); break;
+	case PropertyDesc::DataTypes::Buffer:
+	{
+		char buffer[48];
+		for (size_t i = 0; i < sizeof(buffer); i++)
+			buffer[i] = static_cast<char>(seed + i);
+		prop.SetValueBuffer(buffer, sizeof(buffer));
+	}
+	break;
+	case PropertyDesc::DataTypes::StateV3F:
+	{
+		StateUpdatePos state;
+		state.Step = 1000 + seed;
+		memcpy(state.Postion, floats, sizeof(state.Postion));
+		prop.SetValueStateUpdatePos(state);
+	}
+	break;
+	case PropertyDesc::DataTypes::StateV3FQ4F:
+	{
+		StateUpdatePosRot state;
+		state.Step = 1000 + seed;
+		memcpy(state.Postion, floats, sizeof(state.Postion));
+		state.Orientation[2] = 0.7071f;
+		state.Orientation[3] = 0.7071f;
+		prop.SetValueStateUpdatePosRot(state);
+	}
+	break;
+	}
+}
+
+static void BenchmarkPrimitives(const FormatCase& format)
+{
+	MessageBufferPool::Ptr pool = MessageBufferPool::Make();
+	std::string prefix = std::string("primitives/") + format.Name + "/";
+	const int count = 64;
+
+	Run(prefix + "AddInt x64", 200000, [&]()
+		{
+			MessageBufferBuilder builder(pool, format.Format);
+			builder.Command = MessageCodes::SetWorldDataValues;
+			for (int i = 0; i < count; i++)
+				builder.AddInt(i * 37 - 1000);
+			return builder.Pack()->MessageLenght;
+		});
+
+	MessageBufferBuilder ints(pool, format.Format);
+	ints.Command = MessageCodes::SetWorldDataValues;
+	for (int i = 0; i < count; i++)
+		ints.AddInt(i * 37 - 1000);
+	MessageBuffer::Ptr intMessage = ints.Pack();
+
+	Run(prefix + "ReadInt x64", 200000, [&]()
+		{
+			MessageBufferReader reader(intMessage, format.Format);
+			uint64_t sum = 0;
+			for (int i = 0; i < count; i++)
+				sum += reader.ReadInt();
+			Sink += sum;
+			return intMessage->MessageLenght;
+		});
+
+	Run(prefix + "AddID x64", 200000, [&]()
+		{
+			MessageBufferBuilder builder(pool, format.Format);
+			builder.Command = MessageCodes::RemoveEntity;
+			for (int i = 0; i < count; i++)
+				builder.AddID(i * 1021);
+			return builder.Pack()->MessageLenght;
+		});
+
+	Run(prefix + "AddFloat x64", 200000, [&]()
+		{
+			MessageBufferBuilder builder(pool, format.Format);
+			builder.Command = MessageCodes::SetWorldDataValues;
+			for (int i = 0; i < count; i++)
+				builder.AddFloat(i * 0.25f);
+			return builder.Pack()->MessageLenght;
+		});
+
+	Run(prefix + "AddString x16", 200000, [&]()
+		{
+			MessageBufferBuilder builder(pool, format.Format);
+			builder.Command = MessageCodes::AddEntityDef;
+			for (int i = 0; i < 16; i++)
+				builder.AddString("property_name");
+			return builder.Pack()->MessageLenght;
+		});
+
+	MessageBufferBuilder strings(pool, format.Format);
+	strings.Command = MessageCodes::AddEntityDef;
+	for (int i = 0; i < 16; i++)
+		strings.AddString("property_name");
+	MessageBuffer::Ptr stringMessage = strings.Pack();
+
+	Run(prefix + "ReadString x16", 200000, [&]()
+		{
+			MessageBufferReader reader(stringMessage, format.Format);
+			size_t total = 0;
+			for (int i = 0; i < 16; i++)
+				total += reader.ReadString().size();
+			Sink += total;
+			return stringMessage->MessageLenght;
+		});
+}
+
+static void BenchmarkProperty(const FormatCase& format, PropertyDesc::Ptr desc, const std::string& label)
+{
+	MessageBufferPool::Ptr pool = MessageBufferPool::Make();
+	std::string prefix = std::string("property/") + format.Name + "/" + label;
+	const int count = 32;
+
+	std::vector<PropertyData::Ptr> source;
+	std::vector<PropertyData::Ptr> target;
+	for (int i = 0; i < count; i++)
+	{
+		source.push_back(PropertyData::MakeShared(desc));
+		target.push_back(PropertyData::MakeShared(desc));
+		FillValue(*source.back(), i);
+	}
+
+	Run(prefix + " PackValue x32", 50000, [&]()
+		{
+			MessageBufferBuilder builder(pool, format.Format);
+			builder.Command = MessageCodes::SetEntityDataValues;
+			for (auto& prop : source)
+				prop->PackValue(builder);
+			return builder.Pack()->MessageLenght;
+		});
+
+	MessageBufferBuilder packed(pool, format.Format);
+	packed.Command = MessageCodes::SetEntityDataValues;
+	for (auto& prop : source)
+		prop->PackValue(packed);
+	MessageBuffer::Ptr message = packed.Pack();
+
+	Run(prefix + " UnpackValue x32", 50000, [&]()
+		{
+			MessageBufferReader reader(message, format.Format);
+			for (auto& prop : target)
+			{
+				reader.ReadByte();	// property ID written by PackValue
+				prop->UnpackValue(reader, true);
+			}
+			return message->MessageLenght;
+		});
+
+	if (!format.Format.BitPackedEntities)
+		return;
+
+	BitStreamWriter writer;
+	Run(prefix + " PackBits x32", 50000, [&]()
+		{
+			writer.Reset();
+			for (auto& prop : source)
+				prop->PackBits(writer);
+			return writer.ByteSize();
+		});
+
+	writer.Reset();
+	for (auto& prop : source)
+		prop->PackBits(writer);
+
+	Run(prefix + " UnpackBits x32", 50000, [&]()
+		{
+			BitStreamReader reader(writer.Data.data(), writer.ByteSize());
+			for (auto& prop : target)
+				prop->UnpackBits(reader, true);
+			return writer.ByteSize();
+		});
+}
+
+static void BenchmarkProperties(const FormatCase& format)
+{
+	for (int type = static_cast<int>(PropertyDesc::DataTypes::Integer); type <= static_cast<int>(PropertyDesc::DataTypes::StateV3FQ4F); type++)
+	{
+		PropertyDesc::Ptr desc = PropertyDesc::Make();
+		desc->DataType = static_cast<PropertyDesc::DataTypes>(type);
+		desc->Name = DataTypeName(desc->DataType);
+		desc->BufferSize = 64;
+		BenchmarkProperty(format, desc, desc->Name);
+	}
+
+	PropertyDesc::Ptr quantized = PropertyDesc::Make();
+	quantized->DataType = PropertyDesc::DataTypes::Vector3F;
+	quantized->SetQuantization(-2048, 2048, 16);
+	BenchmarkProperty(format, quantized, "Vector3F q16");
+
+	quantized = PropertyDesc::Make();
+	quantized->DataType = PropertyDesc::DataTypes::StateV3FQ4F;
+	quantized->SetQuantization(-2048, 2048, 16);
+	BenchmarkProperty(format, quantized, "StateV3FQ4F q16");
+}
+
+// drains every outbound message for a peer, returns the bytes sent
+static size_t Drain(Server::ServerWorld& server, int64_t peerID, std::vector<MessageBuffer::Ptr>* captured)
+{
+	size_t bytes = 0;
+	for (MessageBuffer::Ptr msg = server.PopOutboundData(peerID); msg != nullptr; msg = server.PopOutboundData(peerID))
+	{
+		bytes += msg->MessageLenght;
+		if (captured != nullptr)
+			captured->push_back(msg);
+	}
+	return bytes;
+}
+
+static void SetupWorld(Server::ServerWorld& server, const WireFormat& format)
+{
+	server.Wire = format;
+	server.RegisterControllerProperty("Name", PropertyDesc::DataTypes::String, 32);
+
+	EntityDesc::Ptr tank = EntityDesc::Make();
+	tank->Name = "Tank";
+	tank->AddPropertyDesc("Name", PropertyDesc::DataTypes::String, 32);
+	tank->AddPropertyDesc("Position", PropertyDesc::DataTypes::Vector3F);
+	tank->AddPropertyDesc("State", PropertyDesc::DataTypes::StateV3FQ4F);
+	tank->AddPropertyDesc("Health", PropertyDesc::DataTypes::Integer);
+	for (auto& prop : tank->Properties)
+		prop->Scope = PropertyDesc::Scopes::ServerPushSync;
+	server.RegisterEntityDesc(tank);
+}
+
+static void BenchmarkWorld(const FormatCase& format)
+{
+	std::string prefix = std::string("world/") + format.Name + "/";
+	const int entityCount = 64;
+
+	Server::ServerWorld server;
+	SetupWorld(server, format.Format);
+
+	std::vector<EntityInstance::Ptr> entities;
+	for (int i = 0; i < entityCount; i++)
+	{
+		int64_t id = server.CreateInstance("Tank", -1, [i](EntityInstance::Ptr ent)
+			{
+				for (auto& prop : ent->Properties.GetExclusiveAccess())
+					FillValue(*prop, i);
+				ent->Properties.ReleaseExclusiveAccess();
+			});
+		entities.push_back(*server.EntityInstances.Find(id));
+	}
+
+	// AddEntity: a new peer joins and is sent every entity
+	std::vector<MessageBuffer::Ptr> joinMessages;
+	int64_t joinID = 100;
+	Run(prefix + "join AddEntity x64 encode", 500, [&]()
+		{
+			server.AddRemoteController(joinID);
+			server.Update();
+			joinMessages.clear();
+			size_t bytes = Drain(server, joinID, &joinMessages);
+			server.RemoveRemoteController(joinID);
+			return bytes;
+		});
+
+	Run(prefix + "join AddEntity x64 decode", 500, [&]()
+		{
+			Client::ClientWorld client;
+			size_t bytes = 0;
+			for (auto& msg : joinMessages)
+			{
+				client.AddInboundData(msg);
+				bytes += msg->MessageLenght;
+			}
+			Sink += client.EntityInstances.Size();
+			return bytes;
+		});
+
+	// SetEntityDataValues: a synced peer gets position and state changes every update
+	Client::ClientWorld client;
+	server.AddRemoteController(1);
+	server.Update();
+	std::vector<MessageBuffer::Ptr> syncMessages;
+	Drain(server, 1, &syncMessages);
+	for (auto& msg : syncMessages)
+		client.AddInboundData(msg);
+
+	int tick = 0;
+	std::vector<MessageBuffer::Ptr> updateMessages;
+	Run(prefix + "SetEntityDataValues x64 encode", 2000, [&]()
+		{
+			tick++;
+			for (auto& ent : entities)
+			{
+				FillValue(*ent->Properties[1], tick);
+				FillValue(*ent->Properties[2], tick);
+			}
+			server.Update();
+			updateMessages.clear();
+			return Drain(server, 1, &updateMessages);
+		});
+
+	Run(prefix + "SetEntityDataValues x64 decode", 2000, [&]()
+		{
+			size_t bytes = 0;
+			for (auto& msg : updateMessages)
+			{
+				client.AddInboundData(msg);
+				bytes += msg->MessageLenght;
+			}
+			return bytes;
+		});
+}
+
+// server update cost with many synced peers, most entities idle and a few moving each tick
+static void BenchmarkPeers()
+{
+	const int entityCount = 256;
+	const int peerCount = 64;
+	const int movingCount = 16;
+
+	FormatCase format = GetFormats().back();
+	std::string prefix = std::string("peers/") + format.Name + "/";
+
+	Server::ServerWorld server;
+	SetupWorld(server, format.Format);
+
+	std::vector<EntityInstance::Ptr> entities;
+	for (int i = 0; i < entityCount; i++)
+	{
+		int64_t id = server.CreateInstance("Tank", -1, [i](EntityInstance::Ptr ent)
+			{
+				for (auto& prop : ent->Properties.GetExclusiveAccess())
+					FillValue(*prop, i);
+				ent->Properties.ReleaseExclusiveAccess();
+			});
+		entities.push_back(*server.EntityInstances.Find(id));
+	}
+
+	for (int peer = 1; peer <= peerCount; peer++)
+		server.AddRemoteController(peer);
+	server.Update();
+	for (int peer = 1; peer <= peerCount; peer++)
+		Drain(server, peer, nullptr);
+
+	Run(prefix + "Update x64 peers idle", 200, [&]()
+		{
+			server.Update();
+			size_t bytes = 0;
+			for (int peer = 1; peer <= peerCount; peer++)
+				bytes += Drain(server, peer, nullptr);
+			return bytes;
+		});
+
+	int tick = 0;
+	Run(prefix + "Update x64 peers 16 moving", 200, [&]()
+		{
+			tick++;
+			for (int i = 0; i < movingCount; i++)
+				FillValue(*entities[i]->Properties[1], tick);
+			server.Update();
+			size_t bytes = 0;
+			for (int peer = 1; peer <= peerCount; peer++)
+				bytes += Drain(server, peer, nullptr);
+			return bytes;
+		});
+
+	// the same load with the peers split over a worker pool
+	for (size_t threads = 2; threads <= 8; threads *= 2)
+	{
+		server.ReplicationWorkers = WorkerPool::Make(threads);
+		Run(prefix + "Update x64 peers 16 moving, " + std::to_string(threads) + " replication threads", 200, [&]()
+			{
+				tick++;
+				for (int i = 0; i < movingCount; i++)
+					FillValue(*entities[i]->Properties[1], tick);
+				server.Update();
+				size_t bytes = 0;
+				for (int peer = 1; peer <= peerCount; peer++)
+					bytes += Drain(server, peer, nullptr);
+				return bytes;
+			});
+	}
+	server.ReplicationWorkers = nullptr;
+
+	// the same load with each tick's snapshot replicated and drained on a worker while the next tick runs.
+	// timed on the simulation thread, which only waits when the worker is still busy with the tick before
+	std::mutex workerMutex;
+	std::condition_variable workerSignal;
+	Server::WorldSnapshot::Ptr pending;
+	bool stop = false;
+	size_t workerBytes = 0;
+	std::thread replication([&]()
+		{
+			std::unique_lock<std::mutex> lock(workerMutex);
+			while (true)
+			{
+				workerSignal.wait(lock, [&]() { return pending != nullptr || stop; });
+				if (pending == nullptr)
+					return;
+
+				server.ReplicateSnapshot(pending);
+				for (int peer = 1; peer <= peerCount; peer++)
+					workerBytes += Drain(server, peer, nullptr);
+				pending = nullptr;
+				workerSignal.notify_all();
+			}
+		});
+
+	Run(prefix + "EndTick x64 peers 16 moving, replicated off thread", 200, [&]()
+		{
+			tick++;
+			for (int i = 0; i < movingCount; i++)
+				FillValue(*entities[i]->Properties[1], tick);
+			auto snapshot = server.EndTick();
+
+			std::unique_lock<std::mutex> lock(workerMutex);
+			workerSignal.wait(lock, [&]() { return pending == nullptr; });
+			pending = snapshot;
+			workerSignal.notify_all();
+
+			size_t bytes = workerBytes;
+			workerBytes = 0;
+			return bytes;
+		});
+
+	{
+		std::unique_lock<std::mutex> lock(workerMutex);
+		workerSignal.wait(lock, [&]() { return pending == nullptr; });
+		stop = true;
+		workerSignal.notify_all();
+	}
+	replication.join();
+}
+
+// a large mostly static world, update cost should follow the number of changes
+static void BenchmarkLargeWorld()
+{
+	const int entityCount = 50000;
+	const int peerCount = 4;
+	const int movingCount = 64;
+
+	FormatCase format = GetFormats().back();
+	std::string prefix = std::string("large/") + format.Name + "/";
+
+	Server::ServerWorld server;
+	SetupWorld(server, format.Format);
+
+	std::vector<EntityInstance::Ptr> entities;
+	for (int i = 0; i < entityCount; i++)
+	{
+		int64_t id = server.CreateInstance("Tank", -1, [i](EntityInstance::Ptr ent)
+			{
+				for (auto& prop : ent->Properties.GetExclusiveAccess())
+					FillValue(*prop, i);
+				ent->Properties.ReleaseExclusiveAccess();
+			});
+		entities.push_back(*server.EntityInstances.Find(id));
+	}
+
+	for (int peer = 1; peer <= peerCount; peer++)
+		server.AddRemoteController(peer);
+	server.Update();
+	for (int peer = 1; peer <= peerCount; peer++)
+		Drain(server, peer, nullptr);
+
+	int tick = 0;
+	for (int interval = 1; interval <= 4; interval *= 4)
+	{
+		server.RemoteEnitityControllers.DoForEach([interval](auto& /*key*/, Server::ServerEntityController::Ptr& peer) { peer->SyncInterval = interval; });
+
+		Run(prefix + "Update x50000 entities 64 moving, sync every " + std::to_string(interval), 200, [&]()
+			{
+				tick++;
+				for (int i = 0; i < movingCount; i++)
+					FillValue(*entities[(tick * 7 + i * 131) % entityCount]->Properties[1], tick);
+				server.Update();
+				size_t bytes = 0;
+				for (int peer = 1; peer <= peerCount; peer++)
+					bytes += Drain(server, peer, nullptr);
+				return bytes;
+			});
+	}
+}
+
+// 200 players spread over a map, every avatar moving each update. With interest management each peer only gets its neighborhood
+static void BenchmarkInterest()
+{
+	const int playerCount = 200;
+	const float mapSize = 4000;
+
+	const char* policyNames[] = { "off", "grid", "quadtree", "octree", "quadtree 32B budget" };
+	for (int policy = 0; policy < 5; policy++)
+	{
+		FormatCase format = GetFormats().back();
+		std::string prefix = std::string("interest/") + format.Name + "/" + policyNames[policy] + " ";
+
+		Server::ServerWorld server;
+		SetupWorld(server, format.Format);
+		EntityDesc::Ptr tank = server.GetEntityDef("Tank");
+		tank->IsAvatar = true;
+		tank->SetPositionProperty("Position");
+		if (policy == 1)
+			server.Interest = Server::GridInterest::Make(250, 250, 500);
+		else if (policy == 2 || policy == 4)
+			server.Interest = Server::QuadtreeInterest::Make(375, 500);
+		else if (policy == 3)
+			server.Interest = Server::OctreeInterest::Make(375, 500);
+
+		std::vector<EntityInstance::Ptr> avatars;
+		for (int peer = 1; peer <= playerCount; peer++)
+		{
+			auto controller = server.AddRemoteController(peer);
+			if (policy == 4)
+				controller->BytesPerTick = 32;
+			int64_t id = server.CreateInstance("Tank", peer, [peer, mapSize](EntityInstance::Ptr ent)
+				{
+					float pos[3] = { static_cast<float>((peer * 7919) % 4000) * mapSize / 4000, static_cast<float>((peer * 104729) % 4000) * mapSize / 4000, 0 };
+					ent->Properties[1]->SetValue3F(pos);
+				});
+			avatars.push_back(*server.EntityInstances.Find(id));
+		}
+		server.Update();
+		for (int peer = 1; peer <= playerCount; peer++)
+			Drain(server, peer, nullptr);
+
+		int tick = 0;
+		Run(prefix + "Update x200 peers all moving", 50, [&]()
+			{
+				tick++;
+				for (size_t i = 0; i < avatars.size(); i++)
+				{
+					float* pos = avatars[i]->Properties[1]->GetValue3F();
+					float next[3] = { std::fmod(pos[0] + 3 + (i % 5), mapSize), std::fmod(pos[1] + 2 + (i % 3), mapSize), 0 };
+					avatars[i]->Properties[1]->SetValue3F(next);
+				}
+				server.Update();
+				size_t bytes = 0;
+				for (int peer = 1; peer <= playerCount; peer++)
+					bytes += Drain(server, peer, nullptr);
+				return bytes;
+			});
+	}
+}
+
+// the spatial indexes behind the interest policies on an uneven world, half the entities spread out and half in a few dense clusters
+template<class T>
+class ExposedIndex : public T
+{
+public:
+	using T::Insert;
+	using T::Move;
+	using T::Query;
+};
+
+template<class T>
+static void BenchmarkSpatialIndex(const std::string& name, int entityCount)
+{
+	const float worldSize = 20000;
+	std::string prefix = "spatial/" + name + " " + std::to_string(entityCount / 1000) + "k/";
+
+	std::vector<std::array<float, 3>> positions;
+	uint32_t seed = 12345;
+	auto random = [&seed]() { seed = seed * 1664525 + 1013904223; return (seed >> 8) / 16777216.0f; };
+	for (int i = 0; i < entityCount; i++)
+	{
+		std::array<float, 3> pos;
+		if (i % 2 == 0)
+			pos = { random() * worldSize, random() * worldSize, random() * 100 };
+		else
+		{
+			float cluster = static_cast<float>(i % 4 + 1) * worldSize / 5;
+			pos = { cluster + (random() - 0.5f) * 1000, cluster + (random() - 0.5f) * 1000, random() * 100 };
+		}
+		positions.push_back(pos);
+	}
+
+	ExposedIndex<T> index;
+	if constexpr (std::is_same<T, Server::GridInterest>::value)
+		index.CellSize = 250;
+	for (int i = 0; i < entityCount; i++)
+		index.Insert(i, positions[i].data());
+
+	size_t next = 0;
+	Run(prefix + "Query r=250 x100", 200, [&]()
+		{
+			size_t found = 0;
+			for (int q = 0; q < 100; q++)
+			{
+				index.Query(positions[(next++ * 7919) % entityCount].data(), 250, [&found](int64_t /*id*/) { found++; });
+			}
+			Sink += found;
+			return found * sizeof(int64_t);
+		});
+
+	Run(prefix + "Move x1000", 200, [&]()
+		{
+			for (int m = 0; m < 1000; m++)
+			{
+				size_t id = (next++ * 104729) % entityCount;
+				positions[id][0] += (random() - 0.5f) * 20;
+				positions[id][1] += (random() - 0.5f) * 20;
+				index.Move(static_cast<int64_t>(id), positions[id].data());
+			}
+			return size_t(1000 * 12);
+		});
+}
+
+static void BenchmarkSpatial()
+{
+	for (int count : { 10000, 100000 })
+	{
+		BenchmarkSpatialIndex<Server::GridInterest>("grid", count);
+		BenchmarkSpatialIndex<Server::QuadtreeInterest>("quadtree", count);
+		BenchmarkSpatialIndex<Server::OctreeInterest>("octree", count);
+	}
+}
+
+// projectiles: entities created and removed every update, with and without an entity pool
+static void BenchmarkChurn()
+{
+	const int spawnCount = 32;
+
+	for (int pooled = 0; pooled < 2; pooled++)
+	{
+		FormatCase format = GetFormats().back();
+		std::string prefix = std::string("churn/") + format.Name + (pooled ? "/pooled " : "/new ");
+
+		Server::ServerWorld server;
+		SetupWorld(server, format.Format);
+		if (pooled)
+			server.SetEntityPoolSize("Tank", spawnCount);
+
+		server.AddRemoteController(1);
+		server.Update();
+		Drain(server, 1, nullptr);
+
+		std::vector<int64_t> ids;
+		Run(prefix + "create+remove x32", 2000, [&]()
+			{
+				for (int64_t id : ids)
+					server.RemoveInstance(id);
+				ids.clear();
+
+				for (int i = 0; i < spawnCount; i++)
+				{
+					ids.push_back(server.CreateInstance("Tank", -1, [i](EntityInstance::Ptr ent)
+						{
+							FillValue(*ent->Properties[1], i);
+						}));
+				}
+				server.Update();
+				return Drain(server, 1, nullptr);
+			});
+	}
+}
+
+// name lookups by string and by interned key
+static void BenchmarkLookup()
+{
+	Server::ServerWorld server;
+	SetupWorld(server, WireFormat());
+	server.RegisterWorldPropertyData("Width", PropertyDesc::DataTypes::Integer);
+
+	int64_t id = server.CreateInstance("Tank", -1);
+	EntityInstance::Ptr tank = *server.EntityInstances.Find(id);
+	NameKey health = NameTable::Intern("Health");
+	NameKey tankType = NameTable::Intern("Tank");
+
+	Run("lookup/FindProperty string x1000", 2000, [&]()
+		{
+			size_t found = 0;
+			for (int i = 0; i < 1000; i++)
+				found += tank->FindProperty("Health") != nullptr;
+			Sink += found;
+			return found;
+		});
+
+	Run("lookup/FindProperty key x1000", 2000, [&]()
+		{
+			size_t found = 0;
+			for (int i = 0; i < 1000; i++)
+				found += tank->FindProperty(health) != nullptr;
+			Sink += found;
+			return found;
+		});
+
+	Run("lookup/GetEntityDef key x1000", 2000, [&]()
+		{
+			size_t found = 0;
+			for (int i = 0; i < 1000; i++)
+				found += server.GetEntityDef(tankType) != nullptr;
+			Sink += found;
+			return found;
+		});
+}
+
+// typed handles against the runtime checked PropertyData accessors
+static void BenchmarkAccess()
+{
+	const int count = 1024;
+
+	PropertyDesc::Ptr desc = PropertyDesc::Make();
+	desc->DataType = PropertyDesc::DataTypes::Vector3F;
+
+	// entities listen for changes to queue themselves for replication, so every dirty mark pays for a call
+	size_t changes = 0;
+	std::vector<PropertyData::Ptr> props;
+	std::vector<PropertyHandle<std::array<float, 3>>> handles;
+	for (int i = 0; i < count; i++)
+	{
+		props.push_back(PropertyData::MakeShared(desc));
+		props.back()->ChangeListener = [&changes](int) { changes++; };
+		handles.emplace_back(props.back());
+	}
+
+	// each way of setting, once writing back the value the property already has and once writing a new one.
+	// Set marks the property dirty either way like SetValue3F, SetIfChanged compares first
+	float step = 0;
+	for (int changing = 0; changing < 2; changing++)
+	{
+		const char* label = changing ? " new" : " same";
+
+		Run(std::string("access/PropertyData SetValue3F+GetValue3F") + label + " x1024", 20000, [&]()
+			{
+				float sum = 0;
+				step += changing;
+				for (int i = 0; i < count; i++)
+				{
+					float value[3] = { float(i), step, 2 };
+					props[i]->SetValue3F(value);
+					sum += props[i]->GetValue3F()[0];
+				}
+				Sink += static_cast<uint64_t>(sum);
+				return count * sizeof(float) * 3;
+			});
+
+		Run(std::string("access/PropertyHandle Set+Get") + label + " x1024", 20000, [&]()
+			{
+				float sum = 0;
+				step += changing;
+				for (int i = 0; i < count; i++)
+				{
+					handles[i].Set({ float(i), step, 2 });
+					sum += handles[i].Get()[0];
+				}
+				Sink += static_cast<uint64_t>(sum);
+				return count * sizeof(float) * 3;
+			});
+
+		Run(std::string("access/PropertyHandle SetIfChanged+Get") + label + " x1024", 20000, [&]()
+			{
+				float sum = 0;
+				step += changing;
+				for (int i = 0; i < count; i++)
+				{
+					handles[i].SetIfChanged({ float(i), step, 2 });
+					sum += handles[i].Get()[0];
+				}
+				Sink += static_cast<uint64_t>(sum);
+				return count * sizeof(float) * 3;
+			});
+	}
+
+	Sink += changes;
+}
+
+// one pass over a property of every entity, through the instances and through ArchetypeStore columns
+static void BenchmarkColumns()
+{
+	const int entityCount = 4096;
+
+	for (int columns = 0; columns < 2; columns++)
+	{
+		std::string prefix = std::string("columns/") + (columns ? "store" : "instances") + "/";
+
+		EntityDesc::Ptr tank = EntityDesc::Make();
+		tank->Name = "Tank";
+		tank->AddPropertyDesc("Name", PropertyDesc::DataTypes::String, 32);
+		tank->AddPropertyDesc("Position", PropertyDesc::DataTypes::Vector3F);
+		tank->AddPropertyDesc("State", PropertyDesc::DataTypes::StateV3FQ4F);
+		tank->AddPropertyDesc("Health", PropertyDesc::DataTypes::Integer);
+		if (columns)
+			tank->UseArchetypeStore();
+
+		std::vector<EntityInstance::Ptr> entities;
+		for (int i = 0; i < entityCount; i++)
+		{
+			entities.push_back(EntityInstance::Make(tank));
+			for (auto& prop : entities.back()->Properties.GetExclusiveAccess())
+				FillValue(*prop, i);
+			entities.back()->Properties.ReleaseExclusiveAccess();
+		}
+
+		if (columns)
+		{
+			Run(prefix + "sum Health x4096", 2000, [&]()
+				{
+					int64_t sum = 0;
+					tank->Store->ForEachValue(3, [&sum](size_t, const void* value) { sum += *static_cast<const int*>(value); });
+					Sink += sum;
+					return entityCount * sizeof(int);
+				});
+		}
+		else
+		{
+			Run(prefix + "sum Health x4096", 2000, [&]()
+				{
+					int64_t sum = 0;
+					for (auto& ent : entities)
+						sum += ent->Properties[3]->GetValueI();
+					Sink += sum;
+					return entityCount * sizeof(int);
+				});
+		}
+	}
+}
+
+int main(int argc, char** argv)
+{
+	if (argc > 1)
+		IterationScale = atof(argv[1]);
+
+	for (auto& format : GetFormats())
+	{
+		BenchmarkPrimitives(format);
+		BenchmarkProperties(format);
+		BenchmarkWorld(format);
+	}
+	BenchmarkLookup();
+	BenchmarkAccess();
+	BenchmarkPeers();
+	BenchmarkLargeWorld();
+	BenchmarkInterest();
+	BenchmarkSpatial();
+	BenchmarkChurn();
+	BenchmarkColumns();
+
+	return 0;
+}
@@ -114,9 +114,9 @@ void InitNetworking()
 
 	NetClient = nullptr;
 	IsConnected = false;
-	RemoteHost = enet_host_create(nullptr, 1, 3, 0, 0);
+	RemoteHost = enet_host_create(nullptr, 1, ReliabilityClasses, 0, 0);
 	if (RemoteHost != nullptr)
-		NetClient = enet_host_connect(RemoteHost, &address, 3, 0);
+		NetClient = enet_host_connect(RemoteHost, &address, ReliabilityClasses, 0);
 }
 
 int serverRPCID = -1;
@@ -214,15 +214,18 @@ void UpdateEntNet()
 
 		case ENetEventType::ENET_EVENT_TYPE_RECEIVE:
 		//	std::cout << "Client Data Receive\n";
-			if (evt.channelID == 0)
-				WorldData.AddInboundData(MessageBuffer::MakeShared(evt.packet->data, evt.packet->dataLength, false));
+			if (evt.channelID < ReliabilityClasses)
+			{
+				// read straight out of the packet, it is destroyed when the world is done with the message
+				ENetPacket* packet = evt.packet;
+				WorldData.AddInboundData(MessageBuffer::MakeView(packet->data, packet->dataLength, [packet]() {enet_packet_destroy(packet); }));
+			}
 			else
 			{
 				// non entity data, must be other game data, like chat or something
 				// handle as needed
+				enet_packet_destroy(evt.packet);
 			}
-
-			enet_packet_destroy(evt.packet);
 			break;
 
 		case ENetEventType::ENET_EVENT_TYPE_NONE:
@@ -232,13 +235,17 @@ void UpdateEntNet()
 
 	WorldData.Update();
 
-	// send any pending outbound sync messages
-	auto msg = WorldData.PopOutboundData();
-	while (msg != nullptr)
+	// send any pending outbound sync messages, one channel per reliability class
+	for (size_t channel = 0; channel < ReliabilityClasses; channel++)
 	{
-		ENetPacket* packet = enet_packet_create(msg->MessageData, msg->MessageLenght, ENET_PACKET_FLAG_RELIABLE);
-		enet_peer_send(NetClient, 0, packet);
-		msg = WorldData.PopOutboundData();
+		Reliability reliability = static_cast<Reliability>(channel);
+		auto msg = WorldData.PopOutboundData(reliability);
+		while (msg != nullptr)
+		{
+			ENetPacket* packet = enet_packet_create(msg->MessageData, msg->MessageLenght, reliability == Reliability::UnreliableSequenced ? 0 : ENET_PACKET_FLAG_RELIABLE);
+			enet_peer_send(NetClient, static_cast<enet_uint8>(channel), packet);
+			msg = WorldData.PopOutboundData(reliability);
+		}
 	}
 }
 
@@ -124,15 +124,15 @@ public:
 
 	inline virtual void Created()
 	{
-		StatePtr = FindProperty("State");
-		PropertyChanged(StatePtr);
+		State.Bind(*this, "State");
+		PropertyChanged(State.Property);
 	}
 
 	inline virtual void PropertyChanged(PropertyData::Ptr ptr)
 	{
-		if (ptr == StatePtr)
+		if (State.Is(ptr))
 		{
-			float* state = ptr->GetValue3F();
+			std::array<float, 3> state = State.Get();
 			DrawPoint.x = (int)(state[0]);
 			DrawPoint.y = (int)(state[1]);
 			RealPosX = state[0];
@@ -143,14 +143,8 @@ public:
 
 	inline void UpdateState()
 	{
-		if (StatePtr != nullptr)
-		{
-			float pos[3] = { 0 };
-			pos[0] = RealPosX;
-			pos[1] = RealPosY;
-			pos[2] = DrawAngle;
-			StatePtr->SetValue3F(pos);
-		}
+		if (State.Bound())
+			State.SetIfChanged({ RealPosX, RealPosY, DrawAngle });
 
 		DrawPoint.x = (int)(RealPosX);
 		DrawPoint.y = (int)(RealPosY);
@@ -175,7 +169,7 @@ public:
 	}
 
 protected: 
-	PropertyData::Ptr StatePtr = nullptr;
+	PropertyHandle<std::array<float, 3>> State;
 };
 
 extern PlayerTank::Ptr SelfPointer;
@@ -34,14 +34,17 @@ std::string RandomName(int64_t id)
 	return firstNames[f] + lastNames[l] + std::to_string(id);
 }
 
+static const NameKey NameProperty = NameTable::Intern("Name");
+static const NameKey ScoreProperty = NameTable::Intern("Score");
+
 void HandleClientCreate(ServerEntityController::Ptr sender)
 {
 	auto peer = ServerPeer::Cast(sender);
-	auto name = sender->FindPropertyByName("Name");
+	auto name = sender->FindPropertyByName(NameProperty);
 	if (name != nullptr)
 		name->SetValueStr(RandomName(sender->GetID()));
 
-	auto score = sender->FindPropertyByName("Score");
+	auto score = sender->FindPropertyByName(ScoreProperty);
 	if (score != nullptr)
 		score->SetValueI(0);
 }
@@ -57,12 +60,9 @@ void HandleSpawnRequest(ServerEntityController::Ptr sender, const std::vector<Pr
 				int tankIndex = rand() % 5;
 				inst->Properties.Get(0)->SetValueStr(TankAvatars[tankIndex]);
 
-				float state[3] = { 0,0,0 };
-				state[0] = (float)(rand() % 750);
-				state[1] = (float)(rand() % 750);
-				state[2] = (float)((rand() % 360) - 180);
-
-				inst->Properties.Get(1)->SetValue3F(state);
+				PropertyHandle<std::array<float, 3>> state;
+				if (state.Bind(*inst, "State"))
+					state.Set({ (float)(rand() % 750), (float)(rand() % 750), (float)((rand() % 360) - 180) });
 			});
 	}
 }
\ No newline at end of file
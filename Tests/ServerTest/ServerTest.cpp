@@ -122,7 +122,7 @@ int main()
 	address.host = ENET_HOST_ANY;
 	address.port = DefaultHost;
 
-	auto ServerHost = enet_host_create(&address, MaxClients, 3, 0, 0);
+	auto ServerHost = enet_host_create(&address, MaxClients, ReliabilityClasses, 0, 0);
 	if (ServerHost == nullptr)
 		return -1;
 
@@ -155,15 +155,18 @@ int main()
 
 			case ENetEventType::ENET_EVENT_TYPE_RECEIVE:
 				std::cout << "Server Peer Receive Data\n";
-				if (evt.channelID == 0)
-					TheWorld.AddInboundData(peerID, MessageBuffer::MakeShared(evt.packet->data, evt.packet->dataLength, false));
+				if (evt.channelID < ReliabilityClasses)
+				{
+					// read straight out of the packet, it is destroyed when the world is done with the message
+					ENetPacket* packet = evt.packet;
+					TheWorld.AddInboundData(peerID, MessageBuffer::MakeView(packet->data, packet->dataLength, [packet]() {enet_packet_destroy(packet); }));
+				}
 				else
 				{
 					// non entity data, must be other game data, like chat or something
 					// handle as needed
+					enet_packet_destroy(evt.packet);
 				}
-
-				enet_packet_destroy(evt.packet);
 				break;
 				
 			case ENetEventType::ENET_EVENT_TYPE_NONE:
@@ -173,18 +176,22 @@ int main()
 
 		TheWorld.Update();
 
-		// send any pending outbound sync messages
+		// send any pending outbound sync messages, one channel per reliability class so lost unreliable packets don't hold up the rest
 		TheWorld.RemoteEnitityControllers.DoForEach([](auto& id, ServerEntityController::Ptr& p)
 			{
 				ServerPeer::Ptr peer = ServerPeer::Cast(p);
 
-				auto msg = p->GetOutbound();
-				while (msg != nullptr)
+				for (size_t channel = 0; channel < ReliabilityClasses; channel++)
 				{
-					std::cout << "Server Peer Send Data\n";
-					ENetPacket* packet = enet_packet_create(msg->MessageData, msg->MessageLenght, ENET_PACKET_FLAG_RELIABLE);
-					enet_peer_send(peer->NetworkPeer, 0, packet);
-					msg = p->GetOutbound();
+					Reliability reliability = static_cast<Reliability>(channel);
+					auto msg = p->GetOutbound(reliability);
+					while (msg != nullptr)
+					{
+						std::cout << "Server Peer Send Data\n";
+						ENetPacket* packet = enet_packet_create(msg->MessageData, msg->MessageLenght, reliability == Reliability::UnreliableSequenced ? 0 : ENET_PACKET_FLAG_RELIABLE);
+						enet_peer_send(peer->NetworkPeer, static_cast<enet_uint8>(channel), packet);
+						msg = p->GetOutbound(reliability);
+					}
 				}
 			});
 
@@ -0,0 +1,123 @@
+//  Copyright (c) 2020 Jeffery Myers
+//
+//	EntityNetwork and its associated sub proejcts are free software;
+//
+//	Permission is hereby granted, free of charge, to any person obtaining a copy
+//	of this software and associated documentation files (the "Software"), to deal
+//	in the Software without restriction, including without limitation the rights
+//	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//	copies of the Software, and to permit persons to whom the Software is
+//	furnished to do so, subject to the following conditions:
+//	
+//	The above copyright notice and this permission notice shall be included in all
+//	copies or substantial portions of the Software.
+//	
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//	SOFTWARE.
+
+// typed property handles and the lookup tables behind named access
+
+#include <array>
+
+#include "EntityNetwork.h"
+#include "PropertyHandle.h"
+#include "TestTools.h"
+
+using namespace EntityNetwork;
+
+TEST(PropertyHandleUnbound)
+{
+	PropertyHandle<std::array<float, 3>> handle;
+	CHECK(!handle.Bound());
+	CHECK(handle.Get()[0] == 0);
+	handle.Set({ 1, 2, 3 });
+
+	PropertyDesc::Ptr desc = PropertyDesc::Make();
+	desc->DataType = PropertyDesc::DataTypes::Integer;
+	CHECK(!handle.Bind(PropertyData::MakeShared(desc)));
+	CHECK(!handle.Bound());
+	handle.Set({ 1, 2, 3 });
+}
+
+TEST(PropertyHandleSetMarksDirty)
+{
+	PropertyDesc::Ptr desc = PropertyDesc::Make();
+	desc->DataType = PropertyDesc::DataTypes::Vector3F;
+	PropertyData::Ptr prop = PropertyData::MakeShared(desc);
+
+	int changes = 0;
+	prop->ChangeListener = [&changes](int) { changes++; };
+
+	PropertyHandle<std::array<float, 3>> handle(prop);
+	CHECK(handle.Bound());
+
+	handle.Set({ 1, 2, 3 });
+	CHECK(changes == 1);
+	CHECK(prop->IsDirty());
+	CHECK(handle.Get()[2] == 3);
+
+	// Set marks an unchanged value dirty, as SetValue3F does
+	prop->SetClean();
+	handle.Set({ 1, 2, 3 });
+	CHECK(changes == 2);
+	CHECK(prop->IsDirty());
+
+	// SetIfChanged skips it
+	prop->SetClean();
+	CHECK(!handle.SetIfChanged({ 1, 2, 3 }));
+	CHECK(changes == 2);
+	CHECK(!prop->IsDirty());
+
+	CHECK(handle.SetIfChanged({ 1, 2, 4 }));
+	CHECK(changes == 3);
+	CHECK(prop->IsDirty());
+	CHECK(prop->GetValue3F()[2] == 4);
+}
+
+TEST(NameIndexKeepsFirst)
+{
+	NameIndex<int> index;
+	index.Add("Position", 1);
+	index.Add("Health", 2);
+	index.Add("Position", 3);
+
+	CHECK(index.Find("Position", -1) == 1);
+	CHECK(index.Find(NameTable::Intern("Position"), -1) == 1);
+	CHECK(index.Find("Health", -1) == 2);
+	CHECK(index.Find("Missing", -1) == -1);
+
+	EntityDesc desc;
+	desc.AddPropertyDesc("Value", PropertyDesc::DataTypes::Integer);
+	desc.AddPropertyDesc("Value", PropertyDesc::DataTypes::Float);
+	CHECK(desc.PropertyIndex.Find("Value", -1) == 0);
+}
+
+// only vector and state properties can be the position the interest policies read
+TEST(SetPositionPropertyChecksType)
+{
+	EntityDesc desc;
+	desc.AddPropertyDesc("Health", PropertyDesc::DataTypes::Integer);
+	desc.AddPropertyDesc("Name", PropertyDesc::DataTypes::String);
+	desc.AddPropertyDesc("Cell", PropertyDesc::DataTypes::Vector3I);
+	desc.AddPropertyDesc("Location", PropertyDesc::DataTypes::Vector4D);
+	desc.AddPropertyDesc("Motion", PropertyDesc::DataTypes::StateV3FQ4F);
+
+	CHECK(!desc.SetPositionProperty("Missing"));
+	CHECK(desc.PositionProperty == -1);
+	CHECK(!desc.SetPositionProperty("Health"));
+	CHECK(desc.PositionProperty == -1);
+	CHECK(!desc.SetPositionProperty("Name"));
+	CHECK(desc.PositionProperty == -1);
+
+	CHECK(desc.SetPositionProperty("Cell"));
+	CHECK(desc.PositionProperty == 2);
+	CHECK(desc.SetPositionProperty("Location"));
+	CHECK(desc.PositionProperty == 3);
+	CHECK(desc.SetPositionProperty("Motion"));
+	CHECK(desc.PositionProperty == 4);
+}
@@ -0,0 +1,329 @@
+//  Copyright (c) 2020 Jeffery Myers
+//
+//	EntityNetwork and its associated sub proejcts are free software;
+//
+//	Permission is hereby granted, free of charge, to any person obtaining a copy
+//	of this software and associated documentation files (the "Software"), to deal
+//	in the Software without restriction, including without limitation the rights
+//	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//	copies of the Software, and to permit persons to whom the Software is
+//	furnished to do so, subject to the following conditions:
+//	
+//	The above copyright notice and this permission notice shall be included in all
+//	copies or substantial portions of the Software.
+//	
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//	SOFTWARE.
+
+// interest policies and the spatial indexes they find the entities near a peer's avatar with
+
+#include <algorithm>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+#include "EntityNetwork.h"
+#include "server/GridInterest.h"
+#include "server/SpatialTree.h"
+#include "TestTools.h"
+
+using namespace EntityNetwork;
+using namespace EntityNetwork::Server;
+
+template<int Dimensions>
+static std::vector<int64_t> TreeQuery(const SpatialTree<Dimensions>& tree, const typename SpatialTree<Dimensions>::Point& center, float radius)
+{
+	std::vector<int64_t> ids;
+	tree.Query(center, radius, [&ids](int64_t id) { ids.push_back(id); });
+	std::sort(ids.begin(), ids.end());
+	return ids;
+}
+
+template<int Dimensions>
+static std::vector<int64_t> ScanQuery(const std::unordered_map<int64_t, typename SpatialTree<Dimensions>::Point>& points, const typename SpatialTree<Dimensions>::Point& center, float radius)
+{
+	std::vector<int64_t> ids;
+	for (auto& point : points)
+	{
+		if (SpatialTree<Dimensions>::DistanceSq(point.second, center) <= radius * radius)
+			ids.push_back(point.first);
+	}
+	std::sort(ids.begin(), ids.end());
+	return ids;
+}
+
+// inserts, moves and erases random points, some far outside the root, checking every query against a scan of all points
+template<int Dimensions>
+static bool MatchesScan(unsigned int seed)
+{
+	typedef typename SpatialTree<Dimensions>::Point Point;
+
+	std::mt19937 random(seed);
+	std::uniform_real_distribution<float> nearby(-200, 200);
+	std::uniform_real_distribution<float> far(-20000, 20000);
+	std::uniform_real_distribution<float> radii(1, 300);
+
+	auto randomPoint = [&](bool distant)
+	{
+		Point point;
+		for (int i = 0; i < Dimensions; i++)
+			point[i] = distant ? far(random) : nearby(random);
+		return point;
+	};
+
+	SpatialTree<Dimensions> tree;
+	tree.LeafCapacity = 4;
+	tree.InitialSize = 64;
+	std::unordered_map<int64_t, Point> points;
+
+	auto matches = [&]()
+	{
+		if (tree.Size() != points.size())
+			return false;
+
+		for (int q = 0; q < 40; q++)
+		{
+			Point center = points.empty() || q % 2 == 0 ? randomPoint(q % 8 == 0) : points.begin()->second;
+			float radius = q % 8 == 0 ? 30000 : radii(random);
+			if (TreeQuery(tree, center, radius) != ScanQuery<Dimensions>(points, center, radius))
+				return false;
+		}
+		return true;
+	};
+
+	for (int64_t id = 0; id < 600; id++)
+	{
+		Point point = randomPoint(id % 10 == 0);
+		tree.Insert(id, point);
+		points[id] = point;
+	}
+	if (!matches())
+		return false;
+
+	// small moves mostly stay in their leaf, large ones cross the tree
+	for (int64_t id = 0; id < 600; id += 2)
+	{
+		Point point = points[id];
+		if (id % 6 == 0)
+			point = randomPoint(id % 12 == 0);
+		else
+		{
+			for (int i = 0; i < Dimensions; i++)
+				point[i] += nearby(random) / 100;
+		}
+		tree.Move(id, point);
+		points[id] = point;
+	}
+	if (!matches())
+		return false;
+
+	for (int64_t id = 0; id < 600; id++)
+	{
+		if (id % 3 != 0)
+		{
+			tree.Erase(id);
+			points.erase(id);
+		}
+	}
+	if (!matches())
+		return false;
+
+	for (auto& point : points)
+		tree.Erase(point.first);
+	points.clear();
+	return matches() && tree.LeafCount() == 1;
+}
+
+TEST(SpatialTreeMatchesScan)
+{
+	CHECK(MatchesScan<2>(7));
+	CHECK(MatchesScan<2>(19));
+	CHECK(MatchesScan<3>(7));
+	CHECK(MatchesScan<3>(19));
+}
+
+// a leaf splits once it holds more than LeafCapacity items and merges back when its siblings empty out
+TEST(SpatialTreeSplitsAndMerges)
+{
+	SpatialTree<2> tree;
+	tree.LeafCapacity = 4;
+	tree.InitialSize = 100;
+
+	// the root is centered on the first point, the others go in the other quarters
+	tree.Insert(0, { 0, 0 });
+	tree.Insert(1, { -20, -20 });
+	tree.Insert(2, { 20, -20 });
+	tree.Insert(3, { -20, 20 });
+	CHECK(tree.LeafCount() == 1);
+
+	tree.Insert(4, { 25, 25 });
+	CHECK(tree.LeafCount() == 4);
+	CHECK(TreeQuery(tree, { 22, 22 }, 5) == std::vector<int64_t>({ 4 }));
+	CHECK(TreeQuery(tree, { 0, 0 }, 40) == std::vector<int64_t>({ 0, 1, 2, 3, 4 }));
+
+	// moving across leaves updates the index, the old spot no longer finds it
+	tree.Move(4, { -25, -25 });
+	CHECK(TreeQuery(tree, { 22, 22 }, 5).empty());
+	CHECK(TreeQuery(tree, { -22, -22 }, 5) == std::vector<int64_t>({ 1, 4 }));
+
+	// within a leaf only the point changes
+	tree.Move(4, { -30, -30 });
+	CHECK(TreeQuery(tree, { -30, -30 }, 1) == std::vector<int64_t>({ 4 }));
+	CHECK(tree.LeafCount() == 4);
+
+	// Insert of a known ID moves it
+	tree.Insert(4, { 30, -30 });
+	CHECK(tree.Size() == 5);
+	CHECK(TreeQuery(tree, { 30, -30 }, 1) == std::vector<int64_t>({ 4 }));
+
+	tree.Erase(4);
+	tree.Erase(3);
+	CHECK(tree.LeafCount() == 4);
+	tree.Erase(2);
+	CHECK(tree.LeafCount() == 1);
+	CHECK(tree.Size() == 2);
+	CHECK(TreeQuery(tree, { 0, 0 }, 100) == std::vector<int64_t>({ 0, 1 }));
+
+	tree.Erase(99);
+	CHECK(tree.Size() == 2);
+}
+
+// points outside the root double it toward them, nested splits merge back up the chain
+TEST(SpatialTreeGrowsAndMergesUp)
+{
+	SpatialTree<2> tree;
+	tree.LeafCapacity = 2;
+	tree.InitialSize = 10;
+
+	tree.Insert(0, { 0, 0 });
+	tree.Insert(1, { 1000, -1000 });
+	CHECK(tree.LeafCount() > 1);
+	CHECK(TreeQuery(tree, { 1000, -1000 }, 1) == std::vector<int64_t>({ 1 }));
+	CHECK(TreeQuery(tree, { 0, 0 }, 1) == std::vector<int64_t>({ 0 }));
+	CHECK(TreeQuery(tree, { 500, -500 }, 800) == std::vector<int64_t>({ 0, 1 }));
+
+	// a tight cluster splits several levels deep
+	size_t before = tree.LeafCount();
+	tree.Insert(2, { 1, 1 });
+	tree.Insert(3, { 1.5f, 1 });
+	tree.Insert(4, { 1, 1.5f });
+	CHECK(tree.LeafCount() > before + 3);
+	CHECK(TreeQuery(tree, { 1, 1 }, 0.6f) == std::vector<int64_t>({ 2, 3, 4 }));
+
+	// merges run all the way up and fold the empty nodes the grow made too, only the root's split stays
+	tree.Erase(4);
+	tree.Erase(3);
+	CHECK(tree.LeafCount() > before);
+	tree.Erase(2);
+	CHECK(tree.LeafCount() == 4);
+	CHECK(TreeQuery(tree, { 500, -500 }, 800) == std::vector<int64_t>({ 0, 1 }));
+
+	tree.Erase(1);
+	tree.Erase(0);
+	CHECK(tree.Size() == 0);
+	CHECK(tree.LeafCount() == 1);
+	CHECK(TreeQuery(tree, { 0, 0 }, 100000).empty());
+}
+
+// leaves at MinNodeSize keep every item instead of splitting forever, points that are not finite are ignored
+TEST(SpatialTreeStopsAtMinNodeSize)
+{
+	SpatialTree<3> tree;
+	tree.LeafCapacity = 2;
+	tree.InitialSize = 16;
+
+	for (int64_t id = 0; id < 20; id++)
+		tree.Insert(id, { 3, 3, 3 });
+	CHECK(tree.Size() == 20);
+	CHECK(TreeQuery(tree, { 3, 3, 3 }, 0).size() == 20);
+
+	tree.Insert(20, { std::nanf(""), 0, 0 });
+	tree.Insert(21, { 0, INFINITY, 0 });
+	CHECK(tree.Size() == 20);
+
+	tree.Clear();
+	CHECK(tree.Size() == 0);
+	CHECK(tree.LeafCount() == 0);
+	CHECK(TreeQuery(tree, { 3, 3, 3 }, 10).empty());
+}
+
+// an avatar at a position, with the snapshot the policy reads it from
+class AvatarView
+{
+public:
+	EntityDesc::Ptr Desc = EntityDesc::Make();
+	EntityInstance::Ptr Avatar;
+	ServerEntityController Peer { 5 };
+	WorldSnapshot Snapshot;
+
+	AvatarView()
+	{
+		Desc->IsAvatar = true;
+		Desc->AddPropertyDesc("Position", PropertyDesc::DataTypes::Vector3F);
+		Desc->SetPositionProperty("Position");
+		Avatar = EntityInstance::Make(Desc);
+		Avatar->SetID(1);
+		Avatar->OwnerID = Peer.GetID();
+	}
+
+	// adds the avatar to the policy, true when the peer's first sync with it looks for entities around it
+	bool Add(SpatialInterest& policy, float x, float y, float z)
+	{
+		Place(x, y, z);
+		policy.EntityAdded(*Snapshot.Find(Avatar->ID));
+		return policy.UpdatePeer(Peer, Snapshot);
+	}
+
+	// moves the avatar and returns whether the policy looks for entities around it again
+	bool MoveTo(SpatialInterest& policy, float x, float y, float z)
+	{
+		Place(x, y, z);
+		policy.EntityMoved(*Snapshot.Find(Avatar->ID));
+		return policy.UpdatePeer(Peer, Snapshot);
+	}
+
+private:
+	void Place(float x, float y, float z)
+	{
+		float position[3] = { x, y, z };
+		Avatar->Properties[0]->SetValue3F(position);
+		Snapshot.Set(EntitySnapshot::Make(*Avatar));
+	}
+};
+
+// tree policies look again once the avatar has moved half the gap between the radii from where they last looked, however small the steps
+TEST(TreeInterestViewThreshold)
+{
+	auto policy = QuadtreeInterest::Make(100, 150);
+	AvatarView view;
+	CHECK(view.Add(*policy, 0, 0, 0));
+	CHECK(!view.MoveTo(*policy, 10, 0, 0));
+	CHECK(!view.MoveTo(*policy, 20, 0, 0));
+	CHECK(view.MoveTo(*policy, 30, 0, 0));
+	CHECK(!view.MoveTo(*policy, 30, 20, 0));
+	CHECK(!view.MoveTo(*policy, 30, 20, 1000));	// the quadtree ignores height
+	CHECK(view.MoveTo(*policy, 30, 30, 0));
+
+	// no gap between the radii, every step looks again
+	policy->LeaveRadius = policy->EnterRadius;
+	CHECK(view.MoveTo(*policy, 31, 30, 0));
+	CHECK(!view.MoveTo(*policy, 31, 30, 0));
+}
+
+// the grid looks again whenever the avatar crosses into another cell
+TEST(GridInterestViewChangesByCell)
+{
+	auto policy = GridInterest::Make(50, 100, 150);
+	AvatarView view;
+	CHECK(view.Add(*policy, 5, 5, 5));
+	CHECK(!view.MoveTo(*policy, 25, 5, 5));
+	CHECK(!view.MoveTo(*policy, 45, 5, 5));
+	CHECK(view.MoveTo(*policy, 55, 5, 5));
+	CHECK(!view.MoveTo(*policy, 60, 5, 5));
+	CHECK(view.MoveTo(*policy, 45, 5, 5));
+}
@@ -0,0 +1,100 @@
+//  Copyright (c) 2020 Jeffery Myers
+//
+//	EntityNetwork and its associated sub proejcts are free software;
+//
+//	Permission is hereby granted, free of charge, to any person obtaining a copy
+//	of this software and associated documentation files (the "Software"), to deal
+//	in the Software without restriction, including without limitation the rights
+//	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//	copies of the Software, and to permit persons to whom the Software is
+//	furnished to do so, subject to the following conditions:
+//	
+//	The above copyright notice and this permission notice shall be included in all
+//	copies or substantial portions of the Software.
+//	
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//	SOFTWARE.
+#pragma once
+
+// a server and its clients connected in process. Packets are copied across the way a transport would deliver them,
+// Lose and LoseInbound pick the ones that never arrive
+
+#include <functional>
+#include <map>
+#include <memory>
+
+#include "EntityNetwork.h"
+
+namespace UnitTests
+{
+	class Loopback
+	{
+	public:
+		EntityNetwork::Server::ServerWorld Server;
+		std::map<int64_t, EntityNetwork::Server::ServerEntityController::Ptr> Peers;
+		std::map<int64_t, std::shared_ptr<EntityNetwork::Client::ClientWorld>> Clients;
+
+		// returns true to drop a packet the server sent to the peer
+		std::function<bool(int64_t peer, const EntityNetwork::MessageBuffer& packet, EntityNetwork::Reliability reliability)> Lose;
+
+		// returns true to drop a packet the peer's client sent to the server
+		std::function<bool(int64_t peer, const EntityNetwork::MessageBuffer& packet, EntityNetwork::Reliability reliability)> LoseInbound;
+
+		inline EntityNetwork::Client::ClientWorld& Connect(int64_t id)
+		{
+			Peers[id] = Server.AddRemoteController(id);
+			auto& client = Clients[id];
+			client = std::make_shared<EntityNetwork::Client::ClientWorld>();
+			return *client;
+		}
+
+		// a server update, then each client reads what it was sent and answers
+		inline void Pump(int updates = 1)
+		{
+			for (int i = 0; i < updates; i++)
+			{
+				Server.Update();
+				for (auto& client : Clients)
+				{
+					for (size_t r = 0; r < EntityNetwork::ReliabilityClasses; r++)
+					{
+						auto reliability = static_cast<EntityNetwork::Reliability>(r);
+						for (auto packet = Server.PopOutboundData(client.first, reliability); packet != nullptr; packet = Server.PopOutboundData(client.first, reliability))
+						{
+							if (Lose == nullptr || !Lose(client.first, *packet, reliability))
+								client.second->AddInboundData(Copy(*packet));
+						}
+					}
+
+					client.second->Update();
+					for (size_t r = 0; r < EntityNetwork::ReliabilityClasses; r++)
+					{
+						auto reliability = static_cast<EntityNetwork::Reliability>(r);
+						for (auto packet = client.second->PopOutboundData(reliability); packet != nullptr; packet = client.second->PopOutboundData(reliability))
+						{
+							if (LoseInbound == nullptr || !LoseInbound(client.first, *packet, reliability))
+								Server.AddInboundData(client.first, Copy(*packet));
+						}
+					}
+				}
+			}
+		}
+
+		static inline EntityNetwork::MessageBuffer::Ptr Copy(const EntityNetwork::MessageBuffer& packet)
+		{
+			return EntityNetwork::MessageBuffer::MakeShared(packet.MessageData, packet.MessageLenght);
+		}
+
+		// the message code of a packet, Batch for several messages packed together
+		static inline EntityNetwork::MessageCodes CommandOf(const EntityNetwork::MessageBuffer& packet, const EntityNetwork::WireFormat& format)
+		{
+			EntityNetwork::MessageBufferReader reader(Copy(packet), format);
+			return reader.Command;
+		}
+	};
+}
@@ -0,0 +1,697 @@
+//  Copyright (c) 2020 Jeffery Myers
+//
+//	EntityNetwork and its associated sub proejcts are free software;
+//
+//	Permission is hereby granted, free of charge, to any person obtaining a copy
+//	of this software and associated documentation files (the "Software"), to deal
+//	in the Software without restriction, including without limitation the rights
+//	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//	copies of the Software, and to permit persons to whom the Software is
+//	furnished to do so, subject to the following conditions:
+//	
+//	The above copyright notice and this permission notice shall be included in all
+//	copies or substantial portions of the Software.
+//	
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//	SOFTWARE.
+
+// the server to client replication loop: parallel peer syncs, byte budgets, sync acks and resends of lost updates
+
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "EntityNetwork.h"
+#include "server/GridInterest.h"
+#include "Loopback.h"
+#include "TestTools.h"
+
+using namespace EntityNetwork;
+using namespace EntityNetwork::Server;
+using namespace EntityNetwork::Client;
+using namespace UnitTests;
+
+// avatar tanks with a position state, sent unreliably, and a health value sent in order. All pushed by the server
+static void RegisterTank(ServerWorld& server)
+{
+	EntityDesc::Ptr tank = EntityDesc::Make();
+	tank->Name = "Tank";
+	tank->IsAvatar = true;
+
+	auto position = PropertyDesc::Make();
+	position->Name = "Position";
+	position->DataType = PropertyDesc::DataTypes::StateV3F;
+	position->Scope = PropertyDesc::Scopes::ServerPushSync;
+	tank->AddPropertyDesc(position);
+
+	auto health = PropertyDesc::Make();
+	health->Name = "Health";
+	health->DataType = PropertyDesc::DataTypes::Integer;
+	health->Scope = PropertyDesc::Scopes::ServerPushSync;
+	tank->AddPropertyDesc(health);
+
+	tank->SetPositionProperty("Position");
+	server.RegisterEntityDesc(tank);
+}
+
+static void SetPosition(EntityInstance::Ptr tank, float x, float y, uint64_t step)
+{
+	StateUpdatePos state;
+	state.Step = step;
+	state.Postion[0] = x;
+	state.Postion[1] = y;
+	tank->FindProperty("Position")->SetValueStateUpdatePos(state);
+}
+
+static float PositionX(EntityInstance::Ptr tank)
+{
+	return tank->FindProperty("Position")->GetValueStateUpdatePos().Postion[0];
+}
+
+static int64_t CreateTank(ServerWorld& server, int64_t owner, float x, float y)
+{
+	return server.CreateInstance("Tank", owner, [x, y](EntityInstance::Ptr tank)
+		{
+			SetPosition(tank, x, y, 0);
+			tank->FindProperty("Health")->SetValueI(100);
+		});
+}
+
+// true when the client has exactly the entities in ids, with the server's values
+static bool SameEntities(ServerWorld& server, ClientWorld& client, const std::vector<int64_t>& ids)
+{
+	if (client.EntityInstances.Size() != ids.size())
+		return false;
+
+	for (int64_t id : ids)
+	{
+		auto serverEntity = server.EntityInstances.Find(id);
+		auto clientEntity = client.EntityInstances.Find(id);
+		if (serverEntity == nullptr || clientEntity == nullptr)
+			return false;
+
+		for (const char* name : { "Position", "Health" })
+		{
+			auto a = (*serverEntity)->FindProperty(name);
+			auto b = (*clientEntity)->FindProperty(name);
+			if (a == nullptr || b == nullptr || a->DataLenght != b->DataLenght || memcmp(a->DataPtr, b->DataPtr, a->DataLenght) != 0)
+				return false;
+		}
+	}
+	return true;
+}
+
+static void MoveTanks(ServerWorld& server, const std::vector<int64_t>& tanks, int step)
+{
+	for (size_t i = 0; i < tanks.size(); i += 3)
+	{
+		auto tank = server.EntityInstances.Find(tanks[i]);
+		SetPosition(*tank, float((i * 37 + step * 11) % 400), float((i * 53 + step * 7) % 400), step);
+		(*tank)->FindProperty("Health")->SetValueI(100 - step);
+	}
+}
+
+// a client hailed by a build with another PROTOCOL_HEADER reports it and reads nothing more from that server
+TEST(ProtocolMismatchStopsClient)
+{
+	Loopback loop;
+	RegisterTank(loop.Server);
+	CreateTank(loop.Server, -1, 0, 0);
+	ClientWorld& client = loop.Connect(1);
+
+	int mismatches = 0;
+	client.StateEvents.Subscribe(ClientWorld::StateEventTypes::ProtocolMismatch, [&mismatches](ClientWorld::StateEventTypes) { mismatches++; });
+
+	MessageBufferBuilder hail(MessageCodes::HailCheck);
+	hail.AddString("ENT_NET_V00");
+	hail.AddByte(loop.Server.Wire.ToFlags());
+	client.AddInboundData(hail.Pack());
+	loop.Pump(3);
+
+	CHECK(mismatches == 1);
+	CHECK(client.CurrentState == ClientWorld::StateEventTypes::ProtocolMismatch);
+	CHECK(client.Self == nullptr);
+	CHECK(client.EntityInstances.Size() == 0);
+}
+
+// peers synced on a worker pool end up with the same entities as peers synced one after another.
+// build with SANITIZE=thread to check the pool for races
+TEST(ParallelReplicationMatchesSerial)
+{
+	const int peerCount = 8;
+	Loopback serial;
+	Loopback parallel;
+	parallel.Server.ReplicationWorkers = WorkerPool::Make(4);
+
+	std::vector<int64_t> tanks;
+	for (Loopback* loop : { &serial, &parallel })
+	{
+		RegisterTank(loop->Server);
+		loop->Server.Interest = GridInterest::Make(50, 100, 150);
+		for (int peer = 1; peer <= peerCount; peer++)
+			loop->Connect(peer);
+
+		tanks.clear();
+		for (int peer = 1; peer <= peerCount; peer++)
+			tanks.push_back(CreateTank(loop->Server, peer, float(peer * 50), 0));
+		for (int i = 0; i < 64; i++)
+			tanks.push_back(CreateTank(loop->Server, -1, float((i % 8) * 50), float((i / 8) * 50)));
+	}
+
+	for (int step = 0; step < 20; step++)
+	{
+		MoveTanks(serial.Server, tanks, step);
+		MoveTanks(parallel.Server, tanks, step);
+		serial.Pump();
+		parallel.Pump();
+	}
+	serial.Pump(2);
+	parallel.Pump(2);
+
+	for (int peer = 1; peer <= peerCount; peer++)
+	{
+		std::vector<int64_t> ids;
+		serial.Clients[peer]->EntityInstances.DoForEach([&ids](int64_t& id, EntityInstance::Ptr&) { ids.push_back(id); });
+		CHECK(!ids.empty());
+		CHECK(ids.size() < tanks.size());	// the interest policy has to leave some out for this to test anything
+		CHECK(SameEntities(serial.Server, *serial.Clients[peer], ids));
+		CHECK(SameEntities(parallel.Server, *parallel.Clients[peer], ids));
+	}
+}
+
+// resends made while a peer has no byte budget are not charged to one set later
+TEST(BudgetStartsFromZero)
+{
+	Loopback loop;
+	loop.Server.MaxBatchSize = 0;
+	RegisterTank(loop.Server);
+	ClientWorld& client = loop.Connect(1);
+
+	std::vector<int64_t> tanks;
+	for (int i = 0; i < 32; i++)
+		tanks.push_back(CreateTank(loop.Server, -1, float(i), 0));
+	loop.Pump(2);
+	CHECK(client.EntityInstances.Size() == tanks.size());
+
+	// each move is lost, the ack of the next sync finds it and the values are resent
+	WireFormat wire = loop.Server.Wire;
+	bool losing = false;
+	loop.Lose = [wire, &losing](int64_t, const MessageBuffer& packet, Reliability) { return losing && Loopback::CommandOf(packet, wire) == MessageCodes::SetEntityStateValues; };
+	for (int step = 1; step <= 30; step++)
+	{
+		MoveTanks(loop.Server, tanks, step);
+		losing = true;
+		loop.Pump();
+		losing = false;
+		loop.Pump();
+	}
+
+	loop.Lose = nullptr;
+	loop.Peers[1]->BytesPerTick = 100;
+	MoveTanks(loop.Server, tanks, 31);
+	loop.Pump();
+
+	int updated = 0;
+	for (size_t i = 0; i < tanks.size(); i += 3)
+	{
+		auto tank = client.EntityInstances.Find(tanks[i]);
+		if (tank != nullptr && (*tank)->FindProperty("Health")->GetValueI() == 100 - 31)
+			updated++;
+	}
+	CHECK(updated > 0);
+}
+
+// a lost update found after the entity left the peer and came back is not resent, the add already had the value
+TEST(LostUpdateBeforeReaddIsIgnored)
+{
+	Loopback loop;
+	loop.Server.MaxBatchSize = 0;
+	loop.Server.Wire.DeltaValues = true;
+	RegisterTank(loop.Server);
+	loop.Server.Interest = GridInterest::Make(50, 100, 150);
+	ClientWorld& client = loop.Connect(1);
+
+	CreateTank(loop.Server, 1, 0, 0);
+	int64_t tank = CreateTank(loop.Server, -1, 50, 0);
+	loop.Pump(2);
+	CHECK(client.EntityInstances.ContainsKey(tank));
+
+	// nothing unreliable arrives while the tank changes, leaves and comes back, so the loss is only found after the add
+	WireFormat wire = loop.Server.Wire;
+	bool losing = true;
+	int updates = 0;
+	loop.Lose = [wire, &losing, &updates](int64_t, const MessageBuffer& packet, Reliability reliability)
+	{
+		if (Loopback::CommandOf(packet, wire) == MessageCodes::SetEntityStateValues)
+			updates++;
+		return losing && reliability == Reliability::UnreliableSequenced;
+	};
+
+	auto entity = *loop.Server.EntityInstances.Find(tank);
+	SetPosition(entity, 60, 0, 1);
+	loop.Pump();
+
+	SetPosition(entity, 500, 0, 2);
+	loop.Pump();
+	CHECK(!client.EntityInstances.ContainsKey(tank));
+
+	SetPosition(entity, 70, 0, 3);
+	loop.Pump();
+	CHECK(client.EntityInstances.ContainsKey(tank));
+
+	losing = false;
+	updates = 0;
+	loop.Pump(3);
+	CHECK(updates == 0);
+
+	auto copy = client.EntityInstances.Find(tank);
+	CHECK(copy != nullptr && PositionX(*copy) == 70);
+}
+
+// a state update sent before the entity left the peer and late enough to arrive after it came back isn't applied to the new copy
+TEST(StaleStateAfterReaddIsIgnored)
+{
+	Loopback loop;
+	loop.Server.MaxBatchSize = 0;
+	RegisterTank(loop.Server);
+	loop.Server.Interest = GridInterest::Make(50, 100, 150);
+	ClientWorld& client = loop.Connect(1);
+
+	CreateTank(loop.Server, 1, 0, 0);
+	int64_t tank = CreateTank(loop.Server, -1, 50, 0);
+	loop.Pump(2);
+	CHECK(client.EntityInstances.ContainsKey(tank));
+
+	// the state updates are held back instead of delivered
+	WireFormat wire = loop.Server.Wire;
+	std::vector<MessageBuffer::Ptr> late;
+	loop.Lose = [wire, &late](int64_t, const MessageBuffer& packet, Reliability)
+	{
+		if (Loopback::CommandOf(packet, wire) != MessageCodes::SetEntityStateValues)
+			return false;
+		late.push_back(Loopback::Copy(packet));
+		return true;
+	};
+
+	auto entity = *loop.Server.EntityInstances.Find(tank);
+	SetPosition(entity, 60, 0, 1);
+	loop.Pump();
+	CHECK(late.size() == 1);
+
+	SetPosition(entity, 500, 0, 2);
+	loop.Pump();
+	CHECK(!client.EntityInstances.ContainsKey(tank));
+
+	SetPosition(entity, 70, 0, 3);
+	loop.Pump();
+	CHECK(client.EntityInstances.ContainsKey(tank));
+
+	client.AddInboundData(late.front());
+	auto copy = client.EntityInstances.Find(tank);
+	CHECK(copy != nullptr && PositionX(*copy) == 70);
+}
+
+// the add goes in order and the state updates unreliably, so none are sent until the client acks the add
+TEST(StateWaitsForAdd)
+{
+	Loopback loop;
+	loop.Server.MaxBatchSize = 0;
+	RegisterTank(loop.Server);
+	ClientWorld& client = loop.Connect(1);
+	loop.Pump(2);
+
+	// the ordered stream stalls, as it would behind a resend
+	WireFormat wire = loop.Server.Wire;
+	bool stalled = true;
+	int updates = 0;
+	std::vector<MessageBuffer::Ptr> stalledPackets;
+	loop.Lose = [wire, &stalled, &updates, &stalledPackets](int64_t, const MessageBuffer& packet, Reliability reliability)
+	{
+		if (Loopback::CommandOf(packet, wire) == MessageCodes::SetEntityStateValues)
+			updates++;
+		if (!stalled || reliability != Reliability::ReliableOrdered)
+			return false;
+		stalledPackets.push_back(Loopback::Copy(packet));
+		return true;
+	};
+
+	int64_t tank = CreateTank(loop.Server, -1, 0, 0);
+	auto entity = *loop.Server.EntityInstances.Find(tank);
+	for (int step = 1; step <= 3; step++)
+	{
+		SetPosition(entity, float(step), 0, step);
+		loop.Pump();
+	}
+	CHECK(updates == 0);
+	CHECK(!client.EntityInstances.ContainsKey(tank));
+
+	stalled = false;
+	for (auto& packet : stalledPackets)
+		client.AddInboundData(packet);
+	for (int step = 4; step <= 6; step++)
+	{
+		SetPosition(entity, float(step), 0, step);
+		loop.Pump();
+	}
+	CHECK(updates > 0);
+	CHECK(SameEntities(loop.Server, client, { tank }));
+}
+
+// with DeltaValues a state delta is built on a value the client acked, so the update after a lost one applies without waiting for the resend
+TEST(StateDeltaFromAckedBaseline)
+{
+	Loopback loop;
+	loop.Server.MaxBatchSize = 0;
+	loop.Server.Wire.DeltaValues = true;
+	RegisterTank(loop.Server);
+	ClientWorld& client = loop.Connect(1);
+	int64_t tank = CreateTank(loop.Server, -1, 0, 0);
+	loop.Pump(2);
+
+	WireFormat wire = loop.Server.Wire;
+	bool losing = false;
+	int deltas = 0;
+	loop.Lose = [wire, &losing, &deltas](int64_t, const MessageBuffer& packet, Reliability)
+	{
+		if (Loopback::CommandOf(packet, wire) != MessageCodes::SetEntityStateValues)
+			return false;
+
+		MessageBufferReader reader(Loopback::Copy(packet), wire);
+		reader.ReadID();
+		reader.ReadID();
+		if ((reader.ReadVarInt() & 1) != 0)
+			deltas++;
+		return losing;
+	};
+
+	auto entity = *loop.Server.EntityInstances.Find(tank);
+	auto copy = *client.EntityInstances.Find(tank);
+	for (uint64_t step = 1; step <= 6; step++)
+	{
+		SetPosition(entity, float(step), 0, step);
+		losing = (step % 2) == 1;
+		loop.Pump();
+		if (!losing)
+			CHECK(PositionX(copy) == float(step));
+	}
+	CHECK(deltas == 6);
+}
+
+static MessageBuffer::Ptr MakeSync(const WireFormat& wire, tick_t tick, int updates)
+{
+	MessageBufferBuilder builder(nullptr, wire);
+	builder.Command = MessageCodes::SyncTick;
+	builder.AddID(static_cast<int64_t>(tick));
+	builder.AddInt(updates);
+	return builder.Pack();
+}
+
+static MessageBuffer::Ptr MakeAck(const WireFormat& wire, tick_t tick, uint32_t bits, uint32_t adds)
+{
+	MessageBufferBuilder builder(nullptr, wire);
+	builder.Command = MessageCodes::Ack;
+	builder.AddID(static_cast<int64_t>(tick));
+	builder.AddInt(static_cast<int>(bits));
+	builder.AddInt(static_cast<int>(adds));
+	return builder.Pack();
+}
+
+// reads the tick and the count or bits of a SyncTick or Ack
+static void ReadTickPair(const MessageBuffer& packet, const WireFormat& wire, tick_t& tick, uint32_t& value)
+{
+	MessageBufferReader reader(Loopback::Copy(packet), wire);
+	tick = static_cast<tick_t>(reader.ReadID());
+	value = static_cast<uint32_t>(reader.ReadInt());
+}
+
+// the history of received syncs a client acks with, across gaps of exactly 32 ticks and more
+TEST(ClientAckBits)
+{
+	Loopback loop;
+	ClientWorld& client = loop.Connect(1);
+	client.MaxBatchSize = 0;
+	loop.Pump(2);
+
+	class Step
+	{
+	public:
+		tick_t Sync;
+		int Updates;
+		bool Acked;
+		tick_t Tick;
+		uint32_t Bits;
+	};
+	static const Step steps[] =
+	{
+		{ 1000, 0, true, 1000, 0 },				// the first sync has no history
+		{ 1001, 0, true, 1001, 0x1 },
+		{ 1033, 0, true, 1033, 0x80000000 },	// 32 later the previous sync is the top bit
+		{ 1034, 0, true, 1034, 0x1 },
+		{ 1100, 0, true, 1100, 0 },				// more than 32 later nothing is left
+		{ 1099, 0, true, 1100, 0x1 },			// late syncs set their bit
+		{ 1068, 0, true, 1100, 0x80000001 },	// 32 back is the last bit
+		{ 1067, 0, true, 1100, 0x80000001 },	// past the history
+		{ 1101, 1, false, 0, 0 },				// the update of this sync never came
+		{ 1102, 0, true, 1102, 0x6 },			// and it is missing from the history
+	};
+
+	for (auto& step : steps)
+	{
+		client.AddInboundData(MakeSync(client.Wire, step.Sync, step.Updates));
+		client.Update();
+
+		bool acked = false;
+		tick_t tick = 0;
+		uint32_t bits = 0;
+		for (auto packet = client.PopOutboundData(); packet != nullptr; packet = client.PopOutboundData())
+		{
+			if (Loopback::CommandOf(*packet, client.Wire) == MessageCodes::Ack)
+			{
+				acked = true;
+				ReadTickPair(*packet, client.Wire, tick, bits);
+			}
+		}
+
+		CHECK(acked == step.Acked);
+		if (acked && step.Acked)
+		{
+			CHECK(tick == step.Tick);
+			CHECK(bits == step.Bits);
+		}
+	}
+}
+
+// the server's reading of an ack: a sync is received when it is the acked one or its bit is set, and lost past 32 ticks
+TEST(ServerAckAges)
+{
+	Loopback loop;
+	loop.Server.MaxBatchSize = 0;
+	RegisterTank(loop.Server);
+	loop.Connect(1);
+	int64_t tank = CreateTank(loop.Server, -1, 0, 0);
+	loop.Pump(2);
+
+	// the client's own acks are dropped, the test sends the ones it wants
+	WireFormat wire = loop.Server.Wire;
+	int updates = 0;
+	tick_t updateTick = 0;
+	tick_t lastSync = 0;
+	loop.LoseInbound = [wire](int64_t, const MessageBuffer& packet, Reliability) { return Loopback::CommandOf(packet, wire) == MessageCodes::Ack; };
+	loop.Lose = [wire, &updates, &updateTick, &lastSync](int64_t, const MessageBuffer& packet, Reliability)
+	{
+		MessageCodes command = Loopback::CommandOf(packet, wire);
+		if (command == MessageCodes::SetEntityStateValues)
+			updates++;
+		else if (command == MessageCodes::SyncTick)
+		{
+			uint32_t count = 0;
+			ReadTickPair(packet, wire, lastSync, count);
+			if (count > 0)
+				updateTick = lastSync;
+		}
+		return false;
+	};
+
+	class Case
+	{
+	public:
+		tick_t Age;
+		uint32_t Bits;
+		bool Resent;
+	};
+	static const Case cases[] =
+	{
+		{ 0, 0, false },
+		{ 5, 1u << 4, false },
+		{ 5, ~(1u << 4), true },
+		{ 32, 1u << 31, false },
+		{ 32, ~(1u << 31), true },
+		{ 33, 0xFFFFFFFF, true },
+	};
+
+	auto entity = *loop.Server.EntityInstances.Find(tank);
+	uint64_t step = 0;
+	for (auto& test : cases)
+	{
+		updates = 0;
+		step++;
+		SetPosition(entity, float(step), 0, step);
+		loop.Pump();
+		CHECK(updates == 1);
+
+		loop.Pump(40);
+		CHECK(updates == 1);
+
+		updates = 0;
+		loop.Server.AddInboundData(1, MakeAck(wire, updateTick + test.Age, test.Bits, 1));
+		loop.Pump(3);
+		CHECK((updates == 1) == test.Resent);
+		CHECK(updates <= 1);
+
+		// everything sent so far arrived
+		loop.Server.AddInboundData(1, MakeAck(wire, lastSync, 0xFFFFFFFF, 1));
+		loop.Pump();
+	}
+
+	updates = 0;
+	loop.Pump(70);
+	CHECK(updates == 0);
+}
+
+// a peer that stops acking has its oldest updates treated as lost after MaxUnackedTicks, even when nothing else changes
+TEST(UnackedUpdatesAreEvicted)
+{
+	Loopback loop;
+	loop.Server.MaxBatchSize = 0;
+	RegisterTank(loop.Server);
+	ClientWorld& client = loop.Connect(1);
+	int64_t tank = CreateTank(loop.Server, -1, 0, 0);
+	loop.Pump(2);
+
+	// one acked update, so the server knows the peer acks
+	auto entity = *loop.Server.EntityInstances.Find(tank);
+	SetPosition(entity, 1, 0, 1);
+	loop.Pump(2);
+
+	WireFormat wire = loop.Server.Wire;
+	bool losing = true;
+	int updates = 0;
+	loop.Lose = [wire, &losing, &updates](int64_t, const MessageBuffer& packet, Reliability reliability)
+	{
+		if (Loopback::CommandOf(packet, wire) == MessageCodes::SetEntityStateValues)
+			updates++;
+		return losing && reliability == Reliability::UnreliableSequenced;
+	};
+
+	SetPosition(entity, 2, 0, 2);
+	int resentAt = 0;
+	for (int pump = 1; pump <= 80 && resentAt == 0; pump++)
+	{
+		loop.Pump();
+		if (updates > 1)
+			resentAt = pump;
+	}
+	CHECK(resentAt > static_cast<int>(ServerWorld::MaxUnackedTicks));
+	CHECK(resentAt <= static_cast<int>(ServerWorld::MaxUnackedTicks) + 3);
+
+	losing = false;
+	loop.Pump(3);
+	auto copy = client.EntityInstances.Find(tank);
+	CHECK(copy != nullptr && PositionX(*copy) == 2);
+}
+
+// every SyncTick counts exactly the updates sent in its sync, with and without a byte budget
+TEST(SyncTickCountsUpdates)
+{
+	for (int budgeted = 0; budgeted < 2; budgeted++)
+	{
+		Loopback loop;
+		loop.Server.MaxBatchSize = 0;
+		RegisterTank(loop.Server);
+		loop.Connect(1);
+		if (budgeted)
+			loop.Peers[1]->BytesPerTick = 60;
+
+		std::vector<int64_t> tanks;
+		for (int i = 0; i < 24; i++)
+			tanks.push_back(CreateTank(loop.Server, -1, float(i), 0));
+		loop.Pump(2);
+
+		WireFormat wire = loop.Server.Wire;
+		int updates = 0;
+		int mismatches = 0;
+		int syncs = 0;
+		loop.Lose = [wire, &updates, &mismatches, &syncs](int64_t, const MessageBuffer& packet, Reliability)
+		{
+			MessageCodes command = Loopback::CommandOf(packet, wire);
+			if (command == MessageCodes::SetEntityStateValues)
+				updates++;
+			else if (command == MessageCodes::SyncTick)
+			{
+				tick_t tick = 0;
+				uint32_t count = 0;
+				ReadTickPair(packet, wire, tick, count);
+				if (count != static_cast<uint32_t>(updates))
+					mismatches++;
+				if (count > 0)
+					syncs++;
+				updates = 0;
+			}
+			return false;
+		};
+
+		for (int step = 0; step < 40; step++)
+		{
+			MoveTanks(loop.Server, tanks, step);
+			loop.Pump();
+		}
+		loop.Pump(10);
+
+		CHECK(mismatches == 0);
+		CHECK(updates == 0);
+		CHECK(syncs >= (budgeted ? 20 : 40));	// the budget spreads the updates out but sends some every sync
+		CHECK(SameEntities(loop.Server, *loop.Clients[1], tanks));
+	}
+}
+
+// syncs dropped in a fixed pattern, then the client ends up with the server's values, for every wire format
+TEST(LossyReplicationConverges)
+{
+	for (int format = 0; format < 4; format++)
+	{
+		Loopback loop;
+		loop.Server.Wire.DeltaValues = (format & 1) != 0;
+		loop.Server.Wire.BitPackedEntities = (format & 2) != 0;
+		RegisterTank(loop.Server);
+		ClientWorld& client = loop.Connect(1);
+
+		std::vector<int64_t> tanks;
+		for (int i = 0; i < 24; i++)
+			tanks.push_back(CreateTank(loop.Server, -1, float(i), 0));
+		loop.Pump(2);
+
+		// a fixed sequence, so a failure repeats
+		uint32_t random = 12345;
+		bool losing = true;
+		loop.Lose = [&random, &losing](int64_t, const MessageBuffer&, Reliability reliability)
+		{
+			random = random * 1103515245 + 12345;
+			return losing && reliability == Reliability::UnreliableSequenced && ((random >> 16) % 3) == 0;
+		};
+
+		for (int step = 0; step < 100; step++)
+		{
+			MoveTanks(loop.Server, tanks, step);
+			loop.Pump();
+		}
+
+		losing = false;
+		loop.Pump(5);
+		CHECK(SameEntities(loop.Server, client, tanks));
+	}
+}
@@ -0,0 +1,414 @@
+//  Copyright (c) 2020 Jeffery Myers
+//
+//	EntityNetwork and its associated sub proejcts are free software;
+//
+//	Permission is hereby granted, free of charge, to any person obtaining a copy
+//	of this software and associated documentation files (the "Software"), to deal
+//	in the Software without restriction, including without limitation the rights
+//	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//	copies of the Software, and to permit persons to whom the Software is
+//	furnished to do so, subject to the following conditions:
+//	
+//	The above copyright notice and this permission notice shall be included in all
+//	copies or substantial portions of the Software.
+//	
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//	SOFTWARE.
+
+// the stores behind replication: the change journal, the entity pools worlds reuse instances from and the world snapshots peers read
+
+#include <vector>
+
+#include "EntityNetwork.h"
+#include "TestTools.h"
+
+using namespace EntityNetwork;
+using namespace EntityNetwork::Server;
+
+static bool SameRecords(const std::vector<ChangeJournal::Record>& records, const std::vector<std::pair<int64_t, int>>& expected)
+{
+	if (records.size() != expected.size())
+		return false;
+	for (size_t i = 0; i < records.size(); i++)
+	{
+		if (records[i].EntityID != expected[i].first || records[i].PropertyID != expected[i].second)
+			return false;
+	}
+	return true;
+}
+
+// changes come back sorted by entity and property with repeats removed, from the asked for ticks only
+TEST(ChangeJournalCollectSince)
+{
+	ChangeJournal journal;
+	std::vector<ChangeJournal::Record> records;
+
+	journal.Append(9, 0);	// no segment yet, dropped
+	journal.BeginTick(1);
+	journal.Append(5, 2);
+	journal.Append(3, 1);
+	journal.Append(5, 2);
+	journal.Append(3, ChangeJournal::EntityAdded);
+	journal.BeginTick(2);
+	journal.Append(5, 2);
+	journal.Append(7, 0);
+	journal.BeginTick(3);
+	journal.Append(1, ChangeJournal::EntityRemoved);
+
+	journal.CollectSince(0, 3, records);
+	CHECK(SameRecords(records, { { 1, ChangeJournal::EntityRemoved }, { 3, ChangeJournal::EntityAdded }, { 3, 1 }, { 5, 2 }, { 7, 0 } }));
+
+	journal.CollectSince(1, 2, records);
+	CHECK(SameRecords(records, { { 5, 2 }, { 7, 0 } }));
+
+	journal.CollectSince(0, 1, records);
+	CHECK(SameRecords(records, { { 3, ChangeJournal::EntityAdded }, { 3, 1 }, { 5, 2 } }));
+
+	journal.CollectSince(3, 3, records);
+	CHECK(records.empty());
+}
+
+// Release drops only the segments the slowest peer has passed, and recycled segments start empty
+TEST(ChangeJournalRelease)
+{
+	ChangeJournal journal;
+	std::vector<ChangeJournal::Record> records;
+
+	for (tick_t tick = 1; tick <= 4; tick++)
+	{
+		journal.BeginTick(tick);
+		journal.Append(static_cast<int64_t>(tick), 0);
+	}
+	CHECK(journal.SegmentCount() == 4);
+
+	// peers synced to ticks 2 and 3, the slowest still needs everything after 2
+	journal.Release(2);
+	CHECK(journal.SegmentCount() == 2);
+	journal.CollectSince(2, 4, records);
+	CHECK(SameRecords(records, { { 3, 0 }, { 4, 0 } }));
+	journal.CollectSince(0, 4, records);
+	CHECK(SameRecords(records, { { 3, 0 }, { 4, 0 } }));
+
+	// the next ticks reuse the released record storage, none of the old records come back
+	journal.BeginTick(5);
+	journal.BeginTick(6);
+	journal.Append(6, 1);
+	journal.CollectSince(4, 6, records);
+	CHECK(SameRecords(records, { { 6, 1 } }));
+
+	journal.Release(6);
+	CHECK(journal.SegmentCount() == 0);
+	journal.CollectSince(0, 6, records);
+	CHECK(records.empty());
+}
+
+// exposes the world's pool calls the client uses when it creates and removes entities
+class PoolWorld : public World
+{
+public:
+	using World::TakePooledEntity;
+	using World::RecycleEntity;
+};
+
+static EntityDesc::Ptr MakePooledDesc(bool columns)
+{
+	EntityDesc::Ptr desc = EntityDesc::Make();
+	desc->ID = 4;
+	desc->AddPropertyDesc("Health", PropertyDesc::DataTypes::Integer);
+	desc->AddPropertyDesc("Name", PropertyDesc::DataTypes::String);
+	if (columns)
+		desc->UseArchetypeStore();
+	return desc;
+}
+
+// Give refuses instances something else still holds, or a full pool, and clears the pointer when it keeps one
+TEST(EntityPoolGive)
+{
+	EntityDesc::Ptr desc = MakePooledDesc(false);
+	EntityPool::Ptr pool = EntityPool::Make(1);
+
+	EntityInstance::Ptr empty = nullptr;
+	CHECK(!pool->Give(empty));
+
+	EntityInstance::Ptr entity = EntityInstance::Make(desc);
+	EntityInstance::Ptr holder = entity;
+	CHECK(!pool->Give(entity));
+	CHECK(entity != nullptr);
+	holder = nullptr;
+
+	PropertyData::Ptr prop = entity->Properties[0];
+	CHECK(!pool->Give(entity));
+	CHECK(entity != nullptr);
+	prop = nullptr;
+
+	CHECK(pool->Give(entity));
+	CHECK(entity == nullptr);
+	CHECK(pool->Size() == 1);
+
+	EntityInstance::Ptr other = EntityInstance::Make(desc);
+	CHECK(!pool->Give(other));
+	CHECK(other != nullptr);
+	CHECK(pool->Size() == 1);
+}
+
+// a pooled instance comes back with zeroed clean values, no dirty bits and not queued, so its first change queues it again
+TEST(EntityPoolRecycleResets)
+{
+	EntityDesc::Ptr desc = MakePooledDesc(false);
+	EntityPool::Ptr pool = EntityPool::Make(4);
+
+	EntityInstance::Ptr entity = EntityInstance::Make(desc);
+	EntityInstance* raw = entity.get();
+	int queued = 0;
+	entity->ChangeQueued = [&queued](EntityInstance*) { queued++; };
+	entity->SetID(12);
+	entity->OwnerID = 3;
+	entity->Properties[0]->SetValueI(42);
+	entity->Properties[1]->SetValueStr("pooled");
+	CHECK(queued == 1);
+	CHECK(entity->Dirty());
+
+	CHECK(pool->Give(entity));
+	entity = pool->Take();
+	CHECK(entity.get() == raw);
+	CHECK(pool->Size() == 0);
+	CHECK(pool->Take() == nullptr);
+
+	CHECK(entity->ID == EntityInstance::InvalidID);
+	CHECK(entity->OwnerID == EntityInstance::InvalidID);
+	CHECK(entity->ChangeQueued == nullptr);
+	CHECK(!entity->Dirty());
+	CHECK(entity->Properties[0]->GetValueI() == 0);
+	CHECK(entity->Properties[1]->GetValueStr().empty());
+	CHECK(entity->Properties[0]->GetChangeTick() == 0);
+
+	std::vector<int> changed;
+	entity->TakeChangedProperties(changed);
+	CHECK(changed.empty());
+
+	entity->ChangeQueued = [&queued](EntityInstance*) { queued++; };
+	entity->Properties[0]->SetValueI(7);
+	CHECK(queued == 2);
+	entity->TakeChangedProperties(changed);
+	CHECK(changed.size() == 1 && changed[0] == 0);
+}
+
+// pooled instances give their column slot back, and take a fresh zeroed one when they are handed out
+TEST(EntityPoolReattachesStore)
+{
+	EntityDesc::Ptr desc = MakePooledDesc(true);
+	EntityPool::Ptr pool = EntityPool::Make(4);
+
+	EntityInstance::Ptr entity = EntityInstance::Make(desc);
+	EntityInstance::Ptr neighbour = EntityInstance::Make(desc);
+	CHECK(entity->Store == desc->Store);
+	CHECK(desc->Store->LiveCount() == 2);
+	entity->Properties[0]->SetValueI(42);
+	neighbour->Properties[0]->SetValueI(9);
+
+	CHECK(pool->Give(entity));
+	CHECK(desc->Store->LiveCount() == 1);
+
+	// another instance takes the freed slot while this one sits in the pool
+	EntityInstance::Ptr filler = EntityInstance::Make(desc);
+	filler->Properties[0]->SetValueI(5);
+
+	entity = pool->Take();
+	CHECK(entity->Store == desc->Store);
+	CHECK(desc->Store->LiveCount() == 3);
+	CHECK(entity->StoreSlot != filler->StoreSlot && entity->StoreSlot != neighbour->StoreSlot);
+	CHECK(entity->Properties[0]->HasExternalStorage());
+	CHECK(!entity->Properties[1]->HasExternalStorage());
+	CHECK(entity->Properties[0]->GetValueI() == 0);
+
+	entity->Properties[0]->SetValueI(11);
+	CHECK(entity->Properties[0]->DataPtr == desc->Store->GetValue(0, entity->StoreSlot));
+	CHECK(filler->Properties[0]->GetValueI() == 5);
+	CHECK(neighbour->Properties[0]->GetValueI() == 9);
+}
+
+// the world only hands out pooled instances built for the current definition of the type
+TEST(WorldTakePooledEntity)
+{
+	PoolWorld world;
+	EntityDesc::Ptr desc = MakePooledDesc(false);
+
+	EntityInstance::Ptr entity = EntityInstance::Make(desc);
+	EntityInstance* raw = entity.get();
+	world.RecycleEntity(entity);
+	CHECK(entity != nullptr);	// no pool for the type, the instance is left alone
+	CHECK(world.TakePooledEntity(desc) == nullptr);
+
+	world.SetEntityPoolSize(desc->ID, 2);
+	world.RecycleEntity(entity);
+	CHECK(entity == nullptr);
+	CHECK(world.TakePooledEntity(nullptr) == nullptr);
+
+	entity = world.TakePooledEntity(desc);
+	CHECK(entity.get() == raw);
+	CHECK(world.TakePooledEntity(desc) == nullptr);
+
+	// the type is redefined under the same ID, the old instance is dropped rather than handed out
+	world.RecycleEntity(entity);
+	EntityDesc::Ptr redefined = MakePooledDesc(false);
+	CHECK(world.TakePooledEntity(redefined) == nullptr);
+	CHECK(world.TakePooledEntity(desc) == nullptr);
+
+	// 0 turns pooling off
+	entity = EntityInstance::Make(desc);
+	world.SetEntityPoolSize(desc->ID, 0);
+	world.RecycleEntity(entity);
+	CHECK(entity != nullptr);
+}
+
+static EntitySnapshot::Ptr MakeEntitySnapshot(int64_t id, int64_t owner = 0)
+{
+	auto entity = std::make_shared<EntitySnapshot>();
+	entity->ID = id;
+	entity->OwnerID = owner;
+	return entity;
+}
+
+static size_t CountVisited(const WorldSnapshot& snapshot)
+{
+	size_t count = 0;
+	snapshot.DoForEach([&count](const EntitySnapshot::Ptr&) { count++; });
+	return count;
+}
+
+// Set adds or replaces by ID and keeps the count, invalid entities are ignored
+TEST(WorldSnapshotSet)
+{
+	auto snapshot = std::make_shared<WorldSnapshot>();
+	snapshot->Set(nullptr);
+	snapshot->Set(MakeEntitySnapshot(-3));
+	CHECK(snapshot->Size() == 0);
+	CHECK(snapshot->PageCount() == 0);
+
+	auto first = MakeEntitySnapshot(3, 1);
+	snapshot->Set(first);
+	snapshot->Set(MakeEntitySnapshot(17));
+	snapshot->Set(MakeEntitySnapshot(5000));
+	CHECK(snapshot->Size() == 3);
+	CHECK(snapshot->LeafCount() == 3);
+	CHECK(snapshot->PageCount() == 2);
+	CHECK(CountVisited(*snapshot) == 3);
+	CHECK(snapshot->Find(3) == first);
+	CHECK(snapshot->Find(4) == nullptr);
+	CHECK(snapshot->Find(-1) == nullptr);
+	CHECK(snapshot->Find(100000) == nullptr);
+
+	auto replaced = MakeEntitySnapshot(3, 2);
+	snapshot->Set(replaced);
+	CHECK(snapshot->Size() == 3);
+	CHECK(snapshot->Find(3) == replaced);
+}
+
+// Erase keeps the count and drops leaves and pages once their last entity goes
+TEST(WorldSnapshotErasePrunes)
+{
+	auto snapshot = std::make_shared<WorldSnapshot>();
+	for (int64_t id : { 1, 2, 20, 5000 })
+		snapshot->Set(MakeEntitySnapshot(id));
+	CHECK(snapshot->LeafCount() == 3);
+	CHECK(snapshot->PageCount() == 2);
+
+	snapshot->Erase(7);	// never set, nothing changes
+	snapshot->Erase(-1);
+	snapshot->Erase(100000);
+	CHECK(snapshot->Size() == 4);
+
+	snapshot->Erase(1);
+	CHECK(snapshot->Size() == 3);
+	CHECK(snapshot->LeafCount() == 3);
+	snapshot->Erase(1);
+	CHECK(snapshot->Size() == 3);
+
+	snapshot->Erase(2);
+	CHECK(snapshot->Size() == 2);
+	CHECK(snapshot->LeafCount() == 2);
+	CHECK(snapshot->PageCount() == 2);
+	CHECK(snapshot->Find(20) != nullptr);
+
+	snapshot->Erase(5000);
+	CHECK(snapshot->Size() == 1);
+	CHECK(snapshot->LeafCount() == 1);
+	CHECK(snapshot->PageCount() == 1);
+
+	snapshot->Erase(20);
+	CHECK(snapshot->Size() == 0);
+	CHECK(snapshot->PageCount() == 0);
+	CHECK(CountVisited(*snapshot) == 0);
+
+	// pruned leaves and pages come back on the next Set
+	snapshot->Set(MakeEntitySnapshot(2));
+	snapshot->Set(MakeEntitySnapshot(5001));
+	CHECK(snapshot->Size() == 2);
+	CHECK(snapshot->LeafCount() == 2);
+	CHECK(snapshot->Find(2) != nullptr && snapshot->Find(5001) != nullptr);
+}
+
+// writing the next snapshot never shows through in a published one, unchanged entities are shared
+TEST(WorldSnapshotNextCopiesOnWrite)
+{
+	auto first = std::make_shared<WorldSnapshot>();
+	first->Tick = 1;
+	auto a = MakeEntitySnapshot(1);
+	auto b = MakeEntitySnapshot(2);
+	auto c = MakeEntitySnapshot(40);
+	auto d = MakeEntitySnapshot(5000);
+	for (auto& entity : { a, b, c, d })
+		first->Set(entity);
+	WorldSnapshot::Ptr published = first;
+
+	auto second = published->Next(2);
+	CHECK(second->Tick == 2);
+	CHECK(second->Size() == 4);
+
+	auto a2 = MakeEntitySnapshot(1, 7);
+	second->Set(a2);
+	second->Set(MakeEntitySnapshot(3));
+	second->Erase(40);
+	second->Erase(5000);
+
+	CHECK(published->Tick == 1);
+	CHECK(published->Size() == 4);
+	CHECK(published->LeafCount() == 3 && published->PageCount() == 2);
+	CHECK(published->Find(1) == a);
+	CHECK(published->Find(2) == b);
+	CHECK(published->Find(3) == nullptr);
+	CHECK(published->Find(40) == c);
+	CHECK(published->Find(5000) == d);
+	CHECK(CountVisited(*published) == 4);
+
+	CHECK(second->Size() == 3);
+	CHECK(second->Find(1) == a2);
+	CHECK(second->Find(2) == b);
+	CHECK(second->Find(3) != nullptr);
+	CHECK(second->Find(40) == nullptr);
+	CHECK(second->Find(5000) == nullptr);
+	CHECK(second->PageCount() == 1);
+	CHECK(CountVisited(*second) == 3);
+
+	// a third snapshot writes the leaves the second one copied, the second stays as it was published
+	WorldSnapshot::Ptr secondPublished = second;
+	auto third = secondPublished->Next(3);
+	third->Erase(1);
+	third->Erase(2);
+	third->Erase(3);
+	third->Set(MakeEntitySnapshot(40));
+	CHECK(third->Size() == 1);
+	CHECK(third->LeafCount() == 1);
+
+	CHECK(secondPublished->Size() == 3);
+	CHECK(secondPublished->Find(1) == a2);
+	CHECK(secondPublished->Find(2) == b);
+	CHECK(secondPublished->Find(40) == nullptr);
+	CHECK(published->Find(1) == a);
+	CHECK(published->Find(40) == c);
+}
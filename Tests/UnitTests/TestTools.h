@@ -0,0 +1,54 @@
+//  Copyright (c) 2020 Jeffery Myers
+//
+//	EntityNetwork and its associated sub proejcts are free software;
+//
+//	Permission is hereby granted, free of charge, to any person obtaining a copy
+//	of this software and associated documentation files (the "Software"), to deal
+//	in the Software without restriction, including without limitation the rights
+//	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//	copies of the Software, and to permit persons to whom the Software is
+//	furnished to do so, subject to the following conditions:
+//	
+//	The above copyright notice and this permission notice shall be included in all
+//	copies or substantial portions of the Software.
+//	
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//	SOFTWARE.
+#pragma once
+
+// a minimal test runner for the Linux build in this folder. TEST registers a function that main runs,
+// CHECK reports a failed expression and lets the test carry on so one run shows every failure
+
+#include <cstdio>
+#include <functional>
+#include <vector>
+
+namespace UnitTests
+{
+	class TestCase
+	{
+	public:
+		const char* Name = nullptr;
+		std::function<void()> Function;
+	};
+
+	std::vector<TestCase>& Registry();
+	void Fail(const char* file, int line, const char* expression);
+
+	class Registrar
+	{
+	public:
+		Registrar(const char* name, std::function<void()> function)
+		{
+			Registry().push_back(TestCase{ name, function });
+		}
+	};
+}
+
+#define TEST(name) static void name(); static UnitTests::Registrar name##Registrar(#name, name); static void name()
+#define CHECK(expression) do { if (!(expression)) UnitTests::Fail(__FILE__, __LINE__, #expression); } while (false)
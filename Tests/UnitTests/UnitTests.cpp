@@ -0,0 +1,73 @@
+//  Copyright (c) 2020 Jeffery Myers
+//
+//	EntityNetwork and its associated sub proejcts are free software;
+//
+//	Permission is hereby granted, free of charge, to any person obtaining a copy
+//	of this software and associated documentation files (the "Software"), to deal
+//	in the Software without restriction, including without limitation the rights
+//	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//	copies of the Software, and to permit persons to whom the Software is
+//	furnished to do so, subject to the following conditions:
+//	
+//	The above copyright notice and this permission notice shall be included in all
+//	copies or substantial portions of the Software.
+//	
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//	SOFTWARE.
+// unit tests for the wire encodings and the server/client replication loop.
+// build and run on Linux with the Makefile in this folder, the process exits non zero if any check fails.
+// an optional argument only runs the tests whose name contains it
+
+#include <cstring>
+#include <string>
+
+#include "TestTools.h"
+
+namespace UnitTests
+{
+	static int Failures = 0;
+
+	std::vector<TestCase>& Registry()
+	{
+		static std::vector<TestCase> tests;
+		return tests;
+	}
+
+	void Fail(const char* file, int line, const char* expression)
+	{
+		Failures++;
+		printf("  %s:%d: CHECK(%s) failed\n", file, line, expression);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	setvbuf(stdout, nullptr, _IONBF, 0);
+
+	int run = 0;
+	int failed = 0;
+	for (auto& test : UnitTests::Registry())
+	{
+		if (argc > 1 && strstr(test.Name, argv[1]) == nullptr)
+			continue;
+
+		int before = UnitTests::Failures;
+		test.Function();
+		run++;
+		if (UnitTests::Failures != before)
+		{
+			failed++;
+			printf("FAILED %s\n", test.Name);
+		}
+		else
+			printf("ok     %s\n", test.Name);
+	}
+
+	printf("%d of %d tests passed\n", run - failed, run);
+	return failed == 0 ? 0 : 1;
+}
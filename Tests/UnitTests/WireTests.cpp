@@ -0,0 +1,710 @@
+//  Copyright (c) 2020 Jeffery Myers
+//
+//	EntityNetwork and its associated sub proejcts are free software;
+//
+//	Permission is hereby granted, free of charge, to any person obtaining a copy
+//	of this software and associated documentation files (the "Software"), to deal
+//	in the Software without restriction, including without limitation the rights
+//	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+//	copies of the Software, and to permit persons to whom the Software is
+//	furnished to do so, subject to the following conditions:
+//	
+//	The above copyright notice and this permission notice shall be included in all
+//	copies or substantial portions of the Software.
+//	
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+//	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+//	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+//	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+//	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+//	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+//	SOFTWARE.
+// round trips of every wire encoding: varints, bit streams, quantization, batches, schema prefixes and delta values
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "EntityNetwork.h"
+#include "TestTools.h"
+
+using namespace EntityNetwork;
+
+static WireFormat MakeFormat(bool varInts, bool bitPacked = false, bool delta = false)
+{
+	WireFormat format;
+	format.VarInts = varInts;
+	format.BitPackedEntities = bitPacked;
+	format.DeltaValues = delta;
+	return format;
+}
+
+static MessageBufferReader Reread(MessageBufferBuilder& builder, const WireFormat& format)
+{
+	return MessageBufferReader(builder.Pack(), format);
+}
+
+static PropertyData::Ptr MakeProperty(PropertyDesc::DataTypes dataType, int id = 0, size_t bufferSize = 0)
+{
+	PropertyDesc::Ptr desc = PropertyDesc::Make();
+	desc->ID = id;
+	desc->DataType = dataType;
+	desc->BufferSize = bufferSize;
+	return PropertyData::MakeShared(desc);
+}
+
+// a value for every data type that uses the whole range of its components
+static void FillValue(PropertyData& prop, int seed)
+{
+	switch (prop.Descriptor->DataType)
+	{
+	case PropertyDesc::DataTypes::String:
+		prop.SetValueStr("value " + std::to_string(seed));
+		return;
+
+	case PropertyDesc::DataTypes::Buffer:
+	{
+		std::vector<unsigned char> data(37);
+		for (size_t i = 0; i < data.size(); i++)
+			data[i] = static_cast<unsigned char>(i * 13 + seed);
+		prop.SetValueBuffer(data.data(), data.size());
+		return;
+	}
+
+	default:
+		break;
+	}
+
+	static const uint64_t patterns[] = { 0, 1, 0xFFFFFFFFFFFFFFFFull, 0x8000000000000000ull, 0x7FFFFFFFFFFFFFFFull, 0x0123456789ABCDEFull };
+	unsigned char* data = static_cast<unsigned char*>(prop.DataPtr);
+	for (size_t i = 0; i < prop.DataLenght; i++)
+		data[i] = static_cast<unsigned char>(patterns[(i / 8 + seed) % 6] >> ((i % 8) * 8));
+}
+
+static bool SameValue(const PropertyData& a, const PropertyData& b)
+{
+	return a.DataLenght == b.DataLenght && memcmp(a.DataPtr, b.DataPtr, a.DataLenght) == 0;
+}
+
+static const PropertyDesc::DataTypes AllTypes[] =
+{
+	PropertyDesc::DataTypes::Integer, PropertyDesc::DataTypes::Vector3I, PropertyDesc::DataTypes::Vector4I,
+	PropertyDesc::DataTypes::Float, PropertyDesc::DataTypes::Vector3F, PropertyDesc::DataTypes::Vector4F,
+	PropertyDesc::DataTypes::Double, PropertyDesc::DataTypes::Vector3D, PropertyDesc::DataTypes::Vector4D,
+	PropertyDesc::DataTypes::String, PropertyDesc::DataTypes::Buffer,
+	PropertyDesc::DataTypes::StateV3F, PropertyDesc::DataTypes::StateV3FQ4F,
+};
+
+TEST(ZigZagRoundTrip)
+{
+	const int64_t values[] = { 0, 1, -1, 2, -2, 63, -64, 64, -65, INT32_MAX, INT32_MIN, INT64_MAX, INT64_MIN };
+	for (int64_t value : values)
+		CHECK(WireFormat::UnZigZag(WireFormat::ZigZag(value)) == value);
+
+	// small magnitudes of either sign map to small codes
+	CHECK(WireFormat::ZigZag(0) == 0);
+	CHECK(WireFormat::ZigZag(-1) == 1);
+	CHECK(WireFormat::ZigZag(1) == 2);
+	CHECK(WireFormat::ZigZag(INT64_MIN) == UINT64_MAX);
+}
+
+TEST(VarIntRoundTrip)
+{
+	struct Case { uint64_t Value; size_t Bytes; };
+	const Case cases[] = { { 0, 1 }, { 127, 1 }, { 128, 2 }, { 16383, 2 }, { 16384, 3 }, { UINT32_MAX, 5 }, { UINT64_MAX >> 1, 9 }, { UINT64_MAX, 10 } };
+
+	for (auto& c : cases)
+	{
+		MessageBufferBuilder builder(false);
+		builder.AddVarInt(c.Value);
+		CHECK(builder.Data.size() == c.Bytes);
+
+		MessageBufferReader reader(builder.Pack(), false);
+		CHECK(reader.ReadVarInt() == c.Value);
+		CHECK(reader.Done());
+	}
+
+	// a varint cut off in the middle reads as 0 and ends the message
+	MessageBufferBuilder builder(false);
+	builder.AddVarInt(UINT32_MAX);
+	builder.Data.pop_back();
+	MessageBufferReader reader(builder.Pack(), false);
+	CHECK(reader.ReadVarInt() == 0);
+	CHECK(reader.Done());
+}
+
+TEST(PrimitiveRoundTrip)
+{
+	for (int varInts = 0; varInts < 2; varInts++)
+	{
+		WireFormat format = MakeFormat(varInts != 0);
+		MessageBufferBuilder builder(nullptr, format);
+		builder.Command = MessageCodes::SetWorldDataValues;
+
+		const int ints[] = { 0, -1, 1, INT32_MAX, INT32_MIN };
+		const int64_t ids[] = { 0, -1, 1, INT64_MAX, INT64_MIN };
+		for (int value : ints)
+			builder.AddInt(value);
+		for (int64_t value : ids)
+			builder.AddID(value);
+		builder.AddByte(255);
+		builder.AddBool(true);
+		builder.AddFloat(-0.5f);
+		builder.AddString("");
+		builder.AddString(std::string(300, 'x'));
+		char buffer[5] = { 1, 2, 3, 4, 5 };
+		builder.AddBuffer(buffer, sizeof(buffer));
+
+		MessageBufferReader reader = Reread(builder, format);
+		CHECK(reader.Command == MessageCodes::SetWorldDataValues);
+		for (int value : ints)
+			CHECK(reader.ReadInt() == value);
+		for (int64_t value : ids)
+			CHECK(reader.ReadID() == value);
+		CHECK(reader.ReadByte() == 255);
+		CHECK(reader.ReadBool());
+		CHECK(reader.ReadFloat() == -0.5f);
+		CHECK(reader.ReadString().empty());
+		CHECK(reader.ReadString() == std::string(300, 'x'));
+		CHECK(reader.PeakBufferSize() == sizeof(buffer));
+		char read[5] = {};
+		CHECK(reader.ReadBuffer(read));
+		CHECK(memcmp(read, buffer, sizeof(buffer)) == 0);
+		CHECK(reader.Done());
+
+		// reads past the end give defaults instead of reading out of the message
+		CHECK(reader.ReadInt() == 0);
+		CHECK(reader.ReadID() == 0);
+		CHECK(reader.ReadString().empty());
+		CHECK(!reader.ReadBuffer(read));
+	}
+
+	// varints only spend the bytes the value needs
+	MessageBufferBuilder fixed(nullptr, MakeFormat(false), false);
+	MessageBufferBuilder packed(nullptr, MakeFormat(true), false);
+	fixed.AddID(5);
+	packed.AddID(5);
+	CHECK(fixed.Data.size() == 8);
+	CHECK(packed.Data.size() == 1);
+}
+
+TEST(BitStreamRoundTrip)
+{
+	BitStreamWriter writer;
+	for (int bits = 1; bits <= 64; bits++)
+	{
+		uint64_t value = bits == 64 ? UINT64_MAX : (uint64_t(1) << bits) - 1;
+		writer.WriteBits(value, bits);
+		writer.WriteBits(0x5555555555555555ull, bits);
+		writer.WriteBool(bits % 2 == 0);
+	}
+	writer.WriteRangedInt(-5, -5, 10);
+	writer.WriteRangedInt(10, -5, 10);
+	writer.WriteRangedInt(50, -5, 10);	// clamped
+	writer.WriteFloat(-123.25f);
+	writer.WriteDouble(1e300);
+	const char bytes[] = "unaligned";
+	writer.WriteBytes(bytes, sizeof(bytes));
+
+	BitStreamReader reader(writer.Data.data(), writer.ByteSize());
+	for (int bits = 1; bits <= 64; bits++)
+	{
+		uint64_t mask = bits == 64 ? UINT64_MAX : (uint64_t(1) << bits) - 1;
+		CHECK(reader.ReadBits(bits) == mask);
+		CHECK(reader.ReadBits(bits) == (0x5555555555555555ull & mask));
+		CHECK(reader.ReadBool() == (bits % 2 == 0));
+	}
+	CHECK(reader.ReadRangedInt(-5, 10) == -5);
+	CHECK(reader.ReadRangedInt(-5, 10) == 10);
+	CHECK(reader.ReadRangedInt(-5, 10) == 10);
+	CHECK(reader.ReadFloat() == -123.25f);
+	CHECK(reader.ReadDouble() == 1e300);
+	char read[sizeof(bytes)] = {};
+	CHECK(reader.ReadBytes(read, sizeof(read)));
+	CHECK(memcmp(read, bytes, sizeof(bytes)) == 0);
+	CHECK(!reader.Overflow);
+
+	// the padding bits of the last byte read as zero, anything past them overflows
+	while (!reader.Done())
+		CHECK(!reader.ReadBool());
+	CHECK(reader.ReadBits(1) == 0);
+	CHECK(reader.Overflow);
+	CHECK(!reader.ReadBytes(read, 1));
+}
+
+TEST(QuantizeBoundaries)
+{
+	const int widths[] = { 1, 8, 16, 24, 32 };
+	for (int bits : widths)
+	{
+		uint64_t steps = (uint64_t(1) << bits) - 1;
+		CHECK(BitStreamWriter::Quantize(-10, -10, 10, bits) == 0);
+		CHECK(BitStreamWriter::Quantize(10, -10, 10, bits) == steps);
+		CHECK(BitStreamWriter::Quantize(-1e30f, -10, 10, bits) == 0);
+		CHECK(BitStreamWriter::Quantize(1e30f, -10, 10, bits) == steps);
+		CHECK(BitStreamWriter::Quantize(-INFINITY, -10, 10, bits) == 0);
+		CHECK(BitStreamWriter::Quantize(INFINITY, -10, 10, bits) == steps);
+		CHECK(BitStreamWriter::Quantize(NAN, -10, 10, bits) == 0);
+
+		CHECK(BitStreamWriter::Dequantize(0, -10, 10, bits) == -10);
+		CHECK(BitStreamWriter::Dequantize(steps, -10, 10, bits) == 10);
+
+		// anything in range comes back within half a step
+		double halfStep = 20.0 / steps / 2 + 1e-6;
+		for (float value = -10; value <= 10; value += 0.37f)
+			CHECK(std::fabs(BitStreamWriter::Dequantize(BitStreamWriter::Quantize(value, -10, 10, bits), -10, 10, bits) - value) <= halfStep);
+	}
+
+	// an empty range or no bits always sends 0
+	CHECK(BitStreamWriter::Quantize(5, 10, 10, 8) == 0);
+	CHECK(BitStreamWriter::Quantize(5, -10, 10, 0) == 0);
+	CHECK(BitStreamWriter::Dequantize(3, 10, 10, 8) == 10);
+}
+
+TEST(QuantizedPropertyRoundTrip)
+{
+	PropertyData::Ptr source = MakeProperty(PropertyDesc::DataTypes::StateV3FQ4F);
+	source->Descriptor->SetQuantization(-1024, 1024, 20);
+
+	StateUpdatePosRot state;
+	state.Step = 0xFFFFFFFF00000001ull;
+	state.Postion[0] = -1024;
+	state.Postion[1] = 1024;
+	state.Postion[2] = 12.345f;
+	state.Orientation[0] = 0.5f;
+	state.Orientation[1] = -1;
+	state.Orientation[2] = NAN;
+	state.Orientation[3] = 0.8660254f;
+	source->SetValueStateUpdatePosRot(state);
+
+	for (int bitPacked = 0; bitPacked < 2; bitPacked++)
+	{
+		PropertyData::Ptr target = MakeProperty(PropertyDesc::DataTypes::StateV3FQ4F);
+		target->Descriptor->SetQuantization(-1024, 1024, 20);
+
+		if (bitPacked)
+		{
+			BitStreamWriter writer;
+			source->PackBits(writer);
+			CHECK(writer.BitCount == 64 + 7 * 20);
+
+			BitStreamReader reader(writer.Data.data(), writer.ByteSize());
+			target->UnpackBits(reader, true);
+			CHECK(!reader.Overflow);
+		}
+		else
+		{
+			MessageBufferBuilder builder(false);
+			source->PackValue(builder);
+
+			MessageBufferReader reader(builder.Pack(), false);
+			CHECK(reader.ReadByte() == 0);
+			target->UnpackValue(reader, true);
+			CHECK(reader.Done());
+		}
+
+		StateUpdatePosRot read = target->GetValueStateUpdatePosRot();
+		CHECK(read.Step == state.Step);
+		CHECK(read.Postion[0] == -1024);
+		CHECK(read.Postion[1] == 1024);
+		CHECK(std::fabs(read.Postion[2] - 12.345f) < 0.002f);
+		CHECK(std::fabs(read.Orientation[0] - 0.5f) < 0.00001f);
+		CHECK(read.Orientation[1] == -1);
+		CHECK(read.Orientation[2] == -1);	// NaN goes out as the bottom of the range
+		CHECK(std::fabs(read.Orientation[3] - 0.8660254f) < 0.00001f);
+	}
+}
+
+TEST(PropertyValueRoundTrip)
+{
+	for (auto dataType : AllTypes)
+	{
+		for (int varInts = 0; varInts < 2; varInts++)
+		{
+			WireFormat format = MakeFormat(varInts != 0);
+			PropertyData::Ptr source = MakeProperty(dataType, 3, 16);
+			FillValue(*source, varInts);
+
+			MessageBufferBuilder builder(nullptr, format);
+			builder.Command = MessageCodes::SetEntityDataValues;
+			source->PackValue(builder);
+
+			PropertyData::Ptr target = MakeProperty(dataType, 3, 16);
+			MessageBufferReader reader = Reread(builder, format);
+			CHECK(reader.ReadByte() == 3);
+			target->UnpackValue(reader, true);
+			CHECK(reader.Done());
+			CHECK(SameValue(*source, *target));
+			CHECK(target->IsDirty());
+
+			// values that aren't saved are still read past
+			builder.Clear();
+			source->PackValue(builder);
+			source->PackValue(builder);
+			reader = Reread(builder, format);
+			reader.ReadByte();
+			target->UnpackValue(reader, false);
+			CHECK(reader.ReadByte() == 3);
+			target->UnpackValue(reader, true);
+			CHECK(reader.Done());
+		}
+
+		BitStreamWriter writer;
+		PropertyData::Ptr source = MakeProperty(dataType, 0, 16);
+		FillValue(*source, 2);
+		source->PackBits(writer);
+		source->PackBits(writer);
+
+		PropertyData::Ptr target = MakeProperty(dataType, 0, 16);
+		BitStreamReader reader(writer.Data.data(), writer.ByteSize());
+		target->UnpackBits(reader, false);
+		target->UnpackBits(reader, true);
+		CHECK(!reader.Overflow);
+		CHECK(SameValue(*source, *target));
+	}
+}
+
+static MessageBuffer::Ptr MakeMessage(size_t lenght, int seed)
+{
+	MessageBufferBuilder builder(MessageCodes::SetWorldDataValues);
+	for (size_t i = 1; i < lenght; i++)
+		builder.AddByte(static_cast<int>(i + seed));
+	return builder.Pack();
+}
+
+static bool SameMessage(const MessageBuffer::Ptr& a, const MessageBufferReader& b)
+{
+	size_t lenght = b.ReadEnd - b.ReadOffset + 1;
+	const char* data = static_cast<const char*>(b.Message->MessageData) + b.ReadOffset - 1;
+	return a->MessageLenght == lenght && memcmp(a->MessageData, data, lenght) == 0;
+}
+
+// pops everything in the queue and reads the batches back into the messages they were made from
+static std::vector<MessageBufferReader> Unbatch(MutexedMessageBufferDeque& queue, size_t maxSize, size_t& packets)
+{
+	std::vector<MessageBufferReader> messages;
+	packets = 0;
+	for (auto msg = queue.Pop(); msg != nullptr; msg = queue.Pop())
+	{
+		packets++;
+		MessageBufferReader reader(msg);
+		if (reader.Command != MessageCodes::Batch)
+		{
+			messages.push_back(reader);
+			continue;
+		}
+
+		CHECK(msg->MessageLenght <= maxSize);
+		while (!reader.Done())
+		{
+			MessageBufferReader message = reader.ReadBatchedMessage(WireFormat());
+			if (message.Message != nullptr)
+				messages.push_back(message);
+		}
+	}
+	return messages;
+}
+
+TEST(BatchFraming)
+{
+	auto pool = MessageBufferPool::Make();
+	const size_t maxSize = 100;
+
+	// nothing queued, and a single message, are left alone
+	MutexedMessageBufferDeque queue;
+	queue.Coalesce(pool, maxSize);
+	CHECK(queue.Empty());
+
+	MessageBuffer::Ptr single = MakeMessage(10, 0);
+	queue.Push(single);
+	queue.Coalesce(pool, maxSize);
+	CHECK(queue.Size() == 1);
+	CHECK(queue.Pop() == single);
+
+	// messages that fill a batch exactly: the code byte and each frame's one byte length
+	std::vector<MessageBuffer::Ptr> sent;
+	for (int i = 0; i < 3; i++)
+		sent.push_back(MakeMessage(32, i));
+	sent.push_back(MakeMessage(1, 3));			// only its code, doesn't fit the full batch and is held back alone
+	sent.push_back(MakeMessage(maxSize, 4));	// too big to share a packet, goes as is
+	sent.push_back(MakeMessage(maxSize - 2, 5));	// the largest that fits a batch, nothing joins it so it goes as is
+	sent.push_back(MakeMessage(200, 6));		// bigger than a packet, its frame length would take two bytes
+	sent.push_back(MakeMessage(3, 7));
+	sent.push_back(MakeMessage(4, 8));			// batched with the one before
+	for (auto& msg : sent)
+		queue.Push(msg);
+
+	queue.Coalesce(pool, maxSize);
+	size_t packets = 0;
+	std::vector<MessageBufferReader> read = Unbatch(queue, maxSize, packets);
+	CHECK(packets == 6);
+	CHECK(read.size() == sent.size());
+	for (size_t i = 0; i < sent.size() && i < read.size(); i++)
+		CHECK(SameMessage(sent[i], read[i]));
+
+	// a batch sized to the limit (1 + 3 * 33 == 100) holds all three
+	for (int i = 0; i < 3; i++)
+		queue.Push(MakeMessage(32, i));
+	queue.Coalesce(pool, maxSize);
+	CHECK(queue.Size() == 1);
+	CHECK(queue.Pop()->MessageLenght == maxSize);
+
+	// the HailCheck goes on its own, ahead of the batch that follows it
+	MessageBufferBuilder hail(MessageCodes::HailCheck);
+	hail.AddString(PROTOCOL_HEADER);
+	hail.AddByte(0);
+	MessageBuffer::Ptr hailMsg = hail.Pack();
+	queue.Push(hailMsg);
+	for (int i = 0; i < 3; i++)
+		queue.Push(MakeMessage(8, i));
+	queue.Coalesce(pool, maxSize);
+	CHECK(queue.Size() == 2);
+	CHECK(queue.Pop() == hailMsg);
+	CHECK(MessageBufferReader(queue.Pop()).Command == MessageCodes::Batch);
+
+	// no batching at all with a 0 limit
+	for (int i = 0; i < 3; i++)
+		queue.Push(MakeMessage(8, i));
+	queue.Coalesce(pool, 0);
+	CHECK(queue.Size() == 3);
+	while (queue.Pop() != nullptr);
+
+	// an empty batch holds no messages, a zero length or truncated frame ends it
+	MessageBufferBuilder empty(MessageCodes::Batch);
+	MessageBufferReader emptyReader(empty.Pack());
+	CHECK(emptyReader.Done());
+	CHECK(emptyReader.ReadBatchedMessage(WireFormat()).Message == nullptr);
+
+	MessageBufferBuilder broken(MessageCodes::Batch);
+	broken.AddVarInt(3);
+	broken.AddBytes("abc", 3);
+	broken.AddVarInt(0);
+	broken.AddVarInt(5);
+	broken.AddBytes("de", 2);
+	MessageBufferReader brokenReader(broken.Pack());
+	MessageBufferReader first = brokenReader.ReadBatchedMessage(WireFormat());
+	CHECK(first.Message != nullptr && first.Command == static_cast<MessageCodes>('a') && first.RemainingSize() == 2);
+	CHECK(brokenReader.ReadBatchedMessage(WireFormat()).Message == nullptr);
+	CHECK(brokenReader.Done());
+}
+
+TEST(SchemaRoundTrip)
+{
+	PropertyDesc::Ptr prop = PropertyDesc::Make();
+	prop->ID = 70000;
+	prop->DataType = PropertyDesc::DataTypes::StateV3FQ4F;
+	prop->Scope = PropertyDesc::Scopes::ClientPushSync;
+	prop->Private = true;
+	prop->SetQuantization(-512.5f, 512.5f, 18);
+
+	EntityDesc::Ptr entity = EntityDesc::Make();
+	entity->ID = 12;
+	entity->IsAvatar = true;
+	entity->CreateScope = EntityDesc::CreateScopes::ClientSync;
+	for (int i = 0; i < 300; i++)
+		entity->AddPropertyDesc("P" + std::to_string(i), PropertyDesc::DataTypes::Integer);
+
+	for (int varInts = 0; varInts < 2; varInts++)
+	{
+		WireFormat format = MakeFormat(varInts != 0);
+		MessageBufferBuilder builder(nullptr, format);
+		builder.Command = MessageCodes::AddEntityDef;
+		builder.AddFixed(Schema::ControllerPropertyDef::From(*prop));
+		builder.AddFixed(Schema::EntityDef::From(*entity));
+		builder.AddFixed(Schema::EntityPropertyDef::From(*prop));
+		builder.AddString("after");
+		CHECK(builder.Data.size() == 1 + sizeof(Schema::ControllerPropertyDef) + sizeof(Schema::EntityDef) + sizeof(Schema::EntityPropertyDef) + (varInts ? 1 : 2) + 5);
+
+		MessageBufferReader reader = Reread(builder, format);
+
+		Schema::ControllerPropertyDef controllerDef;
+		CHECK(reader.ReadFixed(controllerDef));
+		PropertyDesc::Ptr controllerProp = PropertyDesc::Make();
+		controllerDef.Apply(*controllerProp);
+		CHECK(controllerProp->ID == 70000 && controllerProp->DataType == prop->DataType && controllerProp->Scope == prop->Scope && controllerProp->Private);
+		CHECK(controllerProp->QuantizeMin == -512.5f && controllerProp->QuantizeMax == 512.5f && controllerProp->QuantizeBits == 18);
+
+		Schema::EntityDef entityDef;
+		CHECK(reader.ReadFixed(entityDef));
+		EntityDesc::Ptr readEntity = EntityDesc::Make();
+		entityDef.Apply(*readEntity);
+		CHECK(readEntity->ID == 12 && readEntity->IsAvatar && readEntity->CreateScope == EntityDesc::CreateScopes::ClientSync);
+		CHECK(entityDef.PropertyCount == 300);
+
+		Schema::EntityPropertyDef propertyDef;
+		CHECK(reader.ReadFixed(propertyDef));
+		PropertyDesc::Ptr entityProp = PropertyDesc::Make();
+		propertyDef.Apply(*entityProp);
+		CHECK(entityProp->ID == 70000 && entityProp->DataType == prop->DataType && entityProp->Scope == prop->Scope && entityProp->Quantized());
+
+		CHECK(reader.ReadString() == "after");
+		CHECK(reader.Done());
+
+		// a prefix cut short fails as a whole and ends the message
+		CHECK(!reader.ReadFixed(entityDef));
+		builder.Clear();
+		builder.AddFixed(Schema::EntityDef::From(*entity));
+		builder.Data.pop_back();
+		reader = Reread(builder, format);
+		CHECK(!reader.ReadFixed(entityDef));
+		CHECK(reader.Done());
+	}
+}
+
+// definitions with more arguments or properties than their prefix can count are refused, not truncated
+TEST(SchemaCountLimits)
+{
+	Server::ServerWorld server;
+
+	RemoteProcedureDef::Ptr fits = RemoteProcedureDef::Make("fits");
+	RemoteProcedureDef::Ptr tooMany = RemoteProcedureDef::Make("too many");
+	for (size_t i = 0; i < Schema::RPCDef::MaxArguments; i++)
+	{
+		fits->DefineArgument(PropertyDesc::DataTypes::Integer);
+		tooMany->DefineArgument(PropertyDesc::DataTypes::Integer);
+	}
+	tooMany->DefineArgument(PropertyDesc::DataTypes::Integer);
+	CHECK(server.RegisterRemoteProcedure(fits) >= 0);
+	CHECK(server.RegisterRemoteProcedure(tooMany) == -1);
+	CHECK(server.GetRPCDef("too many") == nullptr);
+
+	EntityDesc::Ptr entity = EntityDesc::Make();
+	entity->Name = "wide";
+	for (size_t i = 0; i <= Schema::EntityDef::MaxProperties; i++)
+		entity->AddPropertyDesc("p", PropertyDesc::DataTypes::Integer);
+	CHECK(server.RegisterEntityDesc(entity) == -1);
+}
+
+TEST(PropertyDeltaRoundTrip)
+{
+	for (auto dataType : AllTypes)
+	{
+		PropertyData::Ptr previous = MakeProperty(dataType, 0, 16);
+		PropertyData::Ptr current = MakeProperty(dataType, 0, 16);
+		FillValue(*previous, 0);
+
+		for (int seed = 0; seed < 6; seed++)
+		{
+			FillValue(*current, seed);
+			std::vector<char> baseline(static_cast<char*>(previous->DataPtr), static_cast<char*>(previous->DataPtr) + previous->DataLenght);
+			std::vector<char> delta;
+			bool encoded = PropertyDelta::Encode(dataType, current->DataPtr, current->DataLenght, baseline, delta);
+
+			// strings change size with their value, everything else always encodes
+			if (!encoded)
+			{
+				CHECK(previous->DataLenght != current->DataLenght);
+				continue;
+			}
+
+			CHECK(PropertyDelta::Decode(dataType, delta.data(), delta.size(), baseline));
+			CHECK(baseline.size() == current->DataLenght && memcmp(baseline.data(), current->DataPtr, baseline.size()) == 0);
+
+			// a delta against itself is one byte per component, or no runs for strings and buffers
+			std::vector<char> same(static_cast<char*>(current->DataPtr), static_cast<char*>(current->DataPtr) + current->DataLenght);
+			CHECK(PropertyDelta::Encode(dataType, current->DataPtr, current->DataLenght, same, delta));
+			if (PropertyDesc::FixedDataSize(dataType) == 0)
+				CHECK(delta.size() == 1);
+			else
+				CHECK(delta.size() <= current->DataLenght / 4);
+
+			// malformed deltas are refused: cut short, or with bytes left over
+			if (PropertyDesc::FixedDataSize(dataType) != 0)
+			{
+				CHECK(!PropertyDelta::Decode(dataType, delta.data(), delta.size() - 1, same));
+				delta.push_back(0);
+				CHECK(!PropertyDelta::Decode(dataType, delta.data(), delta.size(), same));
+			}
+		}
+	}
+
+	// the baseline must be the same size as the value
+	std::vector<char> shortBaseline(3);
+	std::vector<char> delta;
+	int value = 5;
+	CHECK(!PropertyDelta::Encode(PropertyDesc::DataTypes::Integer, &value, sizeof(value), shortBaseline, delta));
+	CHECK(!PropertyDelta::Decode(PropertyDesc::DataTypes::Integer, "\x02", 1, shortBaseline));
+
+	// runs that point past the end of the value are refused
+	std::vector<char> buffer(8);
+	const char badRun[] = { 1, 6, 4, 1, 1, 1, 1 };
+	CHECK(!PropertyDelta::Decode(PropertyDesc::DataTypes::Buffer, badRun, sizeof(badRun), buffer));
+}
+
+TEST(PropertyPackDeltaRoundTrip)
+{
+	for (auto dataType : AllTypes)
+	{
+		for (int bitPacked = 0; bitPacked < 2; bitPacked++)
+		{
+			WireFormat format = MakeFormat(true, bitPacked != 0, true);
+			PropertyData::Ptr source = MakeProperty(dataType, 5, 16);
+			PropertyData::Ptr target = MakeProperty(dataType, 5, 16);
+			std::vector<char> sent;		// server side baseline for the peer
+			std::vector<char> received;	// client side baseline
+
+			for (int seed = 0; seed < 8; seed++)
+			{
+				FillValue(*source, seed % 3);
+				if (bitPacked)
+				{
+					BitStreamWriter writer;
+					source->PackBitsDelta(writer, sent);
+					BitStreamReader reader(writer.Data.data(), writer.ByteSize());
+					target->UnpackBitsDelta(reader, true, received);
+					CHECK(!reader.Overflow);
+				}
+				else
+				{
+					MessageBufferBuilder builder(nullptr, format);
+					builder.Command = MessageCodes::SetEntityDataValues;
+					source->PackDelta(builder, sent);
+
+					MessageBufferReader reader = Reread(builder, format);
+					bool isDelta = false;
+					CHECK(PropertyData::ReadDeltaHeader(reader, isDelta) == 5);
+					CHECK(!isDelta || seed > 0);
+					target->UnpackDelta(reader, true, isDelta, received);
+					CHECK(reader.Done());
+				}
+
+				CHECK(SameValue(*source, *target));
+				CHECK(sent == received);
+			}
+		}
+	}
+}
+
+TEST(PropertyPackDeltaHighIDs)
+{
+	// the delta flag must not collide with any bit of the property ID
+	static const int ids[] = { 0, 127, 128, 200, 255, 256, 300, 70000 };
+	WireFormat format = MakeFormat(true, false, true);
+	for (int id : ids)
+	{
+		PropertyData::Ptr source = MakeProperty(PropertyDesc::DataTypes::Integer, id);
+		PropertyData::Ptr target = MakeProperty(PropertyDesc::DataTypes::Integer, id);
+		std::vector<char> sent;
+		std::vector<char> received;
+
+		for (int value = 1000; value < 1003; value++)
+		{
+			source->SetValueI(value);
+
+			MessageBufferBuilder builder(nullptr, format);
+			builder.Command = MessageCodes::SetEntityDataValues;
+			source->PackDelta(builder, sent);
+
+			MessageBufferReader reader = Reread(builder, format);
+			bool isDelta = false;
+			CHECK(PropertyData::ReadDeltaHeader(reader, isDelta) == id);
+			CHECK(isDelta == (value > 1000));
+			target->UnpackDelta(reader, true, isDelta, received);
+			CHECK(reader.Done());
+			CHECK(target->GetValueI() == value);
+		}
+	}
+}